@@ -25,8 +25,13 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Client.h"
 #include "Logger.h"
 
+#include <algorithm>
+
+// output a read-only viewer may have in flight before its frames are dropped
+const size_t VIEWER_MAX_UNACKED_BYTES = 1024 * 1024;
 
 std::atomic<uint32_t> ActiveSessions::FileTransferSession::_id_counter(0);
+std::atomic<uint32_t> ActiveSessions::WebAppSession::_group_id_counter(0);
 
 uint32_t ActiveSessions::FileTransferSession::NextId() {
   if(_id_counter == std::numeric_limits<uint32_t>::max()) {
@@ -37,7 +42,9 @@ uint32_t ActiveSessions::FileTransferSession::NextId() {
 
 ActiveSessions::FileTransferSession::FileTransferSession(std::shared_ptr<Client> web_app_client)
     : _web_app_client(web_app_client)
-    , _terminal_id(0) {
+    , _terminal_id(0)
+    , _is_listing_continuation(false)
+    , _response_started(false) {
   _id = NextId();
 }
 
@@ -57,21 +64,151 @@ uint32_t ActiveSessions::FileTransferSession::GetTerminalId() {
   return _terminal_id;
 }
 
+void ActiveSessions::FileTransferSession::SetPath(const std::string& path) {
+  _path = path;
+}
+
+const std::string& ActiveSessions::FileTransferSession::GetPath() {
+  return _path;
+}
+
+void ActiveSessions::FileTransferSession::SetListingContinuation(bool is_continuation) {
+  _is_listing_continuation = is_continuation;
+}
+
+bool ActiveSessions::FileTransferSession::IsListingContinuation() {
+  return _is_listing_continuation;
+}
+
 std::shared_ptr<Client> ActiveSessions::FileTransferSession::GetWebClient() {
   return _web_app_client;
 }
 
+void ActiveSessions::FileTransferSession::SetResponseStarted() {
+  _response_started = true;
+}
+
+bool ActiveSessions::FileTransferSession::IsResponseStarted() {
+  return _response_started;
+}
+
 
 ActiveSessions::WebAppSession::WebAppSession(std::shared_ptr<Client> web_app_client)
      : _web_app_client(web_app_client) {
 }
 
 void ActiveSessions::WebAppSession::AddTerminal(uint32_t terminal_id, uint32_t remote_host_id) {
-  _terminal_ids.insert({terminal_id, remote_host_id});
+  // a resumed terminal comes back under its host's new id
+  _terminal_ids[terminal_id] = remote_host_id;
 }
 
 void ActiveSessions::WebAppSession::DeleteTerminal(uint32_t terminal_id) {
   _terminal_ids.erase(terminal_id);
+  for(auto& group : _terminal_groups) {
+    group.second.erase(terminal_id);
+  }
+}
+
+uint32_t ActiveSessions::WebAppSession::NextGroupId() {
+  if(_group_id_counter == std::numeric_limits<uint32_t>::max()) {
+    DLOG(error, "WebAppSession's group id counter overflow");
+  }
+  return ++_group_id_counter;
+}
+
+uint32_t ActiveSessions::WebAppSession::SetTerminalGroup(uint32_t group_id, const std::vector<uint32_t>& terminal_ids) {
+  if(!group_id) {
+    group_id = NextGroupId();
+  } else if(!HasTerminalGroup(group_id)) {
+    return 0;
+  }
+
+  // only terminals of this session can be written to
+  std::set<uint32_t>& group = _terminal_groups[group_id];
+  group.clear();
+  for(uint32_t terminal_id : terminal_ids) {
+    if(HasTerminalId(terminal_id)) {
+      group.insert(terminal_id);
+    }
+  }
+  return group_id;
+}
+
+bool ActiveSessions::WebAppSession::DeleteTerminalGroup(uint32_t group_id) {
+  return _terminal_groups.erase(group_id);
+}
+
+bool ActiveSessions::WebAppSession::HasTerminalGroup(uint32_t group_id) {
+  return _terminal_groups.find(group_id) != _terminal_groups.end();
+}
+
+std::map<uint32_t, std::vector<uint32_t>> ActiveSessions::WebAppSession::GetTerminalGroupByHost(uint32_t group_id) {
+  std::map<uint32_t, std::vector<uint32_t>> result;
+  auto it = _terminal_groups.find(group_id);
+  if(it == _terminal_groups.end()) {
+    return result;
+  }
+  for(uint32_t terminal_id : it->second) {
+    uint32_t host_id = 0;
+    if(GetHostByTerminal(terminal_id, host_id)) {
+      result[host_id].push_back(terminal_id);
+    }
+  }
+  return result;
+}
+
+std::vector<uint32_t> ActiveSessions::WebAppSession::GetTerminalGroupIds() {
+  std::vector<uint32_t> result;
+  for(auto& group : _terminal_groups) {
+    result.push_back(group.first);
+  }
+  return result;
+}
+
+void ActiveSessions::WebAppSession::AddViewedTerminal(uint32_t terminal_id, uint32_t remote_host_id) {
+  _viewed_terminals[terminal_id] = {remote_host_id, 0, 0};
+}
+
+bool ActiveSessions::WebAppSession::DeleteViewedTerminal(uint32_t terminal_id) {
+  return _viewed_terminals.erase(terminal_id);
+}
+
+std::vector<uint32_t> ActiveSessions::WebAppSession::GetViewedTerminalIds() {
+  std::vector<uint32_t> result;
+  for(auto& viewed : _viewed_terminals) {
+    result.push_back(viewed.first);
+  }
+  return result;
+}
+
+bool ActiveSessions::WebAppSession::ReserveViewOutput(uint32_t terminal_id, size_t size, size_t& out_skipped_bytes) {
+  auto it = _viewed_terminals.find(terminal_id);
+  if(it == _viewed_terminals.end()) {
+    return false;
+  }
+
+  ViewedTerminal& viewed = it->second;
+  // once behind, wait until half of the window drains so the viewer
+  // doesn't flip between skipping and receiving on every frame
+  size_t limit = viewed._skipped_bytes ? VIEWER_MAX_UNACKED_BYTES / 2 : VIEWER_MAX_UNACKED_BYTES;
+  if(viewed._unacked_bytes + size > limit) {
+    viewed._skipped_bytes += size;
+    return false;
+  }
+
+  viewed._unacked_bytes += size;
+  out_skipped_bytes = viewed._skipped_bytes;
+  viewed._skipped_bytes = 0;
+  return true;
+}
+
+void ActiveSessions::WebAppSession::AckViewOutput(uint32_t terminal_id, size_t size) {
+  auto it = _viewed_terminals.find(terminal_id);
+  if(it == _viewed_terminals.end()) {
+    return;
+  }
+  ViewedTerminal& viewed = it->second;
+  viewed._unacked_bytes -= std::min(size, viewed._unacked_bytes);
 }
 
 bool ActiveSessions::WebAppSession::HasTerminalId(uint32_t terminal_id) {
@@ -87,6 +224,14 @@ bool ActiveSessions::WebAppSession::GetHostByTerminal(uint32_t terminal_id, uint
   return false;
 }
 
+void ActiveSessions::WebAppSession::SetOwnerKey(const std::string& owner_key) {
+  _owner_key = owner_key;
+}
+
+const std::string& ActiveSessions::WebAppSession::GetOwnerKey() {
+  return _owner_key;
+}
+
 std::shared_ptr<Client> ActiveSessions::WebAppSession::GetClient() {
   return _web_app_client;
 }
@@ -130,6 +275,13 @@ void ActiveSessions::GetAllWebAppSessions(std::vector<std::shared_ptr<ActiveSess
 }
 
 bool ActiveSessions::EraseWebAppSession(std::shared_ptr<Client> web_app_client) {
+  auto session = GetWebAppSession(web_app_client);
+  if(!session) {
+    return false;
+  }
+  for(uint32_t terminal_id : session->GetViewedTerminalIds()) {
+    RemoveTerminalViewer(web_app_client, terminal_id);
+  }
   return _web_app_sessions.erase(web_app_client->GetId());
 }
 
@@ -175,6 +327,59 @@ bool ActiveSessions::GetRemoteHostByTerminal(uint32_t terminal_id, uint32_t& out
   return false;
 }
 
+bool ActiveSessions::AddTerminalViewer(std::shared_ptr<Client> client, uint32_t terminal_id, uint32_t& out_remote_host_id) {
+  auto session = GetWebAppSession(client);
+  if(!session || session->HasTerminalId(terminal_id)) {
+    return false;
+  }
+
+  if(!GetRemoteHostByTerminal(terminal_id, out_remote_host_id)) {
+    DLOG(warn, "AddTerminalViewer : can't find terminal with id : {}", terminal_id);
+    return false;
+  }
+
+  session->AddViewedTerminal(terminal_id, out_remote_host_id);
+  _terminal_viewers[terminal_id].insert(client->GetId());
+  return true;
+}
+
+bool ActiveSessions::RemoveTerminalViewer(std::shared_ptr<Client> client, uint32_t terminal_id) {
+  auto session = GetWebAppSession(client);
+  if(!session || !session->DeleteViewedTerminal(terminal_id)) {
+    return false;
+  }
+
+  auto it = _terminal_viewers.find(terminal_id);
+  if(it != _terminal_viewers.end()) {
+    it->second.erase(client->GetId());
+    if(it->second.empty()) {
+      _terminal_viewers.erase(it);
+    }
+  }
+  return true;
+}
+
+void ActiveSessions::GetTerminalViewers(uint32_t terminal_id, std::vector<std::shared_ptr<WebAppSession>>& out_sessions_vec) {
+  auto it = _terminal_viewers.find(terminal_id);
+  if(it == _terminal_viewers.end()) {
+    return;
+  }
+  for(uint32_t client_id : it->second) {
+    auto session = GetWebAppSession(client_id);
+    if(session) {
+      out_sessions_vec.push_back(session);
+    }
+  }
+}
+
+void ActiveSessions::EraseTerminalViewers(uint32_t terminal_id, std::vector<std::shared_ptr<WebAppSession>>& out_sessions_vec) {
+  GetTerminalViewers(terminal_id, out_sessions_vec);
+  for(auto& session : out_sessions_vec) {
+    session->DeleteViewedTerminal(terminal_id);
+  }
+  _terminal_viewers.erase(terminal_id);
+}
+
 std::shared_ptr<ActiveSessions::FileTransferSession> ActiveSessions::CreateFileTransferSession(std::shared_ptr<Client> web_app_client) {
   auto session = std::make_shared<ActiveSessions::FileTransferSession>(web_app_client);
   _transfer_sessions.insert({session->GetId(), session});
@@ -26,6 +26,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <atomic>
 #include <memory>
 #include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 class Client;
@@ -41,10 +43,33 @@ public:
     bool HasTerminalId(uint32_t terminal_id);
     bool GetHostByTerminal(uint32_t terminal_id, uint32_t& out_host_id);
     const std::map<uint32_t, uint32_t>& GetTerminals() {return _terminal_ids;}
+    uint32_t SetTerminalGroup(uint32_t group_id, const std::vector<uint32_t>& terminal_ids);
+    bool DeleteTerminalGroup(uint32_t group_id);
+    bool HasTerminalGroup(uint32_t group_id);
+    std::map<uint32_t, std::vector<uint32_t>> GetTerminalGroupByHost(uint32_t group_id);
+    std::vector<uint32_t> GetTerminalGroupIds();
+    void AddViewedTerminal(uint32_t terminal_id, uint32_t remote_host_id);
+    bool DeleteViewedTerminal(uint32_t terminal_id);
+    std::vector<uint32_t> GetViewedTerminalIds();
+    bool ReserveViewOutput(uint32_t terminal_id, size_t size, size_t& out_skipped_bytes);
+    void AckViewOutput(uint32_t terminal_id, size_t size);
+    void SetOwnerKey(const std::string& owner_key);
+    const std::string& GetOwnerKey();
     std::shared_ptr<Client> GetClient();
   private:
+    struct ViewedTerminal {
+      uint32_t _remote_host_id;
+      size_t _unacked_bytes;
+      size_t _skipped_bytes;
+    };
+
+    static uint32_t NextGroupId();
+    static std::atomic<uint32_t> _group_id_counter;
     std::shared_ptr<Client> _web_app_client;
     std::map<uint32_t, uint32_t> _terminal_ids; // terminal_id, remote_host_id
+    std::map<uint32_t, std::set<uint32_t>> _terminal_groups; // group_id, terminal_ids
+    std::map<uint32_t, ViewedTerminal> _viewed_terminals; // read-only, by terminal_id
+    std::string _owner_key; // kept by the browser across reconnects, ties terminals to it
   };
 
   class FileTransferSession {
@@ -54,7 +79,13 @@ public:
     void SetFileTransfer(std::shared_ptr<FileTransfer> file_transfer);
     void SetTerminalId(uint32_t terminal_id);
     uint32_t GetTerminalId();
+    void SetPath(const std::string& path);
+    const std::string& GetPath();
+    void SetListingContinuation(bool is_continuation);
+    bool IsListingContinuation();
     std::shared_ptr<Client> GetWebClient();
+    void SetResponseStarted();
+    bool IsResponseStarted();
   private :
     static uint32_t NextId();
     static std::atomic<uint32_t> _id_counter;
@@ -62,6 +93,9 @@ public:
     std::shared_ptr<FileTransfer> _file_transfer;
     std::shared_ptr<Client> _web_app_client;
     uint32_t _terminal_id;
+    std::string _path;
+    bool _is_listing_continuation;
+    bool _response_started;
   };
 
   std::shared_ptr<WebAppSession> CreateWebAppSession(std::shared_ptr<Client> web_app_client);
@@ -73,6 +107,10 @@ public:
   bool IsWebAppClientOwningTerminal(std::shared_ptr<Client> client, uint32_t terminal_id);
   bool GetRemoteHostByTerminal(uint32_t client_id, uint32_t terminal_id, uint32_t& out_remote_host_id);
   bool GetRemoteHostByTerminal(uint32_t terminal_id, uint32_t& out_remote_host_id);
+  bool AddTerminalViewer(std::shared_ptr<Client> client, uint32_t terminal_id, uint32_t& out_remote_host_id);
+  bool RemoveTerminalViewer(std::shared_ptr<Client> client, uint32_t terminal_id);
+  void GetTerminalViewers(uint32_t terminal_id, std::vector<std::shared_ptr<WebAppSession>>& out_sessions_vec);
+  void EraseTerminalViewers(uint32_t terminal_id, std::vector<std::shared_ptr<WebAppSession>>& out_sessions_vec);
 
   std::shared_ptr<FileTransferSession> CreateFileTransferSession(std::shared_ptr<Client> web_app_client);
   std::shared_ptr<FileTransferSession> GetFileTransferSession(uint32_t file_session_id);
@@ -81,4 +119,5 @@ public:
 private:
   std::map<uint32_t, std::shared_ptr<ActiveSessions::WebAppSession>> _web_app_sessions; //by web app client id
   std::map<uint32_t, std::shared_ptr<ActiveSessions::FileTransferSession>> _transfer_sessions; //by FileTransferSession id
+  std::map<uint32_t, std::set<uint32_t>> _terminal_viewers; //web app client ids by terminal id
 };
\ No newline at end of file
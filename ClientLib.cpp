@@ -26,12 +26,18 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <unistd.h>
 
 #include "Connection.h"
+#include "PtyZygote.h"
 #include "TerminalClient.h"
+#include "TerminalHandler.h"
 
 std::shared_ptr<TerminalClient> g_proxy_client;
 
 extern "C" void init(int port, const char* host, const char* cmd) {
   if(!g_proxy_client) {
+    // forked before the client starts any threads
+    if(TerminalHandler::IsReactorEnabled()) {
+      PtyZygote::Start();
+    }
     auto connection = Connection::CreateBasic();
     g_proxy_client = TerminalClient::Create(connection, port, host, cmd);
   }
@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CommandRunner.h"
+#include "Data.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <functional>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+const size_t READ_BUFFER_SIZE = 16 * 1024;
+const size_t MAX_COMMAND_OUTPUT = 1024 * 1024;
+
+
+CommandRunner::CommandRunner(std::weak_ptr<CommandRunnerListener> listener)
+    : _listener(listener) {
+}
+
+bool CommandRunner::Run(uint32_t exec_id, const std::string& command, uint32_t timeout_ms) {
+  int out_pipe[2];
+  int err_pipe[2];
+  if(pipe2(out_pipe, O_CLOEXEC)) {
+    DLOG(error, "CommandRunner : pipe failed");
+    return false;
+  }
+  if(pipe2(err_pipe, O_CLOEXEC)) {
+    DLOG(error, "CommandRunner : pipe failed");
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+    return false;
+  }
+
+  pid_t pid = fork();
+  if(pid < 0) {
+    DLOG(error, "CommandRunner : fork failed");
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+    close(err_pipe[0]);
+    close(err_pipe[1]);
+    return false;
+  }
+
+  if(!pid) {
+    // own process group, so a timeout kills everything the command started
+    setpgid(0, 0);
+    int null_fd = open("/dev/null", O_RDONLY);
+    if(null_fd >= 0) {
+      dup2(null_fd, STDIN_FILENO);
+    }
+    dup2(out_pipe[1], STDOUT_FILENO);
+    dup2(err_pipe[1], STDERR_FILENO);
+    execl("/bin/sh", "sh", "-c", command.c_str(), (char*)nullptr);
+    _exit(127);
+  }
+
+  setpgid(pid, pid);
+  close(out_pipe[1]);
+  close(err_pipe[1]);
+
+  auto cmd = std::make_shared<Command>();
+  cmd->_exec_id = exec_id;
+  cmd->_pid = pid;
+  cmd->_out_fd = out_pipe[0];
+  cmd->_err_fd = err_pipe[0];
+  cmd->_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _commands[exec_id] = cmd;
+  }
+
+  std::thread(std::bind(&CommandRunner::Watch, shared_from_this(), cmd)).detach();
+  return true;
+}
+
+void CommandRunner::Cancel(uint32_t exec_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _commands.find(exec_id);
+  if(it == _commands.end()) {
+    return;
+  }
+  it->second->_cancelled = true;
+  kill(-it->second->_pid, SIGKILL);
+}
+
+void CommandRunner::CancelAll() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  for(auto& command : _commands) {
+    command.second->_cancelled = true;
+    kill(-command.second->_pid, SIGKILL);
+  }
+}
+
+void CommandRunner::Watch(std::shared_ptr<Command> command) {
+  struct pollfd fds[2];
+  fds[0].fd = command->_out_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = command->_err_fd;
+  fds[1].events = POLLIN;
+  const uint8_t streams[2] = {Stream::STDOUT, Stream::STDERR};
+
+  std::vector<unsigned char> buffer(READ_BUFFER_SIZE);
+  size_t output_size = 0;
+  uint8_t flags = EndFlags::NONE;
+  bool killed = false;
+  int open_fds = 2;
+
+  while(open_fds) {
+    int timeout = -1;
+    if(!killed) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(command->_deadline - std::chrono::steady_clock::now());
+      timeout = (int)std::max<int64_t>(0, remaining.count());
+    }
+
+    int ready = poll(fds, 2, timeout);
+    if(ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if(ready < 0) {
+      DLOG(error, "CommandRunner : poll failed");
+      kill(-command->_pid, SIGKILL);
+      break;
+    }
+    if(!ready) {
+      flags |= EndFlags::TIMED_OUT;
+      kill(-command->_pid, SIGKILL);
+      killed = true;
+      continue;
+    }
+
+    for(int i = 0; i < 2; ++i) {
+      if(fds[i].fd < 0 || !fds[i].revents) {
+        continue;
+      }
+      ssize_t read_size = read(fds[i].fd, buffer.data(), buffer.size());
+      if(read_size <= 0) {
+        close(fds[i].fd);
+        fds[i].fd = -1;
+        --open_fds;
+        continue;
+      }
+
+      // the command keeps running, only what's sent back is capped
+      size_t send_size = std::min<size_t>((size_t)read_size, MAX_COMMAND_OUTPUT - output_size);
+      if(send_size < (size_t)read_size) {
+        flags |= EndFlags::TRUNCATED;
+      }
+      output_size += send_size;
+      auto listener = _listener.lock();
+      if(send_size && listener && !command->_cancelled) {
+        listener->OnCommandOutput(command->_exec_id, streams[i], std::make_shared<Data>((uint32_t)send_size, buffer.data()));
+      }
+    }
+  }
+
+  for(int i = 0; i < 2; ++i) {
+    if(fds[i].fd >= 0) {
+      close(fds[i].fd);
+    }
+  }
+
+  int status = 0;
+  int32_t exit_code = -1;
+  while(waitpid(command->_pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  if(WIFEXITED(status)) {
+    exit_code = WEXITSTATUS(status);
+  } else if(WIFSIGNALED(status)) {
+    exit_code = 128 + WTERMSIG(status);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _commands.erase(command->_exec_id);
+  }
+
+  auto listener = _listener.lock();
+  if(listener && !command->_cancelled) {
+    listener->OnCommandEnd(command->_exec_id, exit_code, flags);
+  }
+}
@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+class Data;
+
+class CommandRunnerListener {
+public:
+  virtual void OnCommandOutput(uint32_t exec_id, uint8_t stream, std::shared_ptr<Data> output) = 0;
+  virtual void OnCommandEnd(uint32_t exec_id, int32_t exit_code, uint8_t flags) = 0;
+};
+
+/*
+ Runs non-interactive commands with /bin/sh -c, without a PTY. Every command is watched by its own thread
+ which streams stdout / stderr to the listener and kills the whole process group on timeout or cancel.
+*/
+class CommandRunner : public std::enable_shared_from_this<CommandRunner> {
+public:
+  enum Stream {
+    STDOUT = 1,
+    STDERR = 2
+  };
+
+  enum EndFlags {
+    NONE = 0,
+    TIMED_OUT = 1 << 0,
+    TRUNCATED = 1 << 1,
+    HOST_LOST = 1 << 2
+  };
+
+  CommandRunner(std::weak_ptr<CommandRunnerListener> listener);
+  bool Run(uint32_t exec_id, const std::string& command, uint32_t timeout_ms);
+  void Cancel(uint32_t exec_id);
+  void CancelAll();
+
+private:
+  struct Command {
+    uint32_t _exec_id = 0;
+    pid_t _pid = -1;
+    int _out_fd = -1;
+    int _err_fd = -1;
+    std::chrono::steady_clock::time_point _deadline;
+    std::atomic_bool _cancelled{false};
+  };
+
+  void Watch(std::shared_ptr<Command> command);
+
+  std::weak_ptr<CommandRunnerListener> _listener;
+  std::mutex _mutex;
+  std::map<uint32_t, std::shared_ptr<Command>> _commands;
+};
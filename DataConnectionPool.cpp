@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DataConnectionPool.h"
+#include "Connection.h"
+#include "Logger.h"
+#include "SimpleMessage.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+const size_t DEFAULT_POOL_SIZE = 2;
+const std::string POOL_SIZE_ENV = "TRANSFER_POOL_SIZE";
+
+
+DataConnectionPool::DataConnectionPool(std::shared_ptr<Connection> connection, const std::string& host, int port)
+    : _connection(connection)
+    , _host(host)
+    , _port(port)
+    , _size(DEFAULT_POOL_SIZE)
+    , _connecting(0)
+    , _enabled(false) {
+  char* pool_size = std::getenv(POOL_SIZE_ENV.c_str());
+  if(pool_size) {
+    _size = (size_t)std::strtoul(pool_size, nullptr, 10);
+  }
+}
+
+void DataConnectionPool::Fill() {
+  size_t missing = 0;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _enabled = true;
+    if(_idle.size() + _connecting < _size) {
+      missing = _size - _idle.size() - _connecting;
+      _connecting += missing;
+    }
+  }
+  for(size_t i = 0; i < missing; ++i) {
+    _connection->CreateClient(_port, _host, shared_from_this());
+  }
+}
+
+void DataConnectionPool::Clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _enabled = false;
+  _idle.clear();
+}
+
+std::shared_ptr<Client> DataConnectionPool::Take() {
+  std::shared_ptr<Client> client;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(!_idle.empty()) {
+      client = _idle.back();
+      _idle.pop_back();
+    }
+  }
+  Fill();
+  return client;
+}
+
+void DataConnectionPool::OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) {
+  DLOG(warn, "DataConnectionPool : unexpected message on idle connection : {}", client->GetId());
+}
+
+bool DataConnectionPool::OnClientConnecting(std::shared_ptr<Client> client, NetError err) {
+  if(err != NetError::OK) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_connecting) {
+      _connecting--;
+    }
+    return false;
+  }
+
+  auto msg_builder = std::unique_ptr<SimpleMessageBuilder>(new SimpleMessageBuilder());
+  client->SetMsgBuilder(std::move(msg_builder));
+  return true;
+}
+
+void DataConnectionPool::OnClientConnected(std::shared_ptr<Client> client) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_connecting) {
+    _connecting--;
+  }
+  if(_enabled) {
+    _idle.push_back(client);
+  }
+}
+
+void DataConnectionPool::OnClientClosed(std::shared_ptr<Client> client) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _idle.erase(std::remove(_idle.begin(), _idle.end(), client), _idle.end());
+}
@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Client.h"
+
+class Connection;
+
+class DataConnectionPool
+    : public ClientManager
+    , public std::enable_shared_from_this<DataConnectionPool> {
+public:
+  DataConnectionPool(std::shared_ptr<Connection> connection, const std::string& host, int port);
+  void Fill();
+  void Clear();
+  std::shared_ptr<Client> Take();
+
+  void OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) override;
+  bool OnClientConnecting(std::shared_ptr<Client> client, NetError err) override;
+  void OnClientConnected(std::shared_ptr<Client> client) override;
+  void OnClientClosed(std::shared_ptr<Client> client) override;
+
+private:
+  std::shared_ptr<Connection> _connection;
+  std::string _host;
+  int _port;
+  size_t _size;
+  size_t _connecting;
+  bool _enabled;
+  std::mutex _mutex;
+  std::vector<std::shared_ptr<Client>> _idle;
+};
@@ -0,0 +1,518 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "DeltaTransfer.h"
+#include "Data.h"
+#include "Logger.h"
+
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+const uint32_t MIN_BLOCK_SIZE = 2048;
+const uint32_t MAX_BLOCK_COUNT = 64 * 1024;
+const uint32_t BLOCK_INFO_SIZE = 4 + DeltaSignature::STRONG_HASH_SIZE;
+const uint32_t SIGNATURE_HEADER_SIZE = 4 + 8 + 4;
+const uint32_t FILE_READ_SIZE = 256 * 1024;
+const uint32_t OPS_BLOCK_SIZE = 64 * 1024;
+const uint32_t MAX_LITERAL_SIZE = 32 * 1024;
+const uint32_t MAX_COPY_RUN_SIZE = 1024 * 1024;
+const uint32_t OUTPUT_BLOCK_SIZE = 1024 * 1024;
+
+const uint8_t OP_LITERAL = 1;
+const uint8_t OP_COPY = 2;
+
+
+static double CpuTimeNow() {
+  return (double)std::clock() / CLOCKS_PER_SEC;
+}
+
+static void AppendU32(std::vector<unsigned char>& out, uint32_t value) {
+  out.insert(out.end(), (unsigned char*)&value, (unsigned char*)&value + 4);
+}
+
+static uint32_t ChooseBlockSize(uint64_t file_size) {
+  uint64_t block_size = (uint64_t)std::sqrt((double)file_size);
+  block_size = ((block_size + 1023) / 1024) * 1024;
+  block_size = std::max(block_size, (uint64_t)MIN_BLOCK_SIZE);
+  block_size = std::max(block_size, (file_size + MAX_BLOCK_COUNT - 1) / MAX_BLOCK_COUNT);
+  return (uint32_t)block_size;
+}
+
+
+DeltaSignature::DeltaSignature()
+    : _block_size(MIN_BLOCK_SIZE)
+    , _base_size(0) {
+}
+
+uint32_t DeltaSignature::WeakChecksum(const unsigned char* data, uint32_t size) {
+  uint32_t a = 0;
+  uint32_t b = 0;
+  for(uint32_t i = 0; i < size; ++i) {
+    a += data[i];
+    b += (size - i) * data[i];
+  }
+  return (a & 0xffff) | (b << 16);
+}
+
+void DeltaSignature::StrongChecksum(const unsigned char* data, uint32_t size, unsigned char* out_hash) {
+  digestpp::md5().absorb(data, size).digest(out_hash, STRONG_HASH_SIZE);
+}
+
+std::shared_ptr<DeltaSignature> DeltaSignature::CreateFromFile(const std::string& path) {
+  auto signature = std::make_shared<DeltaSignature>();
+
+  std::error_code fs_error;
+  if(!std::filesystem::is_regular_file(path, fs_error)) {
+    return signature;
+  }
+
+  uint64_t file_size = (uint64_t)std::filesystem::file_size(path, fs_error);
+  std::ifstream file(path, std::ios::binary);
+  if(fs_error || !file.is_open()) {
+    DLOG(error, "DeltaSignature : can't read base : {}", path);
+    return signature;
+  }
+
+  signature->_block_size = ChooseBlockSize(file_size);
+  signature->_base_size = file_size;
+
+  std::vector<unsigned char> buffer(signature->_block_size);
+  while(file.read((char*)buffer.data(), buffer.size()) || file.gcount() > 0) {
+    uint32_t read_size = (uint32_t)file.gcount();
+    BlockInfo info;
+    info.weak = WeakChecksum(buffer.data(), read_size);
+    StrongChecksum(buffer.data(), read_size, info.strong);
+    signature->_blocks.push_back(info);
+  }
+
+  signature->BuildIndex();
+  return signature;
+}
+
+std::shared_ptr<DeltaSignature> DeltaSignature::Deserialize(std::shared_ptr<Data> data) {
+  auto signature = std::make_shared<DeltaSignature>();
+  uint32_t block_count = 0;
+  bool data_retrieved = true;
+
+  data_retrieved = data_retrieved && data->CopyTo(&signature->_block_size, 0, 4);
+  data_retrieved = data_retrieved && data->CopyTo(&signature->_base_size, 4, 8);
+  data_retrieved = data_retrieved && data->CopyTo(&block_count, 12, 4);
+  if(!data_retrieved || !signature->_block_size ||
+     data->GetCurrentSize() != SIGNATURE_HEADER_SIZE + (uint64_t)block_count * BLOCK_INFO_SIZE) {
+    DLOG(error, "DeltaSignature::Deserialize : invalid signature");
+    return nullptr;
+  }
+
+  signature->_blocks.resize(block_count);
+  uint32_t offset = SIGNATURE_HEADER_SIZE;
+  for(auto& info : signature->_blocks) {
+    data->CopyTo(&info.weak, offset, 4);
+    data->CopyTo(info.strong, offset + 4, STRONG_HASH_SIZE);
+    offset += BLOCK_INFO_SIZE;
+  }
+
+  signature->BuildIndex();
+  return signature;
+}
+
+std::shared_ptr<Data> DeltaSignature::Serialize() {
+  uint32_t block_count = (uint32_t)_blocks.size();
+  auto data = std::make_shared<Data>(SIGNATURE_HEADER_SIZE + block_count * BLOCK_INFO_SIZE);
+  data->Add(4, (unsigned char*)&_block_size);
+  data->Add(8, (unsigned char*)&_base_size);
+  data->Add(4, (unsigned char*)&block_count);
+  for(auto& info : _blocks) {
+    data->Add(4, (unsigned char*)&info.weak);
+    data->Add(STRONG_HASH_SIZE, info.strong);
+  }
+  return data;
+}
+
+uint32_t DeltaSignature::GetBlockSize() {
+  return _block_size;
+}
+
+uint64_t DeltaSignature::GetBaseSize() {
+  return _base_size;
+}
+
+const std::vector<DeltaSignature::BlockInfo>& DeltaSignature::GetBlocks() {
+  return _blocks;
+}
+
+void DeltaSignature::BuildIndex() {
+  _weak_index.clear();
+  _weak_index.reserve(_blocks.size());
+  // Only full blocks can be matched by the rolling window.
+  uint32_t full_blocks = (uint32_t)(_base_size / _block_size);
+  for(uint32_t i = 0; i < full_blocks && i < _blocks.size(); ++i) {
+    _weak_index.insert({_blocks[i].weak, i});
+  }
+}
+
+bool DeltaSignature::FindBlock(uint32_t weak, const unsigned char* data, uint32_t preferred_index, uint32_t& out_index) {
+  auto range = _weak_index.equal_range(weak);
+  if(range.first == range.second) {
+    return false;
+  }
+
+  unsigned char strong[STRONG_HASH_SIZE];
+  StrongChecksum(data, _block_size, strong);
+
+  bool found = false;
+  for(auto it = range.first; it != range.second; ++it) {
+    if(std::memcmp(_blocks[it->second].strong, strong, STRONG_HASH_SIZE)) {
+      continue;
+    }
+    if(!found || it->second == preferred_index) {
+      out_index = it->second;
+      found = true;
+    }
+  }
+  return found;
+}
+
+
+DeltaEncoder::DeltaEncoder(std::shared_ptr<DeltaSignature> signature)
+    : _signature(signature)
+    , _window_pos(0)
+    , _literal_start(0)
+    , _file_eof(false)
+    , _finished(false)
+    , _roll_valid(false)
+    , _roll_a(0)
+    , _roll_b(0)
+    , _copy_index(0)
+    , _copy_count(0)
+    , _copied_size(0)
+    , _literal_size(0)
+    , _cpu_time(0) {
+}
+
+bool DeltaEncoder::Open(const std::string& path) {
+  _file.open(path, std::ios::binary);
+  return _file.is_open();
+}
+
+std::shared_ptr<Data> DeltaEncoder::ReadNextBlock(bool& out_is_last) {
+  double cpu_start = CpuTimeNow();
+  uint32_t block_size = _signature->GetBlockSize();
+  bool has_blocks = !_signature->GetBlocks().empty();
+  uint64_t output_start = _copied_size + _literal_size;
+  std::vector<unsigned char> ops;
+
+  // matched blocks cost a few bytes of ops each, bound the file bytes one call covers too
+  while(!_finished && ops.size() < OPS_BLOCK_SIZE) {
+    if(_copied_size + _literal_size - output_start >= OUTPUT_BLOCK_SIZE) {
+      FlushCopy(ops);
+      break;
+    }
+    if(!FillWindow()) {
+      return nullptr;
+    }
+
+    if(!has_blocks) {
+      _window_pos = (uint32_t)_window.size();
+      FlushLiteral(_window_pos, ops);
+      _finished = _file_eof;
+      continue;
+    }
+
+    uint32_t available = (uint32_t)_window.size() - _window_pos;
+    if(available < block_size) {
+      if(!_file_eof) {
+        continue;
+      }
+      FlushLiteral((uint32_t)_window.size(), ops);
+      FlushCopy(ops);
+      _finished = true;
+      break;
+    }
+
+    if(!_roll_valid) {
+      RollInit();
+    }
+
+    uint32_t weak = (_roll_a & 0xffff) | (_roll_b << 16);
+    uint32_t preferred = _copy_index + _copy_count;
+    uint32_t index = 0;
+    if(_signature->FindBlock(weak, &_window[_window_pos], preferred, index)) {
+      FlushLiteral(_window_pos, ops);
+      uint32_t max_run = std::max(MAX_COPY_RUN_SIZE / block_size, (uint32_t)1);
+      if(_copy_count && index == preferred && _copy_count < max_run) {
+        _copy_count++;
+      } else {
+        FlushCopy(ops);
+        _copy_index = index;
+        _copy_count = 1;
+      }
+      _file_hasher.absorb(&_window[_window_pos], block_size);
+      _copied_size += block_size;
+      _window_pos += block_size;
+      _literal_start = _window_pos;
+      _roll_valid = false;
+      continue;
+    }
+
+    if(_window_pos + block_size < _window.size()) {
+      Roll(_window[_window_pos], _window[_window_pos + block_size]);
+    } else {
+      _roll_valid = false;
+    }
+    _window_pos++;
+
+    if(_window_pos - _literal_start >= MAX_LITERAL_SIZE) {
+      FlushLiteral(_window_pos, ops);
+    }
+  }
+
+  out_is_last = _finished;
+  _cpu_time += CpuTimeNow() - cpu_start;
+  return std::make_shared<Data>((uint32_t)ops.size(), ops.data());
+}
+
+void DeltaEncoder::GetFileHash(unsigned char* out_hash) {
+  _file_hasher.digest(out_hash, DeltaSignature::STRONG_HASH_SIZE);
+}
+
+uint64_t DeltaEncoder::GetCopiedSize() {
+  return _copied_size;
+}
+
+uint64_t DeltaEncoder::GetLiteralSize() {
+  return _literal_size;
+}
+
+double DeltaEncoder::GetCpuTime() {
+  return _cpu_time;
+}
+
+bool DeltaEncoder::FillWindow() {
+  uint32_t block_size = _signature->GetBlockSize();
+  if(_file_eof || _window.size() - _window_pos > block_size) {
+    return true;
+  }
+
+  if(_literal_start) {
+    _window.erase(_window.begin(), _window.begin() + _literal_start);
+    _window_pos -= _literal_start;
+    _literal_start = 0;
+  }
+
+  size_t old_size = _window.size();
+  _window.resize(old_size + FILE_READ_SIZE);
+  _file.read((char*)_window.data() + old_size, FILE_READ_SIZE);
+  _window.resize(old_size + (size_t)_file.gcount());
+  if(_file.bad()) {
+    DLOG(error, "DeltaEncoder : read failed");
+    return false;
+  }
+  _file_eof = _file.eof();
+  return true;
+}
+
+void DeltaEncoder::RollInit() {
+  uint32_t block_size = _signature->GetBlockSize();
+  uint32_t weak = DeltaSignature::WeakChecksum(&_window[_window_pos], block_size);
+  _roll_a = weak & 0xffff;
+  _roll_b = weak >> 16;
+  _roll_valid = true;
+}
+
+void DeltaEncoder::Roll(unsigned char out, unsigned char in) {
+  uint32_t block_size = _signature->GetBlockSize();
+  _roll_a = (_roll_a - out + in) & 0xffff;
+  _roll_b = (_roll_b - block_size * out + _roll_a) & 0xffff;
+}
+
+void DeltaEncoder::FlushLiteral(uint32_t end, std::vector<unsigned char>& out_ops) {
+  if(end <= _literal_start) {
+    return;
+  }
+  FlushCopy(out_ops);
+
+  while(_literal_start < end) {
+    uint32_t size = std::min(end - _literal_start, MAX_LITERAL_SIZE);
+    out_ops.push_back(OP_LITERAL);
+    AppendU32(out_ops, size);
+    out_ops.insert(out_ops.end(), &_window[_literal_start], &_window[_literal_start] + size);
+    _file_hasher.absorb(&_window[_literal_start], size);
+    _literal_size += size;
+    _literal_start += size;
+  }
+}
+
+void DeltaEncoder::FlushCopy(std::vector<unsigned char>& out_ops) {
+  if(!_copy_count) {
+    return;
+  }
+  out_ops.push_back(OP_COPY);
+  AppendU32(out_ops, _copy_index);
+  AppendU32(out_ops, _copy_count);
+  _copy_count = 0;
+}
+
+
+DeltaDecoder::DeltaDecoder(const std::string& base_path, const std::string& output_path)
+    : _base_path(base_path)
+    , _output_path(output_path)
+    , _block_size(0)
+    , _base_size(0)
+    , _max_output(0)
+    , _wire_size(0)
+    , _output_size(0)
+    , _cpu_time(0) {
+}
+
+bool DeltaDecoder::Open(std::shared_ptr<DeltaSignature> signature) {
+  _block_size = signature->GetBlockSize();
+  _base_size = signature->GetBaseSize();
+  // the encoder covers OUTPUT_BLOCK_SIZE per call, plus a carried literal and the step that crossed it
+  _max_output = (uint64_t)OUTPUT_BLOCK_SIZE + MAX_LITERAL_SIZE + FILE_READ_SIZE + _block_size;
+
+  if(_base_size) {
+    _base.open(_base_path, std::ios::binary);
+    if(!_base.is_open()) {
+      DLOG(error, "DeltaDecoder : can't open base : {}", _base_path);
+      return false;
+    }
+  }
+
+  if(_output_path.empty()) {
+    return true;
+  }
+
+  _output.open(_output_path, std::ios::binary | std::ios::trunc);
+  if(!_output.is_open()) {
+    DLOG(error, "DeltaDecoder : can't open output : {}", _output_path);
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<Data> DeltaDecoder::Decode(std::shared_ptr<Data> ops) {
+  double cpu_start = CpuTimeNow();
+  const unsigned char* ops_raw = ops->GetCurrentDataRaw();
+  uint32_t ops_size = ops->GetCurrentSize();
+  uint32_t offset = 0;
+  std::vector<unsigned char> result;
+
+  while(offset < ops_size) {
+    uint8_t op = ops_raw[offset];
+    uint32_t first = 0;
+    uint32_t second = 0;
+    if(offset + 5 > ops_size) {
+      DLOG(error, "DeltaDecoder : truncated op");
+      return nullptr;
+    }
+    std::memcpy(&first, ops_raw + offset + 1, 4);
+    offset += 5;
+
+    if(op == OP_LITERAL) {
+      if(offset + first > ops_size) {
+        DLOG(error, "DeltaDecoder : truncated literal");
+        return nullptr;
+      }
+      if(result.size() + first > _max_output) {
+        DLOG(error, "DeltaDecoder : ops expand past {} bytes", _max_output);
+        return nullptr;
+      }
+      result.insert(result.end(), ops_raw + offset, ops_raw + offset + first);
+      offset += first;
+    } else if(op == OP_COPY) {
+      if(offset + 4 > ops_size) {
+        DLOG(error, "DeltaDecoder : truncated copy");
+        return nullptr;
+      }
+      std::memcpy(&second, ops_raw + offset, 4);
+      offset += 4;
+
+      uint64_t begin = (uint64_t)first * _block_size;
+      uint64_t end = std::min(begin + (uint64_t)second * _block_size, _base_size);
+      if(begin >= end) {
+        DLOG(error, "DeltaDecoder : copy out of base range");
+        return nullptr;
+      }
+      if(result.size() + (end - begin) > _max_output) {
+        DLOG(error, "DeltaDecoder : ops expand past {} bytes", _max_output);
+        return nullptr;
+      }
+      size_t result_size = result.size();
+      result.resize(result_size + (end - begin));
+      _base.clear();
+      _base.seekg(begin);
+      if(!_base.read((char*)result.data() + result_size, end - begin)) {
+        DLOG(error, "DeltaDecoder : base read failed");
+        return nullptr;
+      }
+    } else {
+      DLOG(error, "DeltaDecoder : unknown op : {}", op);
+      return nullptr;
+    }
+  }
+
+  if(_output.is_open()) {
+    _output.write((char*)result.data(), result.size());
+  }
+  _file_hasher.absorb(result.data(), result.size());
+  _wire_size += ops_size;
+  _output_size += result.size();
+  _cpu_time += CpuTimeNow() - cpu_start;
+  return std::make_shared<Data>((uint32_t)result.size(), result.data());
+}
+
+bool DeltaDecoder::Finish(const unsigned char* expected_hash) {
+  bool output_valid = _output.is_open() && !_output.fail();
+  _output.close();
+  _base.close();
+
+  unsigned char hash[DeltaSignature::STRONG_HASH_SIZE];
+  _file_hasher.digest(hash, DeltaSignature::STRONG_HASH_SIZE);
+  bool hash_valid = !std::memcmp(hash, expected_hash, DeltaSignature::STRONG_HASH_SIZE);
+  if(_output_path.empty()) {
+    return hash_valid;
+  }
+
+  if(!hash_valid || !output_valid) {
+    DLOG(error, "DeltaDecoder : reconstructed file doesn't match : {}", _output_path);
+    std::error_code fs_error;
+    std::filesystem::remove(_output_path, fs_error);
+    return false;
+  }
+  return true;
+}
+
+uint64_t DeltaDecoder::GetWireSize() {
+  return _wire_size;
+}
+
+uint64_t DeltaDecoder::GetOutputSize() {
+  return _output_size;
+}
+
+double DeltaDecoder::GetCpuTime() {
+  return _cpu_time;
+}
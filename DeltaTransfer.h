@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "md5.hpp"
+
+class Data;
+
+class DeltaSignature {
+public:
+  static const uint32_t STRONG_HASH_SIZE = 16;
+
+  struct BlockInfo {
+    uint32_t weak;
+    unsigned char strong[STRONG_HASH_SIZE];
+  };
+
+  static std::shared_ptr<DeltaSignature> CreateFromFile(const std::string& path);
+  static std::shared_ptr<DeltaSignature> Deserialize(std::shared_ptr<Data> data);
+  static uint32_t WeakChecksum(const unsigned char* data, uint32_t size);
+  static void StrongChecksum(const unsigned char* data, uint32_t size, unsigned char* out_hash);
+
+  DeltaSignature();
+  std::shared_ptr<Data> Serialize();
+  uint32_t GetBlockSize();
+  uint64_t GetBaseSize();
+  const std::vector<BlockInfo>& GetBlocks();
+  bool FindBlock(uint32_t weak, const unsigned char* data, uint32_t preferred_index, uint32_t& out_index);
+
+private:
+  void BuildIndex();
+
+  uint32_t _block_size;
+  uint64_t _base_size;
+  std::vector<BlockInfo> _blocks;
+  std::unordered_multimap<uint32_t, uint32_t> _weak_index;
+};
+
+class DeltaEncoder {
+public:
+  DeltaEncoder(std::shared_ptr<DeltaSignature> signature);
+  bool Open(const std::string& path);
+  std::shared_ptr<Data> ReadNextBlock(bool& out_is_last);
+  void GetFileHash(unsigned char* out_hash);
+  uint64_t GetCopiedSize();
+  uint64_t GetLiteralSize();
+  double GetCpuTime();
+
+private:
+  bool FillWindow();
+  void RollInit();
+  void Roll(unsigned char out, unsigned char in);
+  void FlushLiteral(uint32_t end, std::vector<unsigned char>& out_ops);
+  void FlushCopy(std::vector<unsigned char>& out_ops);
+
+  std::shared_ptr<DeltaSignature> _signature;
+  std::ifstream _file;
+  std::vector<unsigned char> _window;
+  uint32_t _window_pos;
+  uint32_t _literal_start;
+  bool _file_eof;
+  bool _finished;
+  bool _roll_valid;
+  uint32_t _roll_a;
+  uint32_t _roll_b;
+  uint32_t _copy_index;
+  uint32_t _copy_count;
+  uint64_t _copied_size;
+  uint64_t _literal_size;
+  double _cpu_time;
+  digestpp::md5 _file_hasher;
+};
+
+class DeltaDecoder {
+public:
+  DeltaDecoder(const std::string& base_path, const std::string& output_path);
+  bool Open(std::shared_ptr<DeltaSignature> signature);
+  std::shared_ptr<Data> Decode(std::shared_ptr<Data> ops);
+  bool Finish(const unsigned char* expected_hash);
+  uint64_t GetWireSize();
+  uint64_t GetOutputSize();
+  double GetCpuTime();
+
+private:
+  std::string _base_path;
+  std::string _output_path;
+  std::ifstream _base;
+  std::ofstream _output;
+  uint32_t _block_size;
+  uint64_t _base_size;
+  uint64_t _max_output; // bound on what one ops block may expand to
+  uint64_t _wire_size;
+  uint64_t _output_size;
+  double _cpu_time;
+  digestpp::md5 _file_hasher;
+};
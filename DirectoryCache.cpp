@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DirectoryCache.h"
+#include "DirectoryReader.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+const size_t DEFAULT_MAX_WATCHES = 128;
+const size_t DEFAULT_MAX_ENTRIES = 10000;
+const std::string MAX_WATCHES_ENV = "DIRECTORY_CACHE_MAX_WATCHES";
+const std::string MAX_ENTRIES_ENV = "DIRECTORY_CACHE_MAX_ENTRIES";
+const uint64_t STATS_LOG_INTERVAL = 100;
+const std::chrono::milliseconds SLOW_LISTING_TIME(100);
+const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+                            IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+
+DirectoryCache::DirectoryCache()
+    : _inotify_fd(-1)
+    , _max_watches(DEFAULT_MAX_WATCHES)
+    , _max_entries(DEFAULT_MAX_ENTRIES)
+    , _hits(0)
+    , _misses(0)
+    , _invalidations(0) {
+  char* max_watches = std::getenv(MAX_WATCHES_ENV.c_str());
+  if(max_watches) {
+    _max_watches = (size_t)std::strtoul(max_watches, nullptr, 10);
+  }
+  char* max_entries = std::getenv(MAX_ENTRIES_ENV.c_str());
+  if(max_entries) {
+    _max_entries = (size_t)std::strtoul(max_entries, nullptr, 10);
+  }
+}
+
+DirectoryCache::~DirectoryCache() {
+  if(_inotify_fd >= 0) {
+    close(_inotify_fd);
+  }
+}
+
+bool DirectoryCache::Init() {
+  if(!_max_watches) {
+    return false;
+  }
+  _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(_inotify_fd < 0) {
+    DLOG(warn, "DirectoryCache : inotify_init1 failed, cache disabled");
+    return false;
+  }
+  return true;
+}
+
+bool DirectoryCache::Load(const std::string& path, std::vector<DirectoryListing::FileInfo>& out_entries) {
+  if(_inotify_fd < 0) {
+    return false;
+  }
+
+  ProcessEvents();
+
+  auto it = _entries.find(path);
+  if(it != _entries.end()) {
+    _lru.splice(_lru.begin(), _lru, it->second._lru_it);
+    if(!it->second._is_complete) {
+      return false;
+    }
+    _hits++;
+    LogStats();
+    out_entries = it->second._entries;
+    return true;
+  }
+  _misses++;
+  LogStats();
+
+  while(_entries.size() >= _max_watches && !_lru.empty()) {
+    Erase(_entries.find(_lru.back()));
+  }
+
+  // watch first, so changes made while reading still invalidate the entry
+  int watch = inotify_add_watch(_inotify_fd, path.c_str(), WATCH_MASK);
+  if(watch < 0) {
+    return false;
+  }
+
+  Entry entry;
+  entry._watch = watch;
+  entry._is_complete = ReadDirectory(path, entry._entries);
+  if(!entry._is_complete) {
+    // too big to keep, remember that so the next visit streams right away
+    entry._entries.clear();
+  }
+  _lru.push_front(path);
+  entry._lru_it = _lru.begin();
+  _watches[watch].insert(path);
+  auto result = _entries.insert(std::make_pair(path, entry));
+
+  if(!result.first->second._is_complete) {
+    return false;
+  }
+  out_entries = result.first->second._entries;
+  return true;
+}
+
+bool DirectoryCache::IsCached(const std::string& path) {
+  ProcessEvents();
+  return _entries.find(path) != _entries.end();
+}
+
+size_t DirectoryCache::GetPrefetchBudget() {
+  return _max_watches / 2;
+}
+
+void DirectoryCache::LogStats() {
+  if((_hits + _misses) % STATS_LOG_INTERVAL) {
+    return;
+  }
+  DLOG(info, "DirectoryCache : entries : {}, hits : {}, misses : {}, invalidations : {}",
+             _entries.size(),
+             _hits,
+             _misses,
+             _invalidations);
+}
+
+void DirectoryCache::ProcessEvents() {
+  alignas(struct inotify_event) char buffer[4096];
+  while(true) {
+    ssize_t len = read(_inotify_fd, buffer, sizeof(buffer));
+    if(len <= 0) {
+      return;
+    }
+
+    for(char* ptr = buffer; ptr < buffer + len;) {
+      auto event = (struct inotify_event*)ptr;
+      ptr += sizeof(struct inotify_event) + event->len;
+
+      if(event->mask & IN_Q_OVERFLOW) {
+        DLOG(warn, "DirectoryCache : inotify queue overflow, dropping cache");
+        Clear();
+        continue;
+      }
+
+      auto watch_it = _watches.find(event->wd);
+      if(watch_it == _watches.end()) {
+        continue;
+      }
+      // copy, invalidation removes the watch
+      std::set<std::string> paths = watch_it->second;
+      for(auto& path : paths) {
+        Invalidate(path);
+      }
+    }
+  }
+}
+
+void DirectoryCache::Invalidate(const std::string& path) {
+  auto it = _entries.find(path);
+  if(it != _entries.end()) {
+    _invalidations++;
+    Erase(it);
+  }
+
+  // parent listing carries this directory's mtime
+  std::string parent = std::filesystem::path(path).parent_path().string();
+  if(!parent.empty() && parent != path) {
+    it = _entries.find(parent);
+    if(it != _entries.end()) {
+      _invalidations++;
+      Erase(it);
+    }
+  }
+}
+
+void DirectoryCache::Erase(std::map<std::string, Entry>::iterator it) {
+  if(it == _entries.end()) {
+    return;
+  }
+
+  auto watch_it = _watches.find(it->second._watch);
+  if(watch_it != _watches.end()) {
+    watch_it->second.erase(it->first);
+    if(watch_it->second.empty()) {
+      inotify_rm_watch(_inotify_fd, it->second._watch);
+      _watches.erase(watch_it);
+    }
+  }
+  _lru.erase(it->second._lru_it);
+  _entries.erase(it);
+}
+
+void DirectoryCache::Clear() {
+  for(auto& watch : _watches) {
+    inotify_rm_watch(_inotify_fd, watch.first);
+  }
+  _watches.clear();
+  _entries.clear();
+  _lru.clear();
+}
+
+bool DirectoryCache::ReadDirectory(const std::string& path, std::vector<DirectoryListing::FileInfo>& out_entries) {
+  auto start = std::chrono::steady_clock::now();
+  DirectoryReader reader;
+  if(!reader.Open(path)) {
+    return false;
+  }
+
+  // one over the limit tells a full directory from a too big one
+  if(reader.ReadNames(_max_entries + 1, out_entries) || out_entries.size() > _max_entries) {
+    return false;
+  }
+  reader.StatEntries(out_entries.begin(), out_entries.end());
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  if(elapsed >= SLOW_LISTING_TIME) {
+    DLOG(info, "DirectoryCache : listing {} entries of {} took {} ms", out_entries.size(), path, elapsed.count());
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "DirectoryListing.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class DirectoryCache {
+public:
+  DirectoryCache();
+  ~DirectoryCache();
+  bool Init();
+  bool Load(const std::string& path, std::vector<DirectoryListing::FileInfo>& out_entries);
+  bool IsCached(const std::string& path);
+  size_t GetPrefetchBudget();
+
+private:
+  struct Entry {
+    std::vector<DirectoryListing::FileInfo> _entries;
+    bool _is_complete;
+    int _watch;
+    std::list<std::string>::iterator _lru_it;
+  };
+
+  void LogStats();
+  void ProcessEvents();
+  void Invalidate(const std::string& path);
+  void Erase(std::map<std::string, Entry>::iterator it);
+  void Clear();
+  bool ReadDirectory(const std::string& path, std::vector<DirectoryListing::FileInfo>& out_entries);
+
+  int _inotify_fd;
+  size_t _max_watches;
+  size_t _max_entries;
+  std::map<std::string, Entry> _entries;
+  std::map<int, std::set<std::string>> _watches;
+  std::list<std::string> _lru;
+  uint64_t _hits;
+  uint64_t _misses;
+  uint64_t _invalidations;
+};
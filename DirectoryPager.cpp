@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DirectoryPager.h"
+#include "DirectoryCache.h"
+#include "DirectoryReader.h"
+#include "Data.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+const size_t READ_BATCH_SIZE = 4096;
+const uint8_t PAGE_FORMAT_VERSION = 1;
+
+
+DirectoryPager::DirectoryPager(const Options& options, std::shared_ptr<DirectoryCache> cache)
+    : _options(options)
+    , _cache(cache)
+    , _entries_pos(0)
+    , _is_buffered(false)
+    , _needs_stat(false)
+    , _last_used(std::chrono::steady_clock::now()) {
+  _lowercase_filter = options._filter;
+  std::transform(_lowercase_filter.begin(), _lowercase_filter.end(), _lowercase_filter.begin(), ::tolower);
+}
+
+bool DirectoryPager::Open() {
+  if(_cache && _cache->Load(_options._path, _entries)) {
+    _entries.erase(std::remove_if(_entries.begin(), _entries.end(),
+                                  std::bind(&DirectoryPager::IsFilteredOut, this, std::placeholders::_1)),
+                   _entries.end());
+    _is_buffered = true;
+    SortEntries();
+    return true;
+  }
+
+  _reader = std::make_shared<DirectoryReader>();
+  if(!_reader->Open(_options._path)) {
+    return false;
+  }
+
+  if(_options._sort != SortBy::NONE) {
+    // sorting needs the whole directory, only the output is paged
+    while(ReadFilteredNames(READ_BATCH_SIZE, _entries)) {
+    }
+    // names come with their type, only sorting by size or date needs stats up front
+    _needs_stat = (_options._sort == SortBy::NAME);
+    if(!_needs_stat) {
+      _reader->StatEntries(_entries.begin(), _entries.end());
+    }
+    _is_buffered = true;
+    SortEntries();
+  }
+  return true;
+}
+
+bool DirectoryPager::ReadPage(uint32_t max_entries, std::vector<DirectoryListing::FileInfo>& out_entries) {
+  _last_used = std::chrono::steady_clock::now();
+  size_t first = out_entries.size();
+
+  if(_is_buffered) {
+    size_t end = std::min(_entries.size(), _entries_pos + max_entries);
+    out_entries.insert(out_entries.end(), _entries.begin() + _entries_pos, _entries.begin() + end);
+    _entries_pos = end;
+    if(_needs_stat) {
+      _reader->StatEntries(out_entries.begin() + first, out_entries.end());
+    }
+    return _entries_pos < _entries.size();
+  }
+
+  bool has_more = true;
+  while(has_more && out_entries.size() - first < max_entries) {
+    has_more = ReadFilteredNames(max_entries - (out_entries.size() - first), out_entries);
+  }
+  _reader->StatEntries(out_entries.begin() + first, out_entries.end());
+  return has_more;
+}
+
+bool DirectoryPager::ReadFilteredNames(size_t max_entries, std::vector<DirectoryListing::FileInfo>& out_entries) {
+  size_t first = out_entries.size();
+  bool has_more = _reader->ReadNames(max_entries, out_entries);
+  out_entries.erase(std::remove_if(out_entries.begin() + first, out_entries.end(),
+                                   std::bind(&DirectoryPager::IsFilteredOut, this, std::placeholders::_1)),
+                    out_entries.end());
+  return has_more;
+}
+
+std::chrono::steady_clock::time_point DirectoryPager::GetLastUsed() {
+  return _last_used;
+}
+
+bool DirectoryPager::MatchesFilter(const std::string& name) {
+  if(_lowercase_filter.empty()) {
+    return true;
+  }
+  std::string lowercase_name = name;
+  std::transform(lowercase_name.begin(), lowercase_name.end(), lowercase_name.begin(), ::tolower);
+  return lowercase_name.find(_lowercase_filter) != std::string::npos;
+}
+
+bool DirectoryPager::IsFilteredOut(const DirectoryListing::FileInfo& info) {
+  return !MatchesFilter(info.name);
+}
+
+void DirectoryPager::SortEntries() {
+  if(_options._sort == SortBy::NONE) {
+    return;
+  }
+  auto sort_by = _options._sort;
+  bool descending = _options._descending;
+  std::sort(_entries.begin(), _entries.end(), [sort_by, descending](const DirectoryListing::FileInfo& first,
+                                                                  const DirectoryListing::FileInfo& second) {
+    const DirectoryListing::FileInfo& left = descending ? second : first;
+    const DirectoryListing::FileInfo& right = descending ? first : second;
+    switch(sort_by) {
+      case SortBy::SIZE:
+        if(left.size != right.size) {
+          return left.size < right.size;
+        }
+        break;
+      case SortBy::MODIFIED:
+        if(left.last_modified != right.last_modified) {
+          return left.last_modified < right.last_modified;
+        }
+        break;
+      default:
+        break;
+    }
+    return left.name < right.name;
+  });
+}
+
+std::shared_ptr<Data> DirectoryPager::SerializeOptions(const Options& options) {
+  uint16_t path_length = (uint16_t)std::min<size_t>(options._path.length(), UINT16_MAX);
+  uint8_t descending = options._descending;
+  auto data = std::make_shared<Data>(4 + 4 + 1 + 1 + 2 + path_length + options._filter.length());
+  data->Add(4, (unsigned char*)&options._cursor);
+  data->Add(4, (unsigned char*)&options._page_size);
+  data->Add(1, (unsigned char*)&options._sort);
+  data->Add(1, &descending);
+  data->Add(2, (unsigned char*)&path_length);
+  data->Add(path_length, (unsigned char*)options._path.c_str());
+  data->Add(options._filter);
+  return data;
+}
+
+bool DirectoryPager::DeserializeOptions(std::shared_ptr<Data> data, uint32_t offset, Options& out_options) {
+  uint8_t descending = 0;
+  uint16_t path_length = 0;
+  bool data_retrieved = true;
+
+  data_retrieved = data_retrieved && data->CopyTo(&out_options._cursor, offset, 4);
+  data_retrieved = data_retrieved && data->CopyTo(&out_options._page_size, offset + 4, 4);
+  data_retrieved = data_retrieved && data->CopyTo(&out_options._sort, offset + 8, 1);
+  data_retrieved = data_retrieved && data->CopyTo(&descending, offset + 9, 1);
+  data_retrieved = data_retrieved && data->CopyTo(&path_length, offset + 10, 2);
+  if(!data_retrieved || offset + 12 + path_length > data->GetCurrentSize()) {
+    return false;
+  }
+
+  const char* raw = (const char*)data->GetCurrentDataRaw() + offset + 12;
+  out_options._descending = descending;
+  out_options._path.assign(raw, path_length);
+  out_options._filter.assign(raw + path_length, data->GetCurrentSize() - offset - 12 - path_length);
+  return true;
+}
+
+std::shared_ptr<Data> DirectoryPager::SerializePage(const std::vector<DirectoryListing::FileInfo>& entries,
+                                                    bool prefix_compression) {
+  // [version1][flags1][count4][size8 * count][mtime4 * count][is_dir bitmap][names]
+  // a name is [len2][bytes], or [prefix1][len2][suffix] with PREFIX_COMPRESSED
+  uint32_t count = (uint32_t)entries.size();
+  uint8_t version = PAGE_FORMAT_VERSION;
+  uint8_t flags = prefix_compression ? PageFlags::PREFIX_COMPRESSED : 0;
+  size_t names_size = 0;
+  for(auto& info : entries) {
+    names_size += 3 + info.name.length();
+  }
+
+  auto data = std::make_shared<Data>(6 + count * 12 + (count + 7) / 8 + names_size);
+  data->Add(1, &version);
+  data->Add(1, &flags);
+  data->Add(4, (unsigned char*)&count);
+
+  for(auto& info : entries) {
+    uint64_t file_size = info.size;
+    data->Add(8, (unsigned char*)&file_size);
+  }
+  for(auto& info : entries) {
+    uint32_t last_modified = (uint32_t)std::min<uint64_t>(info.last_modified, UINT32_MAX);
+    data->Add(4, (unsigned char*)&last_modified);
+  }
+
+  std::vector<unsigned char> is_directory((count + 7) / 8, 0);
+  for(uint32_t i = 0; i < count; ++i) {
+    if(entries[i].is_directory) {
+      is_directory[i / 8] |= (1 << (i % 8));
+    }
+  }
+  data->Add(is_directory.size(), is_directory.data());
+
+  const std::string* previous = nullptr;
+  for(auto& info : entries) {
+    uint8_t prefix_length = 0;
+    if(prefix_compression && previous) {
+      size_t max_prefix = std::min<size_t>({previous->length(), info.name.length(), UINT8_MAX});
+      while(prefix_length < max_prefix && (*previous)[prefix_length] == info.name[prefix_length]) {
+        prefix_length++;
+      }
+      // keep utf-8 sequences whole, the browser decodes suffixes on their own
+      while(prefix_length && (info.name[prefix_length] & 0xC0) == 0x80) {
+        prefix_length--;
+      }
+    }
+    uint16_t suffix_length = (uint16_t)std::min<size_t>(info.name.length() - prefix_length, UINT16_MAX);
+    if(prefix_compression) {
+      data->Add(1, &prefix_length);
+    }
+    data->Add(2, (unsigned char*)&suffix_length);
+    data->Add(suffix_length, (unsigned char*)info.name.c_str() + prefix_length);
+    previous = &info.name;
+  }
+  return data;
+}
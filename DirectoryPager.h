@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "DirectoryListing.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Data;
+class DirectoryCache;
+class DirectoryReader;
+
+class DirectoryPager {
+public:
+  enum SortBy {
+    NONE = 0,
+    NAME,
+    SIZE,
+    MODIFIED
+  };
+
+  enum PageFlags {
+    PREFIX_COMPRESSED = 1 << 0
+  };
+
+  struct Options {
+    std::string _path;
+    std::string _filter;
+    uint32_t _cursor = 0;
+    uint32_t _page_size = 0;
+    uint8_t _sort = SortBy::NONE;
+    bool _descending = false;
+  };
+
+  DirectoryPager(const Options& options, std::shared_ptr<DirectoryCache> cache);
+  bool Open();
+  bool ReadPage(uint32_t max_entries, std::vector<DirectoryListing::FileInfo>& out_entries);
+  std::chrono::steady_clock::time_point GetLastUsed();
+
+  static std::shared_ptr<Data> SerializeOptions(const Options& options);
+  static bool DeserializeOptions(std::shared_ptr<Data> data, uint32_t offset, Options& out_options);
+  static std::shared_ptr<Data> SerializePage(const std::vector<DirectoryListing::FileInfo>& entries,
+                                             bool prefix_compression);
+
+private:
+  bool ReadFilteredNames(size_t max_entries, std::vector<DirectoryListing::FileInfo>& out_entries);
+  bool MatchesFilter(const std::string& name);
+  bool IsFilteredOut(const DirectoryListing::FileInfo& info);
+  void SortEntries();
+
+  Options _options;
+  std::shared_ptr<DirectoryCache> _cache;
+  std::string _lowercase_filter;
+  std::shared_ptr<DirectoryReader> _reader;
+  std::vector<DirectoryListing::FileInfo> _entries;
+  size_t _entries_pos;
+  bool _is_buffered;
+  bool _needs_stat;
+  std::chrono::steady_clock::time_point _last_used;
+};
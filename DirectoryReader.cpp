@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DirectoryReader.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+const size_t GETDENTS_BUFFER_SIZE = 256 * 1024;
+const size_t STAT_CHUNK_SIZE = 64;
+const size_t DEFAULT_STAT_THREADS = 8;
+const std::string STAT_THREADS_ENV = "DIRECTORY_STAT_THREADS";
+
+struct linux_dirent64 {
+  ino64_t d_ino;
+  off64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+namespace {
+
+std::shared_ptr<StatWorkers> CreateStatWorkers() {
+  size_t count = DEFAULT_STAT_THREADS;
+  char* threads = std::getenv(STAT_THREADS_ENV.c_str());
+  if(threads) {
+    count = (size_t)std::strtoul(threads, nullptr, 10);
+  }
+  if(!count) {
+    return nullptr;
+  }
+  return std::make_shared<StatWorkers>(count);
+}
+
+std::shared_ptr<StatWorkers> GetStatWorkers() {
+  static std::shared_ptr<StatWorkers> workers = CreateStatWorkers();
+  return workers;
+}
+
+} //namespace
+
+
+StatWorkers::StatWorkers(size_t count)
+    : _generation(0)
+    , _stop(false) {
+  for(size_t i = 0; i < count; ++i) {
+    _threads.emplace_back(&StatWorkers::WorkerLoop, this);
+  }
+}
+
+StatWorkers::~StatWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _work_cv.notify_all();
+  for(auto& thread : _threads) {
+    thread.join();
+  }
+}
+
+void StatWorkers::Run(size_t jobs, std::function<void(size_t)> job) {
+  std::lock_guard<std::mutex> run_lock(_run_mutex);
+  auto batch = std::make_shared<Batch>();
+  batch->_job = job;
+  batch->_count = jobs;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _batch = batch;
+    _generation++;
+  }
+  _work_cv.notify_all();
+
+  // caller takes jobs too, nothing is lost if workers are slow to wake up
+  Work(batch);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  while(batch->_completed < batch->_count) {
+    _done_cv.wait(lock);
+  }
+  _batch.reset();
+}
+
+void StatWorkers::WorkerLoop() {
+  uint64_t seen_generation = 0;
+  while(true) {
+    std::shared_ptr<Batch> batch;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while(!_stop && seen_generation == _generation) {
+        _work_cv.wait(lock);
+      }
+      if(_stop) {
+        return;
+      }
+      seen_generation = _generation;
+      batch = _batch;
+    }
+    if(batch) {
+      Work(batch);
+    }
+  }
+}
+
+void StatWorkers::Work(std::shared_ptr<Batch> batch) {
+  size_t index = 0;
+  while((index = batch->_next++) < batch->_count) {
+    batch->_job(index);
+    if(++batch->_completed == batch->_count) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _done_cv.notify_all();
+    }
+  }
+}
+
+
+DirectoryReader::DirectoryReader()
+    : _dir_fd(-1)
+    , _buffer_pos(0)
+    , _buffer_len(0)
+    , _is_eof(false) {
+}
+
+DirectoryReader::~DirectoryReader() {
+  if(_dir_fd >= 0) {
+    close(_dir_fd);
+  }
+}
+
+bool DirectoryReader::Open(const std::string& path) {
+  _dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if(_dir_fd < 0) {
+    DLOG(error, "DirectoryReader : can't open : {}", path);
+    return false;
+  }
+  _buffer.resize(GETDENTS_BUFFER_SIZE);
+  return true;
+}
+
+bool DirectoryReader::ReadNames(size_t max_entries, std::vector<DirectoryListing::FileInfo>& out_entries) {
+  size_t read_count = 0;
+  while(read_count < max_entries) {
+    if(_buffer_pos >= _buffer_len && !FillBuffer()) {
+      return false;
+    }
+
+    auto entry = (struct linux_dirent64*)(_buffer.data() + _buffer_pos);
+    _buffer_pos += entry->d_reclen;
+    if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+      continue;
+    }
+
+    DirectoryListing::FileInfo info;
+    info.name = entry->d_name;
+    info.is_directory = (entry->d_type == DT_DIR);
+    info.size = 0;
+    info.last_modified = 0;
+    out_entries.push_back(info);
+    read_count++;
+  }
+  return _buffer_pos < _buffer_len || FillBuffer();
+}
+
+void DirectoryReader::StatEntries(std::vector<DirectoryListing::FileInfo>::iterator begin,
+                                  std::vector<DirectoryListing::FileInfo>::iterator end) {
+  size_t count = end - begin;
+  size_t chunks = (count + STAT_CHUNK_SIZE - 1) / STAT_CHUNK_SIZE;
+  auto workers = GetStatWorkers();
+  if(!workers || chunks < 2) {
+    for(size_t chunk = 0; chunk < chunks; ++chunk) {
+      StatChunk(begin, count, chunk);
+    }
+    return;
+  }
+  workers->Run(chunks, std::bind(&DirectoryReader::StatChunk, this, begin, count, std::placeholders::_1));
+}
+
+bool DirectoryReader::FillBuffer() {
+  if(_is_eof || _dir_fd < 0) {
+    return false;
+  }
+  long len = syscall(SYS_getdents64, _dir_fd, _buffer.data(), _buffer.size());
+  if(len <= 0) {
+    if(len < 0) {
+      DLOG(warn, "DirectoryReader : getdents64 failed : {}", errno);
+    }
+    _is_eof = true;
+    return false;
+  }
+  _buffer_pos = 0;
+  _buffer_len = (size_t)len;
+  return true;
+}
+
+void DirectoryReader::StatChunk(std::vector<DirectoryListing::FileInfo>::iterator begin, size_t count, size_t chunk) {
+  size_t first = chunk * STAT_CHUNK_SIZE;
+  size_t last = std::min(count, first + STAT_CHUNK_SIZE);
+  for(size_t i = first; i < last; ++i) {
+    StatEntry(*(begin + i));
+  }
+}
+
+void DirectoryReader::StatEntry(DirectoryListing::FileInfo& info) {
+  struct statx stx;
+  // type from d_type is enough for directories, other entries may be links
+  unsigned int mask = info.is_directory ? STATX_MTIME : (STATX_TYPE | STATX_SIZE | STATX_MTIME);
+  if(statx(_dir_fd, info.name.c_str(), AT_STATX_SYNC_AS_STAT, mask, &stx)) {
+    return;
+  }
+
+  if(stx.stx_mask & STATX_TYPE) {
+    info.is_directory = S_ISDIR(stx.stx_mode);
+  }
+  if(!info.is_directory && (stx.stx_mask & STATX_SIZE)) {
+    info.size = stx.stx_size;
+  }
+  if(stx.stx_mask & STATX_MTIME) {
+    info.last_modified = (uint64_t)stx.stx_mtime.tv_sec;
+  }
+}
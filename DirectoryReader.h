@@ -0,0 +1,83 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "DirectoryListing.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StatWorkers {
+public:
+  StatWorkers(size_t count);
+  ~StatWorkers();
+  void Run(size_t jobs, std::function<void(size_t)> job);
+
+private:
+  struct Batch {
+    std::function<void(size_t)> _job;
+    size_t _count = 0;
+    std::atomic<size_t> _next{0};
+    std::atomic<size_t> _completed{0};
+  };
+
+  void WorkerLoop();
+  void Work(std::shared_ptr<Batch> batch);
+
+  std::mutex _run_mutex;
+  std::mutex _mutex;
+  std::condition_variable _work_cv;
+  std::condition_variable _done_cv;
+  std::vector<std::thread> _threads;
+  std::shared_ptr<Batch> _batch;
+  uint64_t _generation;
+  bool _stop;
+};
+
+class DirectoryReader {
+public:
+  DirectoryReader();
+  ~DirectoryReader();
+  bool Open(const std::string& path);
+  bool ReadNames(size_t max_entries, std::vector<DirectoryListing::FileInfo>& out_entries);
+  void StatEntries(std::vector<DirectoryListing::FileInfo>::iterator begin,
+                   std::vector<DirectoryListing::FileInfo>::iterator end);
+
+private:
+  bool FillBuffer();
+  void StatChunk(std::vector<DirectoryListing::FileInfo>::iterator begin, size_t count, size_t chunk);
+  void StatEntry(DirectoryListing::FileInfo& info);
+
+  int _dir_fd;
+  std::vector<char> _buffer;
+  size_t _buffer_pos;
+  size_t _buffer_len;
+  bool _is_eof;
+};
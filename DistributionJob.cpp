@@ -0,0 +1,372 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DistributionJob.h"
+#include "Server.h"
+#include "SimpleMessage.h"
+#include "MessageType.h"
+#include "Data.h"
+#include "DataResource.h"
+#include "Logger.h"
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char* MEMBER_STATE_NAMES[] = {"pending", "started", "relaying", "done", "failed"};
+
+
+DistributionJob::DistributionJob(uint32_t job_id,
+                                 const std::string& source_path,
+                                 const std::string& dest_path,
+                                 uint32_t fanout,
+                                 std::shared_ptr<Server> proxy_server)
+    : _job_id(job_id)
+    , _source_path(source_path)
+    , _dest_path(dest_path)
+    , _fanout(std::max<uint32_t>(1, fanout))
+    , _proxy_server(proxy_server)
+    , _fd(-1)
+    , _finished_members(0) {
+}
+
+DistributionJob::~DistributionJob() {
+  if(_fd >= 0) {
+    close(_fd);
+  }
+}
+
+bool DistributionJob::Init(const std::vector<uint32_t>& host_ids) {
+  if(host_ids.empty()) {
+    DLOG(error, "DistributionJob : no hosts");
+    return false;
+  }
+  _fd = open(_source_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(_fd < 0) {
+    DLOG(error, "DistributionJob : can't open : {}", _source_path);
+    return false;
+  }
+
+  for(size_t i = 0; i < host_ids.size(); ++i) {
+    Member member;
+    member._host_id = host_ids[i];
+    member._parent = i < _fanout ? -1 : (int)(i / _fanout) - 1;
+    _members.push_back(member);
+  }
+  _start_time = std::chrono::steady_clock::now();
+  return true;
+}
+
+bool DistributionJob::Prepare() {
+  // hashes the whole file, called on a file thread
+  DistributionManifest manifest;
+  if(!manifest.Build(_source_path)) {
+    return false;
+  }
+  auto manifest_data = manifest.Serialize();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _manifest = manifest;
+  _manifest_data = manifest_data;
+  return true;
+}
+
+void DistributionJob::Start() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  DLOG(info, "DistributionJob : job {} : {} ({} bytes, {} chunks) to {} hosts, fanout {}",
+       _job_id, _source_path, _manifest.GetFileSize(), _manifest.GetChunkCount(), _members.size(), _fanout);
+
+  for(size_t i = 0; i < _members.size() && i < _fanout; ++i) {
+    // hosts may have gone while the manifest was built
+    if(_members[i]._state == MemberState::PENDING) {
+      SendJob(i, "", 0);
+    }
+  }
+}
+
+void DistributionJob::Fail() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  DLOG(error, "DistributionJob : job {} : can't prepare : {}", _job_id, _source_path);
+  for(auto& member : _members) {
+    if(member._state != MemberState::FAILED) {
+      member._state = MemberState::FAILED;
+      member._released = true;
+      ++_finished_members;
+    }
+  }
+  _end_time = std::chrono::steady_clock::now();
+}
+
+uint32_t DistributionJob::GetId() {
+  return _job_id;
+}
+
+bool DistributionJob::IsFinished() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _finished_members == _members.size();
+}
+
+int DistributionJob::FindMember(uint32_t host_id) {
+  for(size_t i = 0; i < _members.size(); ++i) {
+    if(_members[i]._host_id == host_id) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+std::vector<size_t> DistributionJob::GetChildren(size_t index) {
+  std::vector<size_t> children;
+  for(size_t i = 0; i < _fanout; ++i) {
+    size_t child = (index + 1) * _fanout + i;
+    if(child >= _members.size()) {
+      break;
+    }
+    children.push_back(child);
+  }
+  return children;
+}
+
+bool DistributionJob::IsMemberFinished(size_t index) {
+  return _members[index]._state == MemberState::DONE || _members[index]._state == MemberState::FAILED;
+}
+
+void DistributionJob::SendJob(size_t index, const std::string& parent_host, uint16_t parent_port) {
+  Member& member = _members[index];
+  member._state = MemberState::STARTED;
+
+  uint16_t children = (uint16_t)GetChildren(index).size();
+  uint16_t host_len = (uint16_t)parent_host.size();
+  uint16_t path_len = (uint16_t)_dest_path.size();
+
+  auto data = std::make_shared<Data>(14 + host_len + path_len + _manifest_data->GetCurrentSize());
+  data->Add(4, (unsigned char*)&_job_id);
+  data->Add(2, (unsigned char*)&children);
+  data->Add(2, (unsigned char*)&parent_port);
+  data->Add(2, (unsigned char*)&host_len);
+  data->Add(parent_host);
+  data->Add(2, (unsigned char*)&path_len);
+  data->Add(_dest_path);
+  data->Add(_manifest_data->GetCurrentSize(), _manifest_data->GetCurrentDataRaw());
+
+  SendToHost(member._host_id, std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_JOB, std::make_shared<DataResource>(data)));
+}
+
+void DistributionJob::SendToHost(uint32_t host_id, std::shared_ptr<Message> msg) {
+  auto host_client = _proxy_server->GetClient(host_id);
+  if(!host_client) {
+    DLOG(warn, "DistributionJob : host doesn't exist : {}", host_id);
+    return;
+  }
+  host_client->Send(msg);
+}
+
+void DistributionJob::StartChildren(size_t index, const std::string& parent_host, uint16_t parent_port) {
+  for(size_t child : GetChildren(index)) {
+    if(_members[child]._state == MemberState::PENDING) {
+      SendJob(child, parent_host, parent_port);
+    }
+  }
+}
+
+void DistributionJob::OnMemberReady(uint32_t host_id, uint16_t relay_port) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  int index = FindMember(host_id);
+  if(index < 0 || _members[index]._state != MemberState::STARTED) {
+    return;
+  }
+
+  auto host_client = _proxy_server->GetClient(host_id);
+  if(!relay_port || !host_client) {
+    StartChildren((size_t)index, "", 0);
+    return;
+  }
+  _members[index]._state = MemberState::RELAYING;
+  StartChildren((size_t)index, host_client->GetIp(), relay_port);
+}
+
+void DistributionJob::OnMemberProgress(uint32_t host_id, uint32_t chunks_done) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  int index = FindMember(host_id);
+  if(index >= 0) {
+    _members[index]._chunks_done = chunks_done;
+  }
+}
+
+void DistributionJob::OnMemberDone(uint32_t host_id, bool success) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  int index = FindMember(host_id);
+  if(index < 0 || IsMemberFinished((size_t)index)) {
+    return;
+  }
+  OnMemberFinished((size_t)index, success);
+}
+
+void DistributionJob::OnHostClosed(uint32_t host_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  int index = FindMember(host_id);
+  if(index < 0 || IsMemberFinished((size_t)index)) {
+    return;
+  }
+  _members[index]._released = true;
+  OnMemberFinished((size_t)index, false);
+}
+
+void DistributionJob::OnMemberFinished(size_t index, bool success) {
+  Member& member = _members[index];
+  member._state = success ? MemberState::DONE : MemberState::FAILED;
+  if(success) {
+    member._chunks_done = _manifest.GetChunkCount();
+  } else {
+    DLOG(warn, "DistributionJob : job {} : host {} failed", _job_id, member._host_id);
+  }
+
+  // children not started yet won't get a relay from this host anymore
+  StartChildren(index, "", 0);
+  TryRelease(index);
+  if(member._parent >= 0) {
+    TryRelease((size_t)member._parent);
+  }
+
+  if(++_finished_members == _members.size()) {
+    _end_time = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(_end_time - _start_time).count();
+    size_t failed = 0;
+    for(auto& finished_member : _members) {
+      failed += finished_member._state == MemberState::FAILED ? 1 : 0;
+    }
+    DLOG(info, "DistributionJob : job {} : finished in {} ms, {} hosts, {} failed",
+         _job_id, elapsed, _members.size(), failed);
+    _peers.clear();
+  }
+}
+
+void DistributionJob::TryRelease(size_t index) {
+  Member& member = _members[index];
+  if(member._released || !IsMemberFinished(index)) {
+    return;
+  }
+  for(size_t child : GetChildren(index)) {
+    if(!IsMemberFinished(child)) {
+      return;
+    }
+  }
+
+  // relay is no longer needed once all of its children are done
+  member._released = true;
+  auto data = std::make_shared<Data>(4, (unsigned char*)&_job_id);
+  SendToHost(member._host_id, std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_RELEASE, std::make_shared<DataResource>(data)));
+
+  if(member._parent >= 0) {
+    TryRelease((size_t)member._parent);
+  }
+}
+
+std::string DistributionJob::GetStatus() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto end_time = _finished_members == _members.size() ? _end_time : std::chrono::steady_clock::now();
+  auto jobj = nlohmann::json::object();
+  auto hosts = nlohmann::json::array();
+  size_t done = 0;
+  size_t failed = 0;
+
+  for(auto& member : _members) {
+    auto host = nlohmann::json::object();
+    host["host_id"] = member._host_id;
+    host["parent_host_id"] = member._parent < 0 ? 0 : _members[member._parent]._host_id;
+    host["state"] = MEMBER_STATE_NAMES[member._state];
+    host["chunks_done"] = member._chunks_done;
+    hosts.push_back(host);
+    done += member._state == MemberState::DONE ? 1 : 0;
+    failed += member._state == MemberState::FAILED ? 1 : 0;
+  }
+
+  jobj["job_id"] = _job_id;
+  jobj["source"] = _source_path;
+  jobj["path"] = _dest_path;
+  jobj["size"] = _manifest.GetFileSize();
+  jobj["chunks"] = _manifest.GetChunkCount();
+  jobj["fanout"] = _fanout;
+  jobj["done"] = done;
+  jobj["failed"] = failed;
+  jobj["finished"] = _finished_members == _members.size();
+  jobj["elapsed_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - _start_time).count();
+  jobj["hosts"] = hosts;
+  return jobj.dump();
+}
+
+void DistributionJob::AddPeer(std::shared_ptr<Client> client) {
+  client->SetManager(shared_from_this());
+  std::lock_guard<std::mutex> lock(_mutex);
+  _peers.push_back(client);
+}
+
+std::shared_ptr<Message> DistributionJob::ReadChunkMsg(std::shared_ptr<Data> req_data) {
+  uint32_t index = 0;
+  if(!req_data->CopyTo(&index, 0, 4) || index >= _manifest.GetChunkCount()) {
+    DLOG(error, "DistributionJob : invalid chunk request");
+    return nullptr;
+  }
+
+  uint32_t chunk_size = _manifest.GetChunkSize(index);
+  std::vector<unsigned char> buffer(chunk_size);
+  off_t chunk_offset = (off_t)index * DistributionManifest::CHUNK_SIZE;
+  if(pread(_fd, buffer.data(), chunk_size, chunk_offset) != (ssize_t)chunk_size) {
+    DLOG(error, "DistributionJob : read failed : {}", _source_path);
+    return nullptr;
+  }
+
+  auto data = std::make_shared<Data>(4 + chunk_size);
+  data->Add(4, (unsigned char*)&index);
+  data->Add(chunk_size, buffer.data());
+  return std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_CHUNK, std::make_shared<DataResource>(data));
+}
+
+void DistributionJob::OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) {
+  std::shared_ptr<SimpleMessage> simple_msg = std::static_pointer_cast<SimpleMessage>(msg);
+  auto msg_content = simple_msg->GetContent();
+  if(!msg_content->IsCompleted()) {
+    return;
+  }
+  if(MessageType::TypeFromInt(simple_msg->GetHeader()->_type) != MessageType::DIST_CHUNK_REQ) {
+    DLOG(warn, "DistributionJob : unexpected message type : {}", simple_msg->GetHeader()->_type);
+    return;
+  }
+  auto chunk_msg = ReadChunkMsg(msg_content->GetMemCache());
+  if(chunk_msg) {
+    client->Send(chunk_msg);
+  }
+}
+
+bool DistributionJob::OnClientConnecting(std::shared_ptr<Client> client, NetError err) {
+  return err == NetError::OK;
+}
+
+void DistributionJob::OnClientConnected(std::shared_ptr<Client> client) {
+}
+
+void DistributionJob::OnClientClosed(std::shared_ptr<Client> client) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _peers.erase(std::remove(_peers.begin(), _peers.end(), client), _peers.end());
+}
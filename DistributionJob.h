@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Client.h"
+#include "FileDistribution.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Data;
+class Server;
+
+/*
+ Server side of a file distribution job. Hosts form a tree with <fanout> children per node, the server being
+ the root. The server sends the job to the first level, every host that opens a relay gets its children
+ assigned to it. Hosts without a working parent pull from the server, which serves chunks to all joined peers.
+*/
+class DistributionJob
+    : public ClientManager
+    , public std::enable_shared_from_this<DistributionJob> {
+public:
+  enum MemberState {
+    PENDING = 0,
+    STARTED,
+    RELAYING,
+    DONE,
+    FAILED
+  };
+
+  DistributionJob(uint32_t job_id,
+                  const std::string& source_path,
+                  const std::string& dest_path,
+                  uint32_t fanout,
+                  std::shared_ptr<Server> proxy_server);
+  ~DistributionJob();
+  bool Init(const std::vector<uint32_t>& host_ids);
+  bool Prepare();
+  void Start();
+  void Fail();
+  uint32_t GetId();
+  bool IsFinished();
+  std::string GetStatus();
+
+  void AddPeer(std::shared_ptr<Client> client);
+  void OnMemberReady(uint32_t host_id, uint16_t relay_port);
+  void OnMemberProgress(uint32_t host_id, uint32_t chunks_done);
+  void OnMemberDone(uint32_t host_id, bool success);
+  void OnHostClosed(uint32_t host_id);
+
+  void OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) override;
+  bool OnClientConnecting(std::shared_ptr<Client> client, NetError err) override;
+  void OnClientConnected(std::shared_ptr<Client> client) override;
+  void OnClientClosed(std::shared_ptr<Client> client) override;
+
+private:
+  struct Member {
+    uint32_t _host_id = 0;
+    int _parent = -1;
+    MemberState _state = PENDING;
+    uint32_t _chunks_done = 0;
+    bool _released = false;
+  };
+
+  int FindMember(uint32_t host_id);
+  std::vector<size_t> GetChildren(size_t index);
+  bool IsMemberFinished(size_t index);
+  void StartChildren(size_t index, const std::string& parent_host, uint16_t parent_port);
+  void SendJob(size_t index, const std::string& parent_host, uint16_t parent_port);
+  void SendToHost(uint32_t host_id, std::shared_ptr<Message> msg);
+  void OnMemberFinished(size_t index, bool success);
+  void TryRelease(size_t index);
+  std::shared_ptr<Message> ReadChunkMsg(std::shared_ptr<Data> req_data);
+
+  uint32_t _job_id;
+  std::string _source_path;
+  std::string _dest_path;
+  uint32_t _fanout;
+  std::shared_ptr<Server> _proxy_server;
+  DistributionManifest _manifest;
+  std::shared_ptr<Data> _manifest_data;
+  int _fd;
+
+  std::mutex _mutex;
+  std::vector<Member> _members;
+  size_t _finished_members;
+  std::vector<std::shared_ptr<Client>> _peers;
+  std::chrono::steady_clock::time_point _start_time;
+  std::chrono::steady_clock::time_point _end_time;
+};
@@ -0,0 +1,458 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DistributionNode.h"
+#include "Connection.h"
+#include "Server.h"
+#include "SimpleMessage.h"
+#include "MessageType.h"
+#include "Data.h"
+#include "DataResource.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t REQUEST_WINDOW = 8;
+const uint32_t MAX_CHUNK_FAILURES = 3;
+const uint32_t PROGRESS_STEPS = 100;
+const int DEFAULT_RELAY_PORT = 4477;
+const int RELAY_PORT_RANGE = 64;
+const std::string RELAY_PORT_ENV = "DISTRIBUTION_RELAY_PORT";
+const std::string PART_FILE_SUFFIX = ".part";
+
+
+DistributionNode::Upstream::Upstream(std::weak_ptr<DistributionNode> node)
+    : _node(node) {
+}
+
+void DistributionNode::Upstream::OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) {
+  auto node = _node.lock();
+  std::shared_ptr<SimpleMessage> simple_msg = std::static_pointer_cast<SimpleMessage>(msg);
+  auto msg_content = simple_msg->GetContent();
+  if(!node || !msg_content->IsCompleted()) {
+    return;
+  }
+  if(MessageType::TypeFromInt(simple_msg->GetHeader()->_type) == MessageType::DIST_CHUNK) {
+    node->OnUpstreamRead(this, msg_content->GetMemCache());
+  }
+}
+
+bool DistributionNode::Upstream::OnClientConnecting(std::shared_ptr<Client> client, NetError err) {
+  if(err != NetError::OK) {
+    OnClientClosed(client);
+    return false;
+  }
+  auto msg_builder = std::unique_ptr<SimpleMessageBuilder>(new SimpleMessageBuilder());
+  client->SetMsgBuilder(std::move(msg_builder));
+  return true;
+}
+
+void DistributionNode::Upstream::OnClientConnected(std::shared_ptr<Client> client) {
+  auto node = _node.lock();
+  if(node) {
+    node->OnUpstreamConnected(this, client);
+  }
+}
+
+void DistributionNode::Upstream::OnClientClosed(std::shared_ptr<Client> client) {
+  auto node = _node.lock();
+  if(node) {
+    node->OnUpstreamClosed(this);
+  }
+}
+
+
+std::shared_ptr<DistributionNode> DistributionNode::Create(std::weak_ptr<DistributionNodeListener> listener,
+                                                           std::shared_ptr<Connection> connection,
+                                                           const std::string& server_host,
+                                                           int server_port,
+                                                           std::shared_ptr<Data> job_data) {
+  std::shared_ptr<DistributionNode> node(new DistributionNode(listener, connection, server_host, server_port));
+  if(!node->ParseJob(job_data)) {
+    DLOG(error, "DistributionNode : job data error");
+    return nullptr;
+  }
+  return node;
+}
+
+DistributionNode::DistributionNode(std::weak_ptr<DistributionNodeListener> listener,
+                                   std::shared_ptr<Connection> connection,
+                                   const std::string& server_host,
+                                   int server_port)
+    : _listener(listener)
+    , _connection(connection)
+    , _server_host(server_host)
+    , _server_port(server_port)
+    , _job_id(0)
+    , _children(0)
+    , _parent_port(0)
+    , _fd(-1)
+    , _chunks_done(0)
+    , _next_request(0)
+    , _chunk_failures(0)
+    , _reported_chunks(0)
+    , _finished(false) {
+}
+
+bool DistributionNode::ParseJob(std::shared_ptr<Data> job_data) {
+  uint16_t host_len = 0;
+  uint16_t path_len = 0;
+  uint32_t offset = 10;
+  bool data_retrieved = true;
+
+  data_retrieved = data_retrieved && job_data->CopyTo(&_job_id, 0, 4);
+  data_retrieved = data_retrieved && job_data->CopyTo(&_children, 4, 2);
+  data_retrieved = data_retrieved && job_data->CopyTo(&_parent_port, 6, 2);
+  data_retrieved = data_retrieved && job_data->CopyTo(&host_len, 8, 2);
+  if(data_retrieved && host_len) {
+    _parent_host.resize(host_len);
+    data_retrieved = job_data->CopyTo(&_parent_host[0], offset, host_len);
+  }
+  offset += host_len;
+  data_retrieved = data_retrieved && job_data->CopyTo(&path_len, offset, 2);
+  offset += 2;
+  if(data_retrieved && path_len) {
+    _path.resize(path_len);
+    data_retrieved = job_data->CopyTo(&_path[0], offset, path_len);
+  }
+  offset += path_len;
+
+  return data_retrieved && !_path.empty() && _manifest.Deserialize(job_data, offset);
+}
+
+uint32_t DistributionNode::GetJobId() {
+  return _job_id;
+}
+
+void DistributionNode::Start() {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  std::string part_path = _path + PART_FILE_SUFFIX;
+  _fd = open(part_path.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+  if(_fd < 0 || ftruncate(_fd, (off_t)_manifest.GetFileSize())) {
+    DLOG(error, "DistributionNode : can't create : {}", part_path);
+    Fail();
+    return;
+  }
+  _received.assign(_manifest.GetChunkCount(), false);
+
+  DLOG(info, "DistributionNode : job {} : {} bytes to {}, parent : {}:{}, children : {}",
+       _job_id, _manifest.GetFileSize(), _path,
+       _parent_host.empty() ? _server_host : _parent_host,
+       _parent_host.empty() ? _server_port : (int)_parent_port,
+       _children);
+
+  if(_children) {
+    uint16_t relay_port = StartRelay();
+    if(auto listener = _listener.lock()) {
+      listener->OnDistributionRelayReady(shared_from_this(), relay_port);
+    }
+  }
+
+  if(!_manifest.GetChunkCount()) {
+    Complete();
+    return;
+  }
+  ConnectUpstream();
+}
+
+uint16_t DistributionNode::StartRelay() {
+  int base_port = DEFAULT_RELAY_PORT;
+  char* port_env = std::getenv(RELAY_PORT_ENV.c_str());
+  if(port_env) {
+    base_port = std::atoi(port_env);
+  }
+
+  // several clients may run on one host, each takes the first free port
+  for(int port = base_port; port > 0 && port < base_port + RELAY_PORT_RANGE && port <= 0xFFFF; ++port) {
+    _relay = _connection->CreateServer(port, shared_from_this());
+    if(_relay) {
+      return (uint16_t)port;
+    }
+  }
+  DLOG(warn, "DistributionNode : no free relay port from {}, children will use the server", base_port);
+  return 0;
+}
+
+void DistributionNode::Release() {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  _relay.reset();
+  _downstream.clear();
+  _waiting.clear();
+  _upstream.reset();
+  _upstream_link.reset();
+  if(_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+}
+
+void DistributionNode::ConnectUpstream() {
+  _upstream.reset();
+  _upstream_link = std::make_shared<Upstream>(shared_from_this());
+  _requested.clear();
+  _next_request = 0;
+  _chunk_failures = 0;
+
+  if(_parent_host.empty()) {
+    _connection->CreateClient(_server_port, _server_host, _upstream_link);
+  } else {
+    _connection->CreateClient(_parent_port, _parent_host, _upstream_link);
+  }
+}
+
+void DistributionNode::OnUpstreamConnected(Upstream* link, std::shared_ptr<Client> client) {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  if(link != _upstream_link.get() || _finished) {
+    return;
+  }
+  _upstream = client;
+
+  auto data = std::make_shared<Data>(4, (unsigned char*)&_job_id);
+  _upstream->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_JOIN, std::make_shared<DataResource>(data)));
+  RequestChunks();
+}
+
+void DistributionNode::OnUpstreamClosed(Upstream* link) {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  if(link != _upstream_link.get() || _finished) {
+    return;
+  }
+  if(_parent_host.empty()) {
+    DLOG(error, "DistributionNode : job {} : lost connection to server", _job_id);
+    Fail();
+    return;
+  }
+  DLOG(warn, "DistributionNode : job {} : parent {} lost, pulling from server", _job_id, _parent_host);
+  _parent_host.clear();
+  ConnectUpstream();
+}
+
+void DistributionNode::OnUpstreamRead(Upstream* link, std::shared_ptr<Data> data) {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  if(link != _upstream_link.get() || _finished) {
+    return;
+  }
+
+  uint32_t index = 0;
+  if(!data->CopyTo(&index, 0, 4)) {
+    DLOG(error, "DistributionNode : chunk data error");
+    return;
+  }
+  data->SetOffset(4);
+
+  auto requested_it = std::find(_requested.begin(), _requested.end(), index);
+  if(requested_it == _requested.end()) {
+    return;
+  }
+
+  if(!_manifest.VerifyChunk(index, data->GetCurrentDataRaw(), data->GetCurrentSize())) {
+    DLOG(warn, "DistributionNode : job {} : corrupted chunk {}", _job_id, index);
+    if(++_chunk_failures > MAX_CHUNK_FAILURES && !_parent_host.empty()) {
+      _parent_host.clear();
+      ConnectUpstream();
+      return;
+    }
+    if(_chunk_failures > MAX_CHUNK_FAILURES) {
+      Fail();
+      return;
+    }
+    auto req_data = std::make_shared<Data>(4, (unsigned char*)&index);
+    _upstream->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_CHUNK_REQ, std::make_shared<DataResource>(req_data)));
+    return;
+  }
+
+  off_t chunk_offset = (off_t)index * DistributionManifest::CHUNK_SIZE;
+  if(pwrite(_fd, data->GetCurrentDataRaw(), data->GetCurrentSize(), chunk_offset) != (ssize_t)data->GetCurrentSize()) {
+    DLOG(error, "DistributionNode : job {} : write failed : {}", _job_id, _path);
+    Fail();
+    return;
+  }
+
+  _requested.erase(requested_it);
+  _received[index] = true;
+  ++_chunks_done;
+
+  auto waiting_it = _waiting.find(index);
+  if(waiting_it != _waiting.end()) {
+    auto msg = ReadChunkMsg(index);
+    for(auto& child : waiting_it->second) {
+      if(!msg) {
+        break;
+      }
+      child->Send(msg);
+    }
+    _waiting.erase(waiting_it);
+  }
+
+  uint32_t progress_step = std::max<uint32_t>(1, _manifest.GetChunkCount() / PROGRESS_STEPS);
+  if(_chunks_done - _reported_chunks >= progress_step && _chunks_done < _manifest.GetChunkCount()) {
+    _reported_chunks = _chunks_done;
+    if(auto listener = _listener.lock()) {
+      listener->OnDistributionProgress(shared_from_this(), _chunks_done);
+    }
+  }
+
+  if(_chunks_done == _manifest.GetChunkCount()) {
+    Complete();
+    return;
+  }
+  RequestChunks();
+}
+
+void DistributionNode::RequestChunks() {
+  if(!_upstream) {
+    return;
+  }
+  while(_requested.size() < REQUEST_WINDOW && _next_request < _manifest.GetChunkCount()) {
+    uint32_t index = _next_request++;
+    if(_received[index]) {
+      continue;
+    }
+    _requested.push_back(index);
+    auto data = std::make_shared<Data>(4, (unsigned char*)&index);
+    _upstream->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_CHUNK_REQ, std::make_shared<DataResource>(data)));
+  }
+}
+
+std::shared_ptr<Message> DistributionNode::ReadChunkMsg(uint32_t index) {
+  uint32_t chunk_size = _manifest.GetChunkSize(index);
+  auto data = std::make_shared<Data>(4 + chunk_size);
+  data->Add(4, (unsigned char*)&index);
+
+  std::vector<unsigned char> buffer(chunk_size);
+  off_t chunk_offset = (off_t)index * DistributionManifest::CHUNK_SIZE;
+  if(pread(_fd, buffer.data(), chunk_size, chunk_offset) != (ssize_t)chunk_size) {
+    DLOG(error, "DistributionNode : job {} : read failed : {}", _job_id, _path);
+    return nullptr;
+  }
+  data->Add(chunk_size, buffer.data());
+  return std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_CHUNK, std::make_shared<DataResource>(data));
+}
+
+void DistributionNode::Complete() {
+  _finished = true;
+  _upstream.reset();
+  _upstream_link.reset();
+
+  std::string part_path = _path + PART_FILE_SUFFIX;
+  bool success = _manifest.VerifyFile(_fd);
+  if(!success) {
+    DLOG(error, "DistributionNode : job {} : file checksum mismatch", _job_id);
+  } else if(std::rename(part_path.c_str(), _path.c_str())) {
+    DLOG(error, "DistributionNode : job {} : can't rename {}", _job_id, part_path);
+    success = false;
+  }
+
+  if(!success) {
+    Fail();
+    return;
+  }
+
+  DLOG(info, "DistributionNode : job {} : completed {}", _job_id, _path);
+  if(auto listener = _listener.lock()) {
+    listener->OnDistributionDone(shared_from_this(), true);
+  }
+}
+
+void DistributionNode::Fail() {
+  _finished = true;
+  _relay.reset();
+  _downstream.clear();
+  _waiting.clear();
+  _upstream.reset();
+  _upstream_link.reset();
+  if(_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+    std::remove((_path + PART_FILE_SUFFIX).c_str());
+  }
+  if(auto listener = _listener.lock()) {
+    listener->OnDistributionDone(shared_from_this(), false);
+  }
+}
+
+void DistributionNode::OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) {
+  std::shared_ptr<SimpleMessage> simple_msg = std::static_pointer_cast<SimpleMessage>(msg);
+  auto msg_content = simple_msg->GetContent();
+  if(!msg_content->IsCompleted()) {
+    return;
+  }
+
+  switch(MessageType::TypeFromInt(simple_msg->GetHeader()->_type)) {
+    case MessageType::DIST_JOIN:
+      {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _downstream.push_back(client);
+      }
+      break;
+    case MessageType::DIST_CHUNK_REQ:
+      HandleChunkRequest(client, msg_content->GetMemCache());
+      break;
+    default:
+      DLOG(warn, "DistributionNode : unexpected message type : {}", simple_msg->GetHeader()->_type);
+      break;
+  }
+}
+
+void DistributionNode::HandleChunkRequest(std::shared_ptr<Client> client, std::shared_ptr<Data> data) {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  uint32_t index = 0;
+  if(!data->CopyTo(&index, 0, 4) || index >= _received.size() || _fd < 0) {
+    DLOG(error, "DistributionNode : invalid chunk request");
+    return;
+  }
+
+  // children pull right behind us, a chunk not received yet is sent as soon as it's verified
+  if(!_received[index]) {
+    _waiting[index].push_back(client);
+    return;
+  }
+  auto msg = ReadChunkMsg(index);
+  if(msg) {
+    client->Send(msg);
+  }
+}
+
+bool DistributionNode::OnClientConnecting(std::shared_ptr<Client> client, NetError err) {
+  if(err != NetError::OK) {
+    return false;
+  }
+  auto msg_builder = std::unique_ptr<SimpleMessageBuilder>(new SimpleMessageBuilder());
+  client->SetMsgBuilder(std::move(msg_builder));
+  return true;
+}
+
+void DistributionNode::OnClientConnected(std::shared_ptr<Client> client) {
+}
+
+void DistributionNode::OnClientClosed(std::shared_ptr<Client> client) {
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  _downstream.erase(std::remove(_downstream.begin(), _downstream.end(), client), _downstream.end());
+  for(auto& waiting : _waiting) {
+    waiting.second.erase(std::remove(waiting.second.begin(), waiting.second.end(), client), waiting.second.end());
+  }
+}
@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Client.h"
+#include "FileDistribution.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Connection;
+class Data;
+class Server;
+class DistributionNode;
+
+class DistributionNodeListener {
+public:
+  virtual void OnDistributionRelayReady(std::shared_ptr<DistributionNode> node, uint16_t port) = 0;
+  virtual void OnDistributionProgress(std::shared_ptr<DistributionNode> node, uint32_t chunks_done) = 0;
+  virtual void OnDistributionDone(std::shared_ptr<DistributionNode> node, bool success) = 0;
+};
+
+/*
+ Client side of a file distribution job. Pulls verified chunks from its parent (the server or another client),
+ writes them to <path>.part and serves them to its own children from a relay listener. Falls back to pulling
+ from the server when the parent goes away or keeps sending corrupted chunks.
+*/
+class DistributionNode
+    : public ClientManager
+    , public std::enable_shared_from_this<DistributionNode> {
+public:
+  static std::shared_ptr<DistributionNode> Create(std::weak_ptr<DistributionNodeListener> listener,
+                                                  std::shared_ptr<Connection> connection,
+                                                  const std::string& server_host,
+                                                  int server_port,
+                                                  std::shared_ptr<Data> job_data);
+  uint32_t GetJobId();
+  void Start();
+  void Release();
+
+  void OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) override;
+  bool OnClientConnecting(std::shared_ptr<Client> client, NetError err) override;
+  void OnClientConnected(std::shared_ptr<Client> client) override;
+  void OnClientClosed(std::shared_ptr<Client> client) override;
+
+private:
+  class Upstream : public ClientManager {
+  public:
+    Upstream(std::weak_ptr<DistributionNode> node);
+    void OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) override;
+    bool OnClientConnecting(std::shared_ptr<Client> client, NetError err) override;
+    void OnClientConnected(std::shared_ptr<Client> client) override;
+    void OnClientClosed(std::shared_ptr<Client> client) override;
+  private:
+    std::weak_ptr<DistributionNode> _node;
+  };
+
+  DistributionNode(std::weak_ptr<DistributionNodeListener> listener,
+                   std::shared_ptr<Connection> connection,
+                   const std::string& server_host,
+                   int server_port);
+  bool ParseJob(std::shared_ptr<Data> job_data);
+  uint16_t StartRelay();
+  void ConnectUpstream();
+  void OnUpstreamConnected(Upstream* link, std::shared_ptr<Client> client);
+  void OnUpstreamRead(Upstream* link, std::shared_ptr<Data> data);
+  void OnUpstreamClosed(Upstream* link);
+  void HandleChunkRequest(std::shared_ptr<Client> client, std::shared_ptr<Data> data);
+  std::shared_ptr<Message> ReadChunkMsg(uint32_t index);
+  void RequestChunks();
+  void Complete();
+  void Fail();
+
+  std::weak_ptr<DistributionNodeListener> _listener;
+  std::shared_ptr<Connection> _connection;
+  std::string _server_host;
+  int _server_port;
+
+  uint32_t _job_id;
+  uint16_t _children;
+  std::string _parent_host;
+  uint16_t _parent_port;
+  std::string _path;
+  DistributionManifest _manifest;
+
+  std::recursive_mutex _mutex;
+  int _fd;
+  std::vector<bool> _received;
+  std::vector<uint32_t> _requested;
+  uint32_t _chunks_done;
+  uint32_t _next_request;
+  uint32_t _chunk_failures;
+  uint32_t _reported_chunks;
+  bool _finished;
+  std::shared_ptr<Upstream> _upstream_link;
+  std::shared_ptr<Client> _upstream;
+  std::shared_ptr<Server> _relay;
+  std::vector<std::shared_ptr<Client>> _downstream;
+  std::map<uint32_t, std::vector<std::shared_ptr<Client>>> _waiting;
+};
@@ -0,0 +1,262 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "DownloadCache.h"
+#include "Logger.h"
+#include "md5.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+const std::string OBJECTS_DIR = "objects";
+const std::string TEMP_DIR = "tmp";
+const std::string INDEX_FILE = "index";
+const size_t LEGACY_ENTRY_NAME_LENGTH = 32;
+
+
+DownloadCache::DownloadCache(const std::string& cache_dir, uint64_t max_size)
+    : _cache_dir(cache_dir)
+    , _max_size(max_size)
+    , _total_size(0)
+    , _hits(0)
+    , _misses(0)
+    , _evictions(0)
+    , _bytes_served(0) {
+}
+
+bool DownloadCache::Init() {
+  std::error_code fs_error;
+  std::filesystem::path cache_dir(_cache_dir);
+  std::filesystem::create_directories(cache_dir / OBJECTS_DIR, fs_error);
+  std::filesystem::remove_all(cache_dir / TEMP_DIR, fs_error);
+  std::filesystem::create_directories(cache_dir / TEMP_DIR, fs_error);
+  if(!std::filesystem::is_directory(cache_dir / OBJECTS_DIR, fs_error) ||
+     !std::filesystem::is_directory(cache_dir / TEMP_DIR, fs_error)) {
+    DLOG(error, "DownloadCache : can't use cache dir : {}", _cache_dir);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  LoadIndex();
+
+  // objects nobody points to and per-path copies of the old layout
+  for(auto& entry : std::filesystem::directory_iterator(cache_dir / OBJECTS_DIR, fs_error)) {
+    if(!_object_refs.count(entry.path().filename().string())) {
+      std::filesystem::remove(entry.path(), fs_error);
+    }
+  }
+  for(auto& entry : std::filesystem::directory_iterator(cache_dir, fs_error)) {
+    if(entry.is_regular_file(fs_error) && entry.path().filename().string().length() == LEGACY_ENTRY_NAME_LENGTH) {
+      std::filesystem::remove(entry.path(), fs_error);
+    }
+  }
+
+  Evict();
+  DLOG(info, "DownloadCache : {} files, {} of {} bytes used", _entries.size(), _total_size, _max_size);
+  return true;
+}
+
+std::string DownloadCache::MakeKey(const std::string& host_key, const std::string& path) {
+  std::string key = host_key;
+  key.push_back('\0');
+  key.append(path);
+  return digestpp::md5().absorb(key).hexdigest();
+}
+
+bool DownloadCache::Lookup(const std::string& key, uint64_t size, uint64_t mtime, std::string& out_object_path) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _entries.find(key);
+  if(it == _entries.end() || it->second._size != size || it->second._mtime != mtime) {
+    _misses++;
+    return false;
+  }
+
+  _hits++;
+  _bytes_served += size;
+  _lru.splice(_lru.begin(), _lru, it->second._lru_it);
+  out_object_path = GetObjectPath(it->second._hash);
+  LogStats();
+  return true;
+}
+
+std::string DownloadCache::GetBasePath(const std::string& key) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _entries.find(key);
+  if(it == _entries.end()) {
+    return "";
+  }
+  return GetObjectPath(it->second._hash);
+}
+
+std::string DownloadCache::MakeTempPath(uint32_t req_id) {
+  return (std::filesystem::path(_cache_dir) / TEMP_DIR / (std::to_string(req_id) + ".part")).string();
+}
+
+bool DownloadCache::Store(const std::string& key,
+                          uint64_t size,
+                          uint64_t mtime,
+                          const std::string& content_hash,
+                          const std::string& temp_path) {
+  std::stringstream hash_hex;
+  for(unsigned char byte : content_hash) {
+    hash_hex << std::hex << ((byte >> 4) & 0xF) << (byte & 0xF);
+  }
+  std::string hash = hash_hex.str();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::error_code fs_error;
+  if(_object_refs.count(hash)) {
+    // same content is already stored, maybe for another host or path
+    std::filesystem::remove(temp_path, fs_error);
+  } else {
+    std::filesystem::rename(temp_path, GetObjectPath(hash), fs_error);
+    if(fs_error) {
+      DLOG(error, "DownloadCache : can't store : {}", temp_path);
+      std::filesystem::remove(temp_path, fs_error);
+      return false;
+    }
+  }
+
+  // new entry goes in first, so an unchanged object isn't dropped in between
+  auto it = _entries.find(key);
+  std::string old_hash;
+  uint64_t old_size = 0;
+  if(it != _entries.end()) {
+    old_hash = it->second._hash;
+    old_size = it->second._size;
+    _lru.erase(it->second._lru_it);
+    _entries.erase(it);
+  }
+  AddEntry(key, size, mtime, hash);
+  if(!old_hash.empty()) {
+    if(!--_object_refs[old_hash]) {
+      _object_refs.erase(old_hash);
+      _total_size -= old_size;
+      std::filesystem::remove(GetObjectPath(old_hash), fs_error);
+    }
+  }
+
+  Evict();
+  SaveIndex();
+  LogStats();
+  return true;
+}
+
+std::string DownloadCache::GetObjectPath(const std::string& hash) {
+  return (std::filesystem::path(_cache_dir) / OBJECTS_DIR / hash).string();
+}
+
+void DownloadCache::AddEntry(const std::string& key, uint64_t size, uint64_t mtime, const std::string& hash) {
+  Entry entry;
+  entry._size = size;
+  entry._mtime = mtime;
+  entry._hash = hash;
+  _lru.push_front(key);
+  entry._lru_it = _lru.begin();
+  _entries.insert(std::make_pair(key, entry));
+  if(!_object_refs[hash]++) {
+    _total_size += size;
+  }
+}
+
+void DownloadCache::RemoveEntry(const std::string& key) {
+  auto it = _entries.find(key);
+  if(it == _entries.end()) {
+    return;
+  }
+
+  std::string hash = it->second._hash;
+  uint64_t size = it->second._size;
+  _lru.erase(it->second._lru_it);
+  _entries.erase(it);
+  if(!--_object_refs[hash]) {
+    _object_refs.erase(hash);
+    _total_size -= size;
+    std::error_code fs_error;
+    std::filesystem::remove(GetObjectPath(hash), fs_error);
+  }
+}
+
+void DownloadCache::Evict() {
+  while(_total_size > _max_size && !_lru.empty()) {
+    RemoveEntry(_lru.back());
+    _evictions++;
+  }
+}
+
+bool DownloadCache::LoadIndex() {
+  std::ifstream index((std::filesystem::path(_cache_dir) / INDEX_FILE).string());
+  if(!index.is_open()) {
+    return false;
+  }
+
+  // saved most recently used first
+  std::string line;
+  while(std::getline(index, line)) {
+    std::stringstream fields(line);
+    std::string key;
+    std::string hash;
+    uint64_t size = 0;
+    uint64_t mtime = 0;
+    if(!(fields >> key >> size >> mtime >> hash) || _entries.count(key)) {
+      continue;
+    }
+    std::error_code fs_error;
+    if(!std::filesystem::is_regular_file(GetObjectPath(hash), fs_error)) {
+      continue;
+    }
+    AddEntry(key, size, mtime, hash);
+    _lru.splice(_lru.end(), _lru, _lru.begin());
+  }
+  return true;
+}
+
+void DownloadCache::SaveIndex() {
+  std::filesystem::path index_path = std::filesystem::path(_cache_dir) / INDEX_FILE;
+  std::string temp_path = index_path.string() + ".tmp";
+  {
+    std::ofstream index(temp_path, std::ios::trunc);
+    for(auto& key : _lru) {
+      auto& entry = _entries[key];
+      index << key << " " << entry._size << " " << entry._mtime << " " << entry._hash << "\n";
+    }
+    if(!index.good()) {
+      DLOG(error, "DownloadCache : can't write index : {}", temp_path);
+      return;
+    }
+  }
+  std::error_code fs_error;
+  std::filesystem::rename(temp_path, index_path, fs_error);
+}
+
+void DownloadCache::LogStats() {
+  DLOG(info, "DownloadCache : {} files, {} of {} bytes used, hits : {}, misses : {}, evictions : {}, served : {} bytes",
+             _entries.size(),
+             _total_size,
+             _max_size,
+             _hits,
+             _misses,
+             _evictions,
+             _bytes_served);
+}
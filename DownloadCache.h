@@ -0,0 +1,72 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+class DownloadCache {
+public:
+  DownloadCache(const std::string& cache_dir, uint64_t max_size);
+  bool Init();
+  std::string MakeKey(const std::string& host_key, const std::string& path);
+  bool Lookup(const std::string& key, uint64_t size, uint64_t mtime, std::string& out_object_path);
+  std::string GetBasePath(const std::string& key);
+  std::string MakeTempPath(uint32_t req_id);
+  bool Store(const std::string& key,
+             uint64_t size,
+             uint64_t mtime,
+             const std::string& content_hash,
+             const std::string& temp_path);
+
+private:
+  struct Entry {
+    uint64_t _size;
+    uint64_t _mtime;
+    std::string _hash;
+    std::list<std::string>::iterator _lru_it;
+  };
+
+  std::string GetObjectPath(const std::string& hash);
+  void AddEntry(const std::string& key, uint64_t size, uint64_t mtime, const std::string& hash);
+  void RemoveEntry(const std::string& key);
+  void Evict();
+  bool LoadIndex();
+  void SaveIndex();
+  void LogStats();
+
+  std::string _cache_dir;
+  uint64_t _max_size;
+  uint64_t _total_size;
+  uint64_t _hits;
+  uint64_t _misses;
+  uint64_t _evictions;
+  uint64_t _bytes_served;
+  std::mutex _mutex;
+  std::map<std::string, Entry> _entries;
+  std::map<std::string, uint32_t> _object_refs;
+  std::list<std::string> _lru;
+};
@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "FileDistribution.h"
+#include "Data.h"
+#include "Logger.h"
+#include "md5.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+DistributionManifest::DistributionManifest()
+    : _file_size(0)
+    , _chunk_size(CHUNK_SIZE)
+    , _file_hash(HASH_SIZE, 0) {
+}
+
+bool DistributionManifest::Build(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    DLOG(error, "DistributionManifest : can't open : {}", path);
+    return false;
+  }
+
+  digestpp::md5 file_hasher;
+  std::vector<unsigned char> buffer(_chunk_size);
+  unsigned char hash[HASH_SIZE];
+  _file_size = 0;
+  _chunk_hashes.clear();
+
+  while(true) {
+    ssize_t read_size = pread(fd, buffer.data(), buffer.size(), (off_t)_file_size);
+    if(read_size < 0) {
+      DLOG(error, "DistributionManifest : read failed : {}", path);
+      close(fd);
+      return false;
+    }
+    if(!read_size) {
+      break;
+    }
+    file_hasher.absorb(buffer.data(), (size_t)read_size);
+    digestpp::md5().absorb(buffer.data(), (size_t)read_size).digest(hash, HASH_SIZE);
+    _chunk_hashes.insert(_chunk_hashes.end(), hash, hash + HASH_SIZE);
+    _file_size += (uint64_t)read_size;
+  }
+  close(fd);
+
+  file_hasher.digest(_file_hash.data(), HASH_SIZE);
+  return true;
+}
+
+std::shared_ptr<Data> DistributionManifest::Serialize() {
+  auto data = std::make_shared<Data>(12 + HASH_SIZE + _chunk_hashes.size());
+  data->Add(8, (const unsigned char*)&_file_size);
+  data->Add(4, (const unsigned char*)&_chunk_size);
+  data->Add(HASH_SIZE, _file_hash.data());
+  if(!_chunk_hashes.empty()) {
+    data->Add(_chunk_hashes.size(), _chunk_hashes.data());
+  }
+  return data;
+}
+
+bool DistributionManifest::Deserialize(std::shared_ptr<Data> data, uint32_t offset) {
+  bool data_retrieved = true;
+  data_retrieved = data_retrieved && data->CopyTo(&_file_size, offset, 8);
+  data_retrieved = data_retrieved && data->CopyTo(&_chunk_size, offset + 8, 4);
+  data_retrieved = data_retrieved && data->CopyTo(_file_hash.data(), offset + 12, HASH_SIZE);
+  if(!data_retrieved || !_chunk_size) {
+    return false;
+  }
+
+  uint64_t chunk_count = (_file_size + _chunk_size - 1) / _chunk_size;
+  _chunk_hashes.resize(chunk_count * HASH_SIZE);
+  if(chunk_count && !data->CopyTo(_chunk_hashes.data(), offset + 12 + HASH_SIZE, (uint32_t)_chunk_hashes.size())) {
+    return false;
+  }
+  return true;
+}
+
+uint64_t DistributionManifest::GetFileSize() {
+  return _file_size;
+}
+
+uint32_t DistributionManifest::GetChunkCount() {
+  return (uint32_t)(_chunk_hashes.size() / HASH_SIZE);
+}
+
+uint32_t DistributionManifest::GetChunkSize(uint32_t index) {
+  uint64_t chunk_offset = (uint64_t)index * _chunk_size;
+  if(chunk_offset >= _file_size) {
+    return 0;
+  }
+  return (uint32_t)std::min<uint64_t>(_chunk_size, _file_size - chunk_offset);
+}
+
+bool DistributionManifest::VerifyChunk(uint32_t index, const unsigned char* data, uint32_t size) {
+  if(index >= GetChunkCount() || size != GetChunkSize(index)) {
+    return false;
+  }
+  unsigned char hash[HASH_SIZE];
+  digestpp::md5().absorb(data, size).digest(hash, HASH_SIZE);
+  return !std::memcmp(hash, _chunk_hashes.data() + (size_t)index * HASH_SIZE, HASH_SIZE);
+}
+
+bool DistributionManifest::VerifyFile(int fd) {
+  digestpp::md5 file_hasher;
+  std::vector<unsigned char> buffer(_chunk_size);
+  uint64_t offset = 0;
+
+  while(offset < _file_size) {
+    ssize_t read_size = pread(fd, buffer.data(), buffer.size(), (off_t)offset);
+    if(read_size <= 0) {
+      return false;
+    }
+    file_hasher.absorb(buffer.data(), (size_t)read_size);
+    offset += (uint64_t)read_size;
+  }
+
+  unsigned char hash[HASH_SIZE];
+  file_hasher.digest(hash, HASH_SIZE);
+  return !std::memcmp(hash, _file_hash.data(), HASH_SIZE);
+}
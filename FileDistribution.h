@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Data;
+
+/*
+ Describes a file distributed to many hosts : its size and the md5 of every chunk and of the whole file.
+ Serialized as [file_size8][chunk_size4][file_hash16][chunk_hash16 * chunk_count].
+*/
+class DistributionManifest {
+public:
+  static const uint32_t CHUNK_SIZE = 256 * 1024;
+  static const uint32_t HASH_SIZE = 16;
+
+  DistributionManifest();
+  bool Build(const std::string& path);
+  std::shared_ptr<Data> Serialize();
+  bool Deserialize(std::shared_ptr<Data> data, uint32_t offset);
+  uint64_t GetFileSize();
+  uint32_t GetChunkCount();
+  uint32_t GetChunkSize(uint32_t index);
+  bool VerifyChunk(uint32_t index, const unsigned char* data, uint32_t size);
+  bool VerifyFile(int fd);
+
+private:
+  uint64_t _file_size;
+  uint32_t _chunk_size;
+  std::vector<unsigned char> _file_hash;
+  std::vector<unsigned char> _chunk_hashes;
+};
@@ -6,19 +6,78 @@
 #include "Logger.h"
 #include "StringUtils.h"
 #include "DirectoryListing.h"
+#include "StreamCompressor.h"
+#include "DeltaTransfer.h"
+#include "TarWriter.h"
+#include "TransferScheduler.h"
+#include "DownloadCache.h"
+#include "TaskTimer.h"
+#include "ThreadLoop.h"
 
 #include <filesystem>
 
+#include <sys/stat.h>
+
+const uint32_t TRANSFER_BLOCK_SIZE = 64 * 1024;
+const uint32_t TRANSFER_WINDOW_SIZE = 8;
+const uint64_t MIN_COMPRESSED_FILE_SIZE = 1024;
+const int TRANSFER_COMPRESSION_LEVEL = 3;
+
 
 void FileTransferHandler::OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file_transfer,
                                           std::shared_ptr<Message> msg) {
 }
 
+FileTransferHandler::FileTransferHandler()
+    : _task_timer(std::make_shared<TaskTimer>())
+    , _scheduler(std::make_shared<TransferScheduler>(_task_timer))
+    , _file_thread(std::make_shared<ThreadLoop>()) {
+  _task_timer->Init();
+  _file_thread->Init();
+}
+
 void FileTransferHandler::HandleTransferCompleted(std::shared_ptr<FileTransfer> file_transfer,
                                std::shared_ptr<SimpleMessage> msg,
                                bool success) {
   OnFileTransferCompleted(file_transfer, msg, success);
-  _transfers.erase(file_transfer->GetRequestId());
+  {
+    std::lock_guard<std::mutex> lock(_transfers_mutex);
+    _transfers.erase(file_transfer->GetRequestId());
+  }
+  _scheduler->FinishTransfer(file_transfer->GetHostId(), file_transfer->GetRequestId());
+}
+
+void FileTransferHandler::RemoveTransferHost(uint32_t host_id) {
+  std::vector<uint32_t> pending;
+  _scheduler->RemoveHost(host_id, pending);
+  for(auto transfer_id : pending) {
+    auto file_transfer = FindTransfer(transfer_id);
+    if(file_transfer) {
+      HandleTransferCompleted(file_transfer, nullptr, false);
+    }
+  }
+}
+
+bool FileTransferHandler::AddTransfer(std::shared_ptr<FileTransfer> file_transfer) {
+  std::lock_guard<std::mutex> lock(_transfers_mutex);
+  return _transfers.insert(std::make_pair(file_transfer->GetRequestId(), file_transfer)).second;
+}
+
+std::shared_ptr<FileTransfer> FileTransferHandler::FindTransfer(uint32_t req_id) {
+  std::lock_guard<std::mutex> lock(_transfers_mutex);
+  auto it = _transfers.find(req_id);
+  if(it == _transfers.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+std::shared_ptr<TransferScheduler> FileTransferHandler::GetScheduler() {
+  return _scheduler;
+}
+
+std::shared_ptr<ThreadLoop> FileTransferHandler::GetFileThread() {
+  return _file_thread;
 }
 
 
@@ -26,26 +85,63 @@ void FileTransferHandler::HandleTransferCompleted(std::shared_ptr<FileTransfer>
 FileTransfer::FileTransfer(std::weak_ptr<FileTransferHandler> listener
                           ,uint32_t req_id
                           ,const std::string& req_file_path
-                          ,bool is_get_request)
+                          ,bool is_get_request
+                          ,uint8_t flags)
     : _listener(listener)
     , _req_id(req_id)
+    , _host_id(0)
     , _req_file_path(req_file_path)
     , _is_get_request(is_get_request)
     , _is_directory_listing_request(false)
-    , _awaing_raw_data(false)
+    , _flags(flags)
     , _received_file_size(0)
     , _expected_file_size(0)
-    , _data_transfer_counter(0) {
+    , _file_mtime(0)
+    , _data_transfer_counter(0)
+    , _blocks_in_flight(0)
+    , _all_data_sent(false)
+    , _is_failed(false)
+    , _is_send_delayed(false)
+    , _is_finished(false) {
 }
 
 uint32_t FileTransfer::GetRequestId() {
   return _req_id;
 }
 
+uint32_t FileTransfer::GetHostId() {
+  return _host_id;
+}
+
+void FileTransfer::SetHostId(uint32_t host_id) {
+  _host_id = host_id;
+}
+
 const std::string& FileTransfer::GetRequestPath() {
   return _req_file_path;
 }
 
+uint8_t FileTransfer::GetFlags() {
+  return _flags;
+}
+
+bool FileTransfer::IsGzipEncoded() {
+  return _flags & Flags::GZIP;
+}
+
+bool FileTransfer::IsArchive() {
+  return _flags & Flags::ARCHIVE;
+}
+
+void FileTransfer::SetDownloadCache(std::shared_ptr<DownloadCache> download_cache, const std::string& cache_key) {
+  _download_cache = download_cache;
+  _cache_key = cache_key;
+}
+
+const std::string& FileTransfer::GetCachedFilePath() {
+  return _cached_file_path;
+}
+
 uint32_t FileTransfer::GetDataTransferCounter() {
   return _data_transfer_counter;
 }
@@ -59,10 +155,11 @@ uint64_t FileTransfer::GetReceivedFileSize() {
 }
 
 void FileTransfer::SendTransferRequestMsg(std::shared_ptr<Client> client) {
-  uint32_t data_size = 4 + 1 + _req_file_path.length();
+  uint32_t data_size = 4 + 1 + 1 + _req_file_path.length();
   auto data = std::make_shared<Data>(data_size);
   data->Add(4, (unsigned char*)&_req_id);
   data->Add(1, (unsigned char*)&_is_get_request);
+  data->Add(1, (unsigned char*)&_flags);
   data->Add(_req_file_path.length(), (unsigned char*)_req_file_path.c_str());
 
   auto resource = std::make_shared<DataResource>(data);
@@ -71,20 +168,42 @@ void FileTransfer::SendTransferRequestMsg(std::shared_ptr<Client> client) {
 }
 
 void FileTransfer::OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) {
-  if(!_awaing_raw_data) {
-    std::shared_ptr<SimpleMessage> simple_msg = std::static_pointer_cast<SimpleMessage>(msg);
-    auto msg_header = simple_msg->GetHeader();
-    auto type = MessageType::TypeFromInt(msg_header->_type);
-    switch(type) {
-      case MessageType::FILE_TRANSFER_ACK:
-        SendRequestedData();
-        break;
-      default:
-        DLOG(error, "OnClientRead : unexpected message type : {}", msg_header->_type);
-        break;
-    }
-  } else {
-    HandleFileTransferMsg(msg);
+  std::shared_ptr<SimpleMessage> simple_msg = std::static_pointer_cast<SimpleMessage>(msg);
+  auto msg_header = simple_msg->GetHeader();
+  auto msg_content = simple_msg->GetContent();
+
+  if(!msg_content->IsCompleted()) {
+    return;
+  }
+
+  auto type = MessageType::TypeFromInt(msg_header->_type);
+  switch(type) {
+    case MessageType::FILE_TRANSFER_DELTA_SIG:
+      HandleDeltaSignature(msg_content->GetMemCache());
+      break;
+    case MessageType::FILE_TRANSFER_CACHED:
+      // server already has this version, nothing to send
+      _all_data_sent = true;
+      NotifyCompleted(true);
+      break;
+    case MessageType::FILE_TRANSFER_DATA_ACK:
+      {
+        std::lock_guard<std::mutex> lock(_send_mutex);
+        if(_blocks_in_flight) {
+          _blocks_in_flight--;
+        }
+      }
+      SendNextBlocks();
+      break;
+    case MessageType::FILE_TRANSFER_DATA:
+      HandleTransferData(msg_content->GetMemCache());
+      break;
+    case MessageType::FILE_TRANSFER_END:
+      HandleTransferEnd(msg_content->GetMemCache());
+      break;
+    default:
+      DLOG(error, "OnClientRead : unexpected message type : {}", msg_header->_type);
+      break;
   }
 }
 
@@ -104,12 +223,15 @@ void FileTransfer::OnClientConnected(std::shared_ptr<Client> client) {
 }
 
 void FileTransfer::OnClientClosed(std::shared_ptr<Client> client) {
-  //TODO
+  if(!_is_finished) {
+    HandleTransferFailed();
+  }
 }
 
 void FileTransfer::SendInitResponse() {
   bool is_valid = true;
   uint64_t file_length = 0;
+  uint64_t file_mtime = 0;
   std::error_code fs_error;
   if(_is_get_request) {
     std::filesystem::path path(_req_file_path);
@@ -123,7 +245,13 @@ void FileTransfer::SendInitResponse() {
         DLOG(error, "is_directory failed on : {}", _req_file_path);
         is_valid = false;
       } else {
-        if(is_dir) {
+        if(is_dir && (_flags & Flags::ARCHIVE)) {
+          _tar_writer = std::make_shared<TarWriter>(_req_file_path);
+          if(!_tar_writer->Init()) {
+            _tar_writer.reset();
+            is_valid = false;
+          }
+        } else if(is_dir) {
           _serialized_dir = DirectoryListing::SerializeDirectory(_req_file_path);
           if(!_serialized_dir) {
             DLOG(error, "Serialize directory failed on : {}", _req_file_path);
@@ -139,17 +267,46 @@ void FileTransfer::SendInitResponse() {
             is_valid = false;
             file_length = 0;
           }
+          // lets the server tell if its cached copy is still current
+          struct stat file_stat;
+          if(!stat(_req_file_path.c_str(), &file_stat)) {
+            file_mtime = (uint64_t)file_stat.st_mtim.tv_sec * 1000000000 + (uint64_t)file_stat.st_mtim.tv_nsec;
+          }
         }
       }
     }
   }
 
-  uint32_t data_size = 4 + 1 + 1 + 8;
+  if(!_tar_writer) {
+    _flags &= ~Flags::ARCHIVE;
+  }
+  if(_is_directory_listing_request || (!_tar_writer && file_length < MIN_COMPRESSED_FILE_SIZE)) {
+    _flags &= ~Flags::GZIP;
+  }
+  if(_is_directory_listing_request || _tar_writer || !file_length) {
+    _flags &= ~Flags::DELTA;
+  }
+  if(_flags & Flags::DELTA) {
+    _flags &= ~Flags::GZIP;
+  }
+  // set up before the response, the other side decodes by the flag it gets
+  if(is_valid && _is_get_request && (_flags & Flags::GZIP)) {
+    _compressor = std::make_shared<StreamCompressor>(StreamCompressor::Format::GZIP, TRANSFER_COMPRESSION_LEVEL);
+    if(!_compressor->Init()) {
+      DLOG(warn, "SendInitResponse : compressor init failed, sending uncompressed : {}", _req_file_path);
+      _compressor.reset();
+      _flags &= ~Flags::GZIP;
+    }
+  }
+
+  uint32_t data_size = 4 + 1 + 1 + 8 + 1 + 8;
   auto data = std::make_shared<Data>(data_size);
   data->Add(4, (unsigned char*)&_req_id);
   data->Add(1, (unsigned char*)&is_valid);
   data->Add(1, (unsigned char*)&_is_directory_listing_request);
   data->Add(8, (unsigned char*)&file_length);
+  data->Add(1, (unsigned char*)&_flags);
+  data->Add(8, (unsigned char*)&file_mtime);
   auto resource = std::make_shared<DataResource>(data);
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_TRANSFER_INIT, resource);
 
@@ -157,6 +314,11 @@ void FileTransfer::SendInitResponse() {
 
   if(!is_valid) {
     //TODO
+    return;
+  }
+
+  if(_is_get_request && !(_flags & Flags::DELTA)) {
+    StartSendingData();
   }
 }
 
@@ -172,6 +334,8 @@ void FileTransfer::HandleTransferInit(std::shared_ptr<Client> client, std::share
   data_retrieved = data_retrieved && data->CopyTo(&is_valid, 4, 1);
   data_retrieved = data_retrieved && data->CopyTo(&_is_directory_listing_request , 5, 1);
   data_retrieved = data_retrieved && data->CopyTo(&_expected_file_size , 6, 8);
+  data_retrieved = data_retrieved && data->CopyTo(&_flags , 14, 1);
+  data_retrieved = data_retrieved && data->CopyTo(&_file_mtime , 15, 8);
 
   if(!data_retrieved) {
     DLOG(error, "HandleTransferInit : data read error");
@@ -179,8 +343,7 @@ void FileTransfer::HandleTransferInit(std::shared_ptr<Client> client, std::share
   }
 
   if(!is_valid) {
-    //TODO
-    //OnFileTransferCompleted(file_transfer, nullptr, false);
+    NotifyCompleted(false);
     return;
   }
 
@@ -190,50 +353,304 @@ void FileTransfer::HandleTransferInit(std::shared_ptr<Client> client, std::share
     //std::shared_ptr<SimpleMessage> content_msg = CreateFileMsg();
     //client->Send(content_msg);
   }
-  SendAckAndSwitchToRaw();
+
+  // without delta the agent starts streaming right after INIT
+  if(!(_flags & Flags::DELTA)) {
+    return;
+  }
+
+  if(_download_cache && _download_cache->Lookup(_cache_key, _expected_file_size, _file_mtime, _cached_file_path)) {
+    _client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_TRANSFER_CACHED));
+    NotifyCompleted(true);
+    return;
+  }
+  SendDeltaSignature();
 }
 
+void FileTransfer::SendDeltaSignature() {
+  // hashing a large cached base would hold up every other message on this link
+  auto listener = _listener.lock();
+  auto file_thread = listener ? listener->GetFileThread() : nullptr;
+  if(file_thread && file_thread->OnDifferentThread()) {
+    file_thread->Post(std::bind(&FileTransfer::SendDeltaSignature, shared_from_this()));
+    return;
+  }
+  if(_is_finished) {
+    return;
+  }
 
-void FileTransfer::SendAckAndSwitchToRaw() {
-  _awaing_raw_data = true;
-  auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_TRANSFER_ACK);
-  _client->Send(msg);
-  _client->SetMsgBuilder(nullptr);
+  std::string base_path;
+  if(_download_cache) {
+    base_path = _download_cache->GetBasePath(_cache_key);
+    _delta_output_path = _download_cache->MakeTempPath(_req_id);
+  }
+
+  auto signature = DeltaSignature::CreateFromFile(base_path);
+  _delta_decoder = std::make_shared<DeltaDecoder>(base_path, _delta_output_path);
+  if(!_delta_decoder->Open(signature)) {
+    signature = std::make_shared<DeltaSignature>();
+    _delta_output_path.clear();
+    _delta_decoder = std::make_shared<DeltaDecoder>("", "");
+    _delta_decoder->Open(signature);
+  }
+
+  auto resource = std::make_shared<DataResource>(signature->Serialize());
+  _client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_TRANSFER_DELTA_SIG, resource));
 }
 
+void FileTransfer::HandleDeltaSignature(std::shared_ptr<Data> data) {
+  auto signature = data ? DeltaSignature::Deserialize(data) : nullptr;
+  if(!signature) {
+    DLOG(error, "HandleDeltaSignature : invalid signature for : {}", _req_file_path);
+    SendTransferEnd();
+    return;
+  }
+
+  _delta_encoder = std::make_shared<DeltaEncoder>(signature);
+  if(!_delta_encoder->Open(_req_file_path)) {
+    DLOG(error, "HandleDeltaSignature : can't open : {}", _req_file_path);
+    SendTransferEnd();
+    return;
+  }
+  SendNextBlocks();
+}
 
-void FileTransfer::HandleFileTransferMsg(std::shared_ptr<Message> msg) {
+void FileTransfer::HandleTransferData(std::shared_ptr<Data> data) {
   _data_transfer_counter++;
-  _received_file_size +=  msg->GetDataResource()->GetSize();
+
+  auto scheduler = GetScheduler();
+  if(scheduler) {
+    // holding the ack back throttles the sender through its window
+    scheduler->OnDataTransferred(_host_id, _req_id, data->GetCurrentSize());
+    auto delay = scheduler->GetDelay(_host_id, _req_id);
+    if(delay.count() > 0) {
+      scheduler->Schedule(delay, std::bind(&FileTransfer::SendDataAck, shared_from_this()));
+    } else {
+      SendDataAck();
+    }
+  } else {
+    SendDataAck();
+  }
+
+  if(_is_failed) {
+    return;
+  }
+
+  if(_delta_decoder) {
+    data = _delta_decoder->Decode(data);
+    if(!data) {
+      HandleTransferFailed();
+      return;
+    }
+  }
+  _received_file_size += data->GetCurrentSize();
 
   auto listener = _listener.lock();
   if(listener) {
-    listener->OnFileTransferDataReceived(shared_from_this(), msg);
+    listener->OnFileTransferDataReceived(shared_from_this(), std::make_shared<Message>(data));
   } else {
-    DLOG(error, "HandleFileTransferDataMsg : cant' lock listener");
+    DLOG(error, "HandleTransferData : cant' lock listener");
   }
 }
 
-void FileTransfer::SendRequestedData() {
-  std::error_code fs_error;
-  std::filesystem::path path(_req_file_path);
-  std::shared_ptr<Message> content_msg;
+void FileTransfer::HandleTransferEnd(std::shared_ptr<Data> data) {
+  if(_is_failed) {
+    return;
+  }
+
+  if(_delta_decoder) {
+    unsigned char file_hash[DeltaSignature::STRONG_HASH_SIZE];
+    if(!data || !data->CopyTo(file_hash, 0, DeltaSignature::STRONG_HASH_SIZE) ||
+       !_delta_decoder->Finish(file_hash)) {
+      HandleTransferFailed();
+      return;
+    }
+    DLOG(info, "FileTransfer : {} delta : {} bytes rebuilt from {} on the wire, saved {}, decode cpu {}s",
+               _req_file_path,
+               _delta_decoder->GetOutputSize(),
+               _delta_decoder->GetWireSize(),
+               _delta_decoder->GetOutputSize() - std::min(_delta_decoder->GetOutputSize(), _delta_decoder->GetWireSize()),
+               _delta_decoder->GetCpuTime());
+    if(!_delta_output_path.empty()) {
+      _download_cache->Store(_cache_key,
+                             _expected_file_size,
+                             _file_mtime,
+                             std::string((const char*)file_hash, DeltaSignature::STRONG_HASH_SIZE),
+                             _delta_output_path);
+    }
+  }
+
+  NotifyCompleted(true);
+}
 
-  bool is_dir = std::filesystem::is_directory(path, fs_error);
-  if(fs_error) {
-    DLOG(error, "is_directory failed on : {}", _req_file_path);
+void FileTransfer::HandleTransferFailed() {
+  DLOG(error, "FileTransfer : {} failed", _req_file_path);
+  _is_failed = true;
+  if(!_delta_output_path.empty()) {
+    std::error_code fs_error;
+    std::filesystem::remove(_delta_output_path, fs_error);
+  }
+  NotifyCompleted(false);
+}
+
+void FileTransfer::NotifyCompleted(bool success) {
+  if(_is_finished.exchange(true)) {
+    return;
   }
 
-  if(is_dir && _serialized_dir) {
-    auto resource = std::make_shared<DataResource>(_serialized_dir);
-    content_msg = std::make_shared<Message>(resource);
+  auto listener = _listener.lock();
+  if(listener) {
+    listener->HandleTransferCompleted(shared_from_this(), nullptr, success);
   } else {
-    auto file_resource = DataResource::CreateFromFile(_req_file_path);
-    if(file_resource != nullptr) {
-      content_msg = std::make_shared<Message>(file_resource);
+    DLOG(error, "NotifyCompleted : cant' lock listener");
+  }
+}
+
+void FileTransfer::SendDataAck() {
+  _client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_TRANSFER_DATA_ACK));
+}
+
+void FileTransfer::OnSendDelayElapsed() {
+  {
+    std::lock_guard<std::mutex> lock(_send_mutex);
+    _is_send_delayed = false;
+  }
+  SendNextBlocks();
+}
+
+std::shared_ptr<TransferScheduler> FileTransfer::GetScheduler() {
+  auto listener = _listener.lock();
+  return listener ? listener->GetScheduler() : nullptr;
+}
+
+void FileTransfer::StartSendingData() {
+  if(!_is_directory_listing_request && !_tar_writer) {
+    _file_stream.open(_req_file_path, std::ios::binary);
+    if(!_file_stream.is_open()) {
+      DLOG(error, "StartSendingData : can't open : {}", _req_file_path);
+      SendTransferEnd();
+      return;
+    }
+  }
+
+  SendNextBlocks();
+}
+
+void FileTransfer::SendNextBlocks() {
+  // walking an archived tree or a slow mount would hold up every other message on this link,
+  // the ack only counts the window and blocks are read and sent from the file thread
+  auto listener = _listener.lock();
+  auto file_thread = listener ? listener->GetFileThread() : nullptr;
+  if(file_thread && file_thread->OnDifferentThread()) {
+    file_thread->Post(std::bind(&FileTransfer::SendNextBlocks, shared_from_this()));
+    return;
+  }
+  if(_is_finished) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_send_mutex);
+  auto scheduler = GetScheduler();
+  while(!_all_data_sent && !_is_send_delayed && _blocks_in_flight < TRANSFER_WINDOW_SIZE) {
+    if(scheduler) {
+      auto delay = scheduler->GetDelay(_host_id, _req_id);
+      if(delay.count() > 0) {
+        _is_send_delayed = true;
+        scheduler->Schedule(delay, std::bind(&FileTransfer::OnSendDelayElapsed, shared_from_this()));
+        return;
+      }
+    }
+
+    bool is_last = false;
+    auto block = ReadNextBlock(is_last);
+    if(!block) {
+      SendTransferEnd();
+      return;
+    }
+
+    if(block->GetCurrentSize()) {
+      auto resource = std::make_shared<DataResource>(block);
+      _client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_TRANSFER_DATA, resource));
+      _blocks_in_flight++;
+      if(scheduler) {
+        scheduler->OnDataTransferred(_host_id, _req_id, block->GetCurrentSize());
+      }
+    }
+
+    if(is_last) {
+      SendTransferEnd();
+    }
+  }
+}
+
+std::shared_ptr<Data> FileTransfer::ReadNextBlock(bool& out_is_last) {
+  if(_is_directory_listing_request) {
+    out_is_last = true;
+    return _serialized_dir ? _serialized_dir : std::make_shared<Data>();
+  }
+
+  if(_delta_encoder) {
+    return _delta_encoder->ReadNextBlock(out_is_last);
+  }
+
+  if(_tar_writer) {
+    auto block = _tar_writer->ReadNextBlock(TRANSFER_BLOCK_SIZE, out_is_last);
+    if(_compressor) {
+      return _compressor->Compress(block->GetCurrentDataRaw(), block->GetCurrentSize(), out_is_last);
     }
+    return block;
+  }
+
+  std::vector<char> buffer(TRANSFER_BLOCK_SIZE);
+  _file_stream.read(buffer.data(), buffer.size());
+  uint32_t read_size = (uint32_t)_file_stream.gcount();
+  if(_file_stream.bad()) {
+    DLOG(error, "ReadNextBlock : read failed on : {}", _req_file_path);
+    return nullptr;
+  }
+  out_is_last = _file_stream.eof() || _file_stream.peek() == EOF;
+
+  if(_compressor) {
+    return _compressor->Compress((unsigned char*)buffer.data(), read_size, out_is_last);
+  }
+  return std::make_shared<Data>(read_size, (unsigned char*)buffer.data());
+}
+
+void FileTransfer::SendTransferEnd() {
+  if(_all_data_sent) {
+    return;
+  }
+  _all_data_sent = true;
+  _file_stream.close();
+  if(_tar_writer) {
+    DLOG(info, "FileTransfer : {} archived {} entries, {} bytes", _req_file_path,
+                                                                   _tar_writer->GetEntriesCount(),
+                                                                   _tar_writer->GetTotalSize());
+    _tar_writer.reset();
+  }
+  if(_compressor) {
+    DLOG(info, "FileTransfer : {} compressed {} -> {}", _req_file_path,
+                                                         _compressor->GetTotalIn(),
+                                                         _compressor->GetTotalOut());
+    _compressor.reset();
+  }
+
+  std::shared_ptr<DataResource> resource;
+  if(_delta_encoder) {
+    DLOG(info, "FileTransfer : {} delta : {} bytes matched, {} literal, encode cpu {}s",
+               _req_file_path,
+               _delta_encoder->GetCopiedSize(),
+               _delta_encoder->GetLiteralSize(),
+               _delta_encoder->GetCpuTime());
+    auto hash = std::make_shared<Data>(DeltaSignature::STRONG_HASH_SIZE);
+    unsigned char file_hash[DeltaSignature::STRONG_HASH_SIZE];
+    _delta_encoder->GetFileHash(file_hash);
+    hash->Add(DeltaSignature::STRONG_HASH_SIZE, file_hash);
+    resource = std::make_shared<DataResource>(hash);
+    _delta_encoder.reset();
   }
-  _client->Send(content_msg);
+  _client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_TRANSFER_END, resource));
+  NotifyCompleted(!_is_failed);
 }
 
 bool FileTransfer::IsGetRequest() {
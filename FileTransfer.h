@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "Client.h"
@@ -9,9 +12,24 @@ class Connection;
 class TerminalClient;
 class SimpleMessage;
 class FileTransfer;
+class StreamCompressor;
+class DeltaSignature;
+class DeltaEncoder;
+class DeltaDecoder;
+class DownloadCache;
+class TarWriter;
+class TaskTimer;
+class TransferScheduler;
+class ThreadLoop;
 
 class FileTransferHandler {
 public:
+  enum ListingStatus {
+    LISTING_OK = 0,
+    LISTING_FAILED
+  };
+
+  FileTransferHandler();
   virtual void OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file_transfer,
                                           std::shared_ptr<Message> msg);
   virtual void OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_transfer,
@@ -19,9 +37,19 @@ public:
   void HandleTransferCompleted(std::shared_ptr<FileTransfer> file_transfer,
                                std::shared_ptr<SimpleMessage> msg,
                                bool success);
+  std::shared_ptr<TransferScheduler> GetScheduler();
+  std::shared_ptr<ThreadLoop> GetFileThread();
 protected:
+  void RemoveTransferHost(uint32_t host_id);
+  bool AddTransfer(std::shared_ptr<FileTransfer> file_transfer);
+  std::shared_ptr<FileTransfer> FindTransfer(uint32_t req_id);
   virtual std::shared_ptr<FileTransferHandler> GetSptr() = 0;
+  std::shared_ptr<TaskTimer> _task_timer; // shared by all delayed work of the handler
+  std::shared_ptr<TransferScheduler> _scheduler;
+  std::shared_ptr<ThreadLoop> _file_thread; // disk heavy work, keeps it off the network thread
+private:
   std::map<uint32_t, std::shared_ptr<FileTransfer>> _transfers;
+  std::mutex _transfers_mutex; // web, network, file and server threads all reach the map
 };
 
 
@@ -29,13 +57,27 @@ class FileTransfer
     : public ClientManager
     , public std::enable_shared_from_this<class FileTransfer> {
 public:
+  enum Flags {
+    NONE = 0,
+    GZIP = 1 << 0,
+    DELTA = 1 << 1,
+    ARCHIVE = 1 << 2
+  };
 
   FileTransfer(std::weak_ptr<FileTransferHandler> listener
               ,uint32_t req_id
               ,const std::string& req_file_path
-              ,bool is_get_request);
+              ,bool is_get_request
+              ,uint8_t flags);
   uint32_t GetRequestId();
+  uint32_t GetHostId();
+  void SetHostId(uint32_t host_id);
   const std::string& GetRequestPath();
+  uint8_t GetFlags();
+  bool IsGzipEncoded();
+  bool IsArchive();
+  void SetDownloadCache(std::shared_ptr<DownloadCache> download_cache, const std::string& cache_key);
+  const std::string& GetCachedFilePath();
   uint32_t GetDataTransferCounter();
   uint64_t GetReceivedFileSize();
   uint64_t GetExpectedFileSize();
@@ -51,20 +93,47 @@ public:
   void HandleTransferInit(std::shared_ptr<Client> client, std::shared_ptr<Data> data);
 private:
   void SendInitResponse();
-  void SendAckAndSwitchToRaw();
-  void HandleFileTransferMsg(std::shared_ptr<Message> msg);
-  void SendRequestedData();
+  void SendDeltaSignature();
+  void HandleDeltaSignature(std::shared_ptr<Data> data);
+  void HandleTransferData(std::shared_ptr<Data> data);
+  void HandleTransferEnd(std::shared_ptr<Data> data);
+  void HandleTransferFailed();
+  void NotifyCompleted(bool success);
+  void SendDataAck();
+  void OnSendDelayElapsed();
+  std::shared_ptr<TransferScheduler> GetScheduler();
+  void StartSendingData();
+  void SendNextBlocks();
+  std::shared_ptr<Data> ReadNextBlock(bool& out_is_last);
+  void SendTransferEnd();
 
 
   std::weak_ptr<FileTransferHandler> _listener;
   uint32_t _req_id;
+  uint32_t _host_id;
   std::string _req_file_path;
   std::shared_ptr<Client> _client;
   std::shared_ptr<Data> _serialized_dir;
   bool _is_get_request;
   bool _is_directory_listing_request;
-  bool _awaing_raw_data;
+  uint8_t _flags;
   uint64_t _received_file_size;
   uint64_t _expected_file_size;
+  uint64_t _file_mtime;
   uint32_t _data_transfer_counter;
+  std::ifstream _file_stream;
+  std::shared_ptr<StreamCompressor> _compressor;
+  std::shared_ptr<DownloadCache> _download_cache;
+  std::string _cache_key;
+  std::string _cached_file_path;
+  std::string _delta_output_path;
+  std::shared_ptr<DeltaEncoder> _delta_encoder;
+  std::shared_ptr<DeltaDecoder> _delta_decoder;
+  std::shared_ptr<TarWriter> _tar_writer;
+  uint32_t _blocks_in_flight;
+  bool _all_data_sent;
+  bool _is_failed;
+  bool _is_send_delayed;
+  std::atomic_bool _is_finished;
+  std::mutex _send_mutex;
 };
\ No newline at end of file
@@ -5,22 +5,189 @@
 #include "Logger.h"
 #include "DataResource.h"
 #include "MessageType.h"
+#include "TransferScheduler.h"
+#include "DataConnectionPool.h"
+#include "DirectoryPager.h"
+#include "DirectoryCache.h"
+
+#include <algorithm>
+#include <chrono>
+
+const uint32_t DEFAULT_LISTING_PAGE_SIZE = 500;
+const uint32_t MAX_LISTING_PAGE_SIZE = 5000;
+const size_t MAX_LISTING_SESSIONS = 32;
+const std::chrono::seconds LISTING_SESSION_TIMEOUT(60);
+const size_t MAX_PREFETCHED_DIRECTORIES = 16;
+
+
+FileTransferHandlerClient::FileTransferHandlerClient()
+    : _directory_cache(std::make_shared<DirectoryCache>()) {
+  if(!_directory_cache->Init()) {
+    _directory_cache.reset();
+  }
+}
+
+void FileTransferHandlerClient::InitConnectionPool(std::shared_ptr<Connection> connection,
+                                                   const std::string& sever_host,
+                                                   int server_port) {
+  if(!_connection_pool) {
+    _connection_pool = std::make_shared<DataConnectionPool>(connection, sever_host, server_port);
+  }
+  _connection_pool->Fill();
+}
+
+void FileTransferHandlerClient::ClearConnectionPool() {
+  if(_connection_pool) {
+    _connection_pool->Clear();
+  }
+}
+
+std::shared_ptr<SimpleMessage> FileTransferHandlerClient::MakeDirectoryListingResponse(std::shared_ptr<Data> msg_data) {
+  uint32_t req_id = 0;
+  DirectoryPager::Options options;
+  if(!msg_data->CopyTo(&req_id, 0, 4) || !DirectoryPager::DeserializeOptions(msg_data, 4, options)) {
+    DLOG(error, "MakeDirectoryListingResponse : data error");
+    return nullptr;
+  }
+
+  ExpireListings();
+
+  uint8_t status = ListingStatus::LISTING_OK;
+  uint32_t cursor = options._cursor;
+  std::shared_ptr<DirectoryPager> pager;
+  if(cursor) {
+    auto it = _listings.find(cursor);
+    if(it != _listings.end()) {
+      pager = it->second;
+    }
+  } else {
+    pager = std::make_shared<DirectoryPager>(options, _directory_cache);
+    if(pager->Open()) {
+      cursor = NextListingCursor();
+      _listings.insert(std::make_pair(cursor, pager));
+      // subdirectories of what is being viewed are the likely next clicks
+      _prefetch_queue.clear();
+      _prefetch_parent = options._path;
+    } else {
+      pager.reset();
+    }
+  }
+
+  std::vector<DirectoryListing::FileInfo> entries;
+  if(pager) {
+    uint32_t page_size = options._page_size ? std::min(options._page_size, MAX_LISTING_PAGE_SIZE) : DEFAULT_LISTING_PAGE_SIZE;
+    if(!pager->ReadPage(page_size, entries)) {
+      _listings.erase(cursor);
+      cursor = 0;
+    }
+  } else {
+    status = ListingStatus::LISTING_FAILED;
+    cursor = 0;
+  }
+
+  // sorted names share long prefixes, otherwise compression rarely pays off
+  auto page = DirectoryPager::SerializePage(entries, options._sort == DirectoryPager::SortBy::NAME);
+  auto data = std::make_shared<Data>(9 + page->GetCurrentSize());
+  data->Add(4, (unsigned char*)&req_id);
+  data->Add(1, &status);
+  data->Add(4, (unsigned char*)&cursor);
+  data->Add(page->GetCurrentSize(), page->GetCurrentDataRaw());
+  auto resource = std::make_shared<DataResource>(data);
+  return std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_LIST_RESP, resource);
+}
+
+bool FileTransferHandlerClient::PrefetchNextDirectory() {
+  if(!_directory_cache) {
+    return false;
+  }
+
+  if(!_prefetch_parent.empty()) {
+    std::vector<DirectoryListing::FileInfo> entries;
+    size_t budget = std::min(MAX_PREFETCHED_DIRECTORIES, _directory_cache->GetPrefetchBudget());
+    if(_directory_cache->Load(_prefetch_parent, entries)) {
+      std::string prefix = (_prefetch_parent.back() == '/') ? _prefetch_parent : _prefetch_parent + "/";
+      for(auto& info : entries) {
+        if(_prefetch_queue.size() >= budget) {
+          break;
+        }
+        if(info.is_directory) {
+          _prefetch_queue.push_back(prefix + info.name);
+        }
+      }
+    }
+    _prefetch_parent.clear();
+  }
+
+  while(!_prefetch_queue.empty()) {
+    std::string path = _prefetch_queue.front();
+    _prefetch_queue.pop_front();
+    if(!_directory_cache->IsCached(path)) {
+      std::vector<DirectoryListing::FileInfo> entries;
+      _directory_cache->Load(path, entries);
+      break;
+    }
+  }
+  return !_prefetch_queue.empty();
+}
+
+uint32_t FileTransferHandlerClient::NextListingCursor() {
+  do {
+    _listing_counter++;
+  } while(!_listing_counter || _listings.count(_listing_counter));
+  return _listing_counter;
+}
+
+void FileTransferHandlerClient::ExpireListings() {
+  auto now = std::chrono::steady_clock::now();
+  for(auto it = _listings.begin(); it != _listings.end();) {
+    if(now - it->second->GetLastUsed() > LISTING_SESSION_TIMEOUT) {
+      it = _listings.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  while(_listings.size() >= MAX_LISTING_SESSIONS) {
+    auto oldest = std::min_element(_listings.begin(), _listings.end(), [](auto& first, auto& second) {
+      return first.second->GetLastUsed() < second.second->GetLastUsed();
+    });
+    _listings.erase(oldest);
+  }
+}
 
 
 void FileTransferHandlerClient::MakeFileTransferRequest(uint32_t req_id,
                                 bool is_download_from_client,
+                                uint8_t flags,
                                 const std::string& path,
                                 std::shared_ptr<Connection> connection,
                                 const std::string& sever_host,
                                 int server_port) {
-  auto it = _transfers.find(req_id);
-  if(it != _transfers.end()) {
+  std::shared_ptr<FileTransfer> file_transfer = std::make_shared<FileTransfer>(GetSptr(), req_id, path, is_download_from_client, flags);
+  if(!AddTransfer(file_transfer)) {
     DLOG(error, "HandleFileTransferRequest : req id exists : {}", req_id);
     return;
   }
+  _scheduler->StartTransfer(file_transfer->GetHostId(),
+                            req_id,
+                            std::bind(&FileTransferHandlerClient::StartTransfer,
+                                      this,
+                                      file_transfer,
+                                      connection,
+                                      sever_host,
+                                      server_port));
+}
 
-  std::shared_ptr<FileTransfer> file_transfer = std::make_shared<FileTransfer>(GetSptr(), req_id, path, is_download_from_client);
-  _transfers.insert(std::make_pair(req_id, file_transfer));
+void FileTransferHandlerClient::StartTransfer(std::shared_ptr<FileTransfer> file_transfer,
+                                              std::shared_ptr<Connection> connection,
+                                              const std::string& sever_host,
+                                              int server_port) {
+  auto client = _connection_pool ? _connection_pool->Take() : nullptr;
+  if(client) {
+    client->SetManager(file_transfer);
+    file_transfer->OnClientConnected(client);
+    return;
+  }
   connection->CreateClient(server_port, sever_host, file_transfer);
 }
 
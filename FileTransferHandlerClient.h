@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+#include <map>
 #include <memory>
 #include <string>
 
@@ -7,14 +9,41 @@
 #include "Client.h"
 
 class Connection;
+class DataConnectionPool;
+class DirectoryCache;
+class DirectoryPager;
+class SimpleMessage;
 
 class FileTransferHandlerClient : public FileTransferHandler {
 public :
+  FileTransferHandlerClient();
+  void InitConnectionPool(std::shared_ptr<Connection> connection,
+                          const std::string& sever_host,
+                          int server_port);
+  void ClearConnectionPool();
+  std::shared_ptr<SimpleMessage> MakeDirectoryListingResponse(std::shared_ptr<Data> msg_data);
+  bool PrefetchNextDirectory();
   void MakeFileTransferRequest(uint32_t req_id,
                                 bool is_download_from_client,
+                                uint8_t flags,
                                 const std::string& path,
                                 std::shared_ptr<Connection> connection,
                                 const std::string& sever_host,
                                 int server_port);
+
+private :
+  void StartTransfer(std::shared_ptr<FileTransfer> file_transfer,
+                     std::shared_ptr<Connection> connection,
+                     const std::string& sever_host,
+                     int server_port);
+  uint32_t NextListingCursor();
+  void ExpireListings();
+
+  std::shared_ptr<DataConnectionPool> _connection_pool;
+  std::map<uint32_t, std::shared_ptr<DirectoryPager>> _listings;
+  uint32_t _listing_counter = 0;
+  std::shared_ptr<DirectoryCache> _directory_cache;
+  std::string _prefetch_parent;
+  std::deque<std::string> _prefetch_queue;
 };
 
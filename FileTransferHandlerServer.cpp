@@ -3,6 +3,7 @@
 #include "Logger.h"
 #include "DataResource.h"
 #include "MessageType.h"
+#include "TransferScheduler.h"
 #include "DirectoryListing.h"
 #include "StringUtils.h"
 
@@ -17,12 +18,11 @@ void FileTransferHandlerServer::HandleFileTransferInit(std::shared_ptr<Client> c
     return;
   }
 
-  auto it = _transfers.find(req_id);
-  if(it == _transfers.end()) {
+  std::shared_ptr<FileTransfer> file_transfer = FindTransfer(req_id);
+  if(!file_transfer) {
     DLOG(error, "HandleFileTransferInitMsg : req id doesn't exist : {}", req_id);
     return;
   }
-  std::shared_ptr<FileTransfer> file_transfer = it->second;
   client->SetManager(file_transfer);
 
   file_transfer->HandleTransferInit(client, data);
@@ -32,7 +32,10 @@ void FileTransferHandlerServer::HandleFileTransferInit(std::shared_ptr<Client> c
 std::shared_ptr<FileTransfer> FileTransferHandlerServer::MakeNewTransferReq(std::shared_ptr<Client> client,
                                                                             uint32_t reqest_id,
                                                                             const std::string& path,
-                                                                            bool is_download_from_client) {
+                                                                            bool is_download_from_client,
+                                                                            uint8_t flags,
+                                                                            std::shared_ptr<DownloadCache> download_cache,
+                                                                            const std::string& cache_key) {
   if (!is_download_from_client) {
     std::filesystem::path fs_path(path);
     bool is_directory = false;
@@ -49,8 +52,15 @@ std::shared_ptr<FileTransfer> FileTransferHandlerServer::MakeNewTransferReq(std:
     }
   }
 
-  std::shared_ptr<FileTransfer> file_transfer = std::make_shared<FileTransfer>(GetSptr(), reqest_id, path, is_download_from_client);
-  _transfers.insert(std::make_pair(reqest_id, file_transfer));
-  file_transfer->SendTransferRequestMsg(client);
+  std::shared_ptr<FileTransfer> file_transfer = std::make_shared<FileTransfer>(GetSptr(), reqest_id, path, is_download_from_client, flags);
+  if(!AddTransfer(file_transfer)) {
+    DLOG(error, "MakeNewTransferReq : req id exists : {}", reqest_id);
+    return nullptr;
+  }
+  if(flags & FileTransfer::Flags::DELTA) {
+    file_transfer->SetDownloadCache(download_cache, cache_key);
+  }
+  file_transfer->SetHostId(client->GetId());
+  _scheduler->StartTransfer(client->GetId(), reqest_id, std::bind(&FileTransfer::SendTransferRequestMsg, file_transfer, client));
   return file_transfer;
 }
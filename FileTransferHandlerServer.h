@@ -12,7 +12,10 @@ public :
   std::shared_ptr<FileTransfer> MakeNewTransferReq(std::shared_ptr<Client> client,
                                                    uint32_t reqest_id,
                                                    const std::string& path,
-                                                   bool is_download_from_client);
+                                                   bool is_download_from_client,
+                                                   uint8_t flags,
+                                                   std::shared_ptr<DownloadCache> download_cache,
+                                                   const std::string& cache_key);
 
 protected :
   virtual void HandleFileTransferInit(std::shared_ptr<Client> client, std::shared_ptr<Data> data);
@@ -25,6 +25,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "JsonMsg.h"
 #include "Data.h"
 
+#include <algorithm>
+
 
 const std::string EMPTY_JSON_STR = "{}";
 
@@ -70,6 +72,24 @@ void JsonMsg::TryDetectType() {
     _type = Type::TERMINAL_RESIZE;
   else if(!type.compare("file_req"))
     _type = Type::FILE_TRANSFER_REQ;
+  else if(!type.compare("exec_req"))
+    _type = Type::EXEC_REQ;
+  else if(!type.compare("terminal_group_set"))
+    _type = Type::TERMINAL_GROUP_SET;
+  else if(!type.compare("terminal_group_del"))
+    _type = Type::TERMINAL_GROUP_DEL;
+  else if(!type.compare("terminal_group_key"))
+    _type = Type::TERMINAL_GROUP_KEY_EVENT;
+  else if(!type.compare("terminal_view_req"))
+    _type = Type::TERMINAL_VIEW_REQ;
+  else if(!type.compare("terminal_view_del"))
+    _type = Type::TERMINAL_VIEW_DEL;
+  else if(!type.compare("terminal_view_ack"))
+    _type = Type::TERMINAL_VIEW_ACK;
+  else if(!type.compare("owner_key"))
+    _type = Type::OWNER_KEY;
+  else if(!type.compare("terminal_reattach"))
+    _type = Type::TERMINAL_REATTACH;
 }
 
 JsonMsg::Type JsonMsg::GetType() {
@@ -91,6 +111,39 @@ std::string JsonMsg::ValueToString(const nlohmann::json& json, const std::string
   return result;
 }
 
+std::vector<uint32_t> JsonMsg::ValueToIdList(const std::string& key) {
+  std::vector<uint32_t> result;
+  auto it_value = _json.find(key);
+  if(it_value == _json.end() || !it_value->is_array())
+    return result;
+
+  for(auto& value : *it_value) {
+    if(value.is_number_unsigned()) {
+      result.push_back(value.get<uint32_t>());
+    }
+  }
+  return result;
+}
+
+DirectoryPager::Options JsonMsg::ToListingOptions() {
+  DirectoryPager::Options options;
+  options._path = ValueToString("path");
+  options._filter = ValueToString("filter");
+  options._cursor = (uint32_t)std::max(0, ValueToInt("cursor"));
+  options._page_size = (uint32_t)std::max(0, ValueToInt("page_size"));
+  options._descending = ValueToInt("descending") > 0;
+
+  std::string sort = ValueToString("sort");
+  if(!sort.compare("name")) {
+    options._sort = DirectoryPager::SortBy::NAME;
+  } else if(!sort.compare("size")) {
+    options._sort = DirectoryPager::SortBy::SIZE;
+  } else if(!sort.compare("modified")) {
+    options._sort = DirectoryPager::SortBy::MODIFIED;
+  }
+  return options;
+}
+
 int JsonMsg::ValueToInt(const std::string& key) {
   return ValueToInt(_json, key);
 }
@@ -106,16 +159,19 @@ int JsonMsg::ValueToInt(const nlohmann::json& json, const std::string& key) {
   return result;
 }
 
-std::string JsonMsg::MakeRemoteHostConnectedMsg(int host_id,
-                                            const std::string& host_ip,
-                                            const std::string& host_user_name,
-                                            const std::string& host_name) {
+std::string JsonMsg::MakeRemoteHostsConnectedMsg(const std::map<uint32_t, RemoteHostInfo>& remote_hosts) {
+  auto hosts = nlohmann::json::array();
+  for(auto& remote_host : remote_hosts) {
+    auto host = nlohmann::json::object();
+    host["host_id"] = remote_host.first;
+    host["host_ip"] = remote_host.second._ip;
+    host["host_user_name"] = remote_host.second._client_user_name;
+    host["host_name"] = remote_host.second._client_name;
+    hosts.push_back(host);
+  }
   auto jobj = nlohmann::json::object();
-  jobj["type"] = "host_connected";
-  jobj["host_id"] = host_id;
-  jobj["host_ip"] = host_ip;
-  jobj["host_user_name"] = host_user_name;
-  jobj["host_name"] = host_name;
+  jobj["type"] = "hosts_connected";
+  jobj["hosts"] = hosts;
   return jobj.dump();
 }
 
@@ -151,26 +207,86 @@ std::string JsonMsg::MakeTerminalClosed(int terminal_id, int host_id) {
   jobj["host_id"] = host_id;
   return jobj.dump();
 }
+std::string JsonMsg::MakeTerminalWriteStateMsg(uint32_t terminal_id, bool blocked, uint32_t dropped_bytes) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "terminal_write_state";
+  jobj["terminal_id"] = terminal_id;
+  jobj["blocked"] = blocked;
+  jobj["dropped"] = dropped_bytes;
+  return jobj.dump();
+}
 
-std::string JsonMsg::MakeDirectoryListingMsg(int terminal_id, const std::string& req_path, const std::vector<DirectoryListing::FileInfo>& files) {
+std::string JsonMsg::MakeTerminalViewMsg(uint32_t terminal_id, uint32_t remote_host_id) {
   auto jobj = nlohmann::json::object();
-  jobj["type"] = "directory_listing_received";
+  jobj["type"] = "terminal_view";
   jobj["terminal_id"] = terminal_id;
-  jobj["req_path"] = req_path;
-  auto jfile_array = nlohmann::json::array();
-
-  for(auto file : files) {
-    auto info = nlohmann::json::object();
-    info["name"] = file.name;
-    info["size"] = file.size;
-    info["last_mod"] = file.last_modified;
-    info["is_dir"] = file.is_directory;
-    jfile_array.push_back(info);
-  }
-  jobj["files"] = jfile_array;
+  jobj["host_id"] = remote_host_id;
+  return jobj.dump();
+}
+
+std::string JsonMsg::MakeTerminalViewSkippedMsg(uint32_t terminal_id, size_t skipped_bytes) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "terminal_view_skipped";
+  jobj["terminal_id"] = terminal_id;
+  jobj["bytes"] = skipped_bytes;
+  return jobj.dump();
+}
+
+std::string JsonMsg::MakeTerminalGroupMsg(uint32_t group_id, const std::vector<uint32_t>& terminal_ids) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "terminal_group";
+  jobj["group_id"] = group_id;
+  jobj["terminal_ids"] = terminal_ids;
   return jobj.dump();
 }
 
+std::string JsonMsg::MakeTerminalOrphansMsg(uint32_t remote_host_id, const std::vector<uint32_t>& terminal_ids) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "terminal_orphans";
+  jobj["host_id"] = remote_host_id;
+  jobj["terminal_ids"] = terminal_ids;
+  return jobj.dump();
+}
+
+std::string JsonMsg::MakeDistributionStartedMsg(uint32_t job_id) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "distribution_started";
+  jobj["job_id"] = job_id;
+  return jobj.dump();
+}
+
+std::string JsonMsg::MakeExecStartedMsg(uint32_t exec_id, const std::string& command, const std::vector<uint32_t>& host_ids) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "exec_started";
+  jobj["exec_id"] = exec_id;
+  jobj["command"] = command;
+  jobj["host_ids"] = host_ids;
+  return jobj.dump();
+}
+
+std::string JsonMsg::MakeExecOutputMsg(uint32_t exec_id, uint32_t host_id, uint8_t stream, std::shared_ptr<Data> output) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "exec_output";
+  jobj["exec_id"] = exec_id;
+  jobj["host_id"] = host_id;
+  jobj["stream"] = stream;
+  std::vector<uint8_t> vec((uint8_t*)output->GetCurrentDataRaw(),
+                          (uint8_t*)output->GetCurrentDataRaw() + (size_t)output->GetCurrentSize());
+  jobj["output"] = nlohmann::json::binary(vec);
+  return jobj.dump();
+}
+
+std::string JsonMsg::MakeExecEndMsg(uint32_t exec_id, uint32_t host_id, int32_t exit_code, uint8_t flags) {
+  auto jobj = nlohmann::json::object();
+  jobj["type"] = "exec_end";
+  jobj["exec_id"] = exec_id;
+  jobj["host_id"] = host_id;
+  jobj["exit_code"] = exit_code;
+  jobj["flags"] = flags;
+  return jobj.dump();
+}
+
+
 std::string JsonMsg::Empty() {
   return EMPTY_JSON_STR;
 }
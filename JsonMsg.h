@@ -24,14 +24,21 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include "nlohmann/json.hpp"
-#include "DirectoryListing.h"
+#include "DirectoryPager.h"
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 class Data;
 
+struct RemoteHostInfo {
+  std::string _ip;
+  std::string _client_user_name;
+  std::string _client_name;
+};
+
 class JsonMsg {
 public:
   enum Type {
@@ -43,24 +50,40 @@ public:
     TERMINAL_RESIZE,
     TERMINAL_KEY_EVENT,
     FILE_TRANSFER_REQ,
+    EXEC_REQ,
+    TERMINAL_GROUP_SET,
+    TERMINAL_GROUP_DEL,
+    TERMINAL_GROUP_KEY_EVENT,
+    TERMINAL_VIEW_REQ,
+    TERMINAL_VIEW_DEL,
+    TERMINAL_VIEW_ACK,
+    OWNER_KEY,
+    TERMINAL_REATTACH,
   };
 
   JsonMsg();
   bool Parse(const std::string& str);
   std::string ToString();
   Type GetType();
-  static std::string MakeRemoteHostConnectedMsg(int remote_host_id,
-                                            const std::string& client_ip,
-                                            const std::string& client_user_name,
-                                            const std::string& client_name);
+  static std::string MakeRemoteHostsConnectedMsg(const std::map<uint32_t, RemoteHostInfo>& remote_hosts);
   static std::string MakeClientDisconnectedMsg(int remote_host_id);
   static std::string MakeTerminalCreatedMsg(int remote_host_id, int terminal_id);
   static std::string MakeTerminalOutputMsg(int terminal_id, std::shared_ptr<Data> output);
   static std::string MakeTerminalClosed(int terminal_id, int remote_host_id);
-  static std::string MakeDirectoryListingMsg(int terminal_id, const std::string& req_path, const std::vector<DirectoryListing::FileInfo>& files);
+  static std::string MakeTerminalWriteStateMsg(uint32_t terminal_id, bool blocked, uint32_t dropped_bytes);
+  static std::string MakeTerminalViewMsg(uint32_t terminal_id, uint32_t remote_host_id);
+  static std::string MakeTerminalViewSkippedMsg(uint32_t terminal_id, size_t skipped_bytes);
+  static std::string MakeTerminalGroupMsg(uint32_t group_id, const std::vector<uint32_t>& terminal_ids);
+  static std::string MakeTerminalOrphansMsg(uint32_t remote_host_id, const std::vector<uint32_t>& terminal_ids);
+  static std::string MakeDistributionStartedMsg(uint32_t job_id);
+  static std::string MakeExecStartedMsg(uint32_t exec_id, const std::string& command, const std::vector<uint32_t>& host_ids);
+  static std::string MakeExecOutputMsg(uint32_t exec_id, uint32_t host_id, uint8_t stream, std::shared_ptr<Data> output);
+  static std::string MakeExecEndMsg(uint32_t exec_id, uint32_t host_id, int32_t exit_code, uint8_t flags);
   static std::string Empty();
   int ValueToInt(const std::string& key);
   std::string ValueToString(const std::string& key);
+  std::vector<uint32_t> ValueToIdList(const std::string& key);
+  DirectoryPager::Options ToListingOptions();
 private:
   void TryDetectType();
   std::string ValueToString(const nlohmann::json& json, const std::string& key);
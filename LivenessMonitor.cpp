@@ -0,0 +1,113 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "LivenessMonitor.h"
+#include "TaskTimer.h"
+
+#include <vector>
+
+const std::chrono::milliseconds LIVENESS_TICK(100);
+
+
+LivenessMonitor::LivenessMonitor(std::weak_ptr<LivenessListener> listener,
+                                 std::shared_ptr<TaskTimer> timer,
+                                 std::chrono::milliseconds idle_interval,
+                                 std::chrono::milliseconds pong_timeout)
+    : _listener(listener)
+    , _timer(timer)
+    , _idle_interval(idle_interval)
+    , _pong_timeout(pong_timeout)
+    , _wheel(LIVENESS_TICK) {
+}
+
+void LivenessMonitor::Init() {
+  _timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(LIVENESS_TICK),
+                   std::bind(&LivenessMonitor::Tick, shared_from_this()));
+}
+
+void LivenessMonitor::Add(uint32_t client_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _links[client_id] = {std::chrono::steady_clock::now(), {}};
+  _wheel.Schedule(client_id, _idle_interval);
+}
+
+void LivenessMonitor::Remove(uint32_t client_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _links.erase(client_id);
+  _wheel.Cancel(client_id);
+}
+
+void LivenessMonitor::OnActivity(uint32_t client_id) {
+  // the deadline isn't moved here, Tick() sees the timestamp when it expires
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _links.find(client_id);
+  if(it != _links.end()) {
+    it->second._last_activity = std::chrono::steady_clock::now();
+  }
+}
+
+void LivenessMonitor::Tick() {
+  std::vector<uint32_t> pings;
+  std::vector<uint32_t> timeouts;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = std::chrono::steady_clock::now();
+    std::vector<uint64_t> expired;
+    _wheel.Advance(now, expired);
+    for(uint64_t id : expired) {
+      uint32_t client_id = (uint32_t)id;
+      auto it = _links.find(client_id);
+      if(it == _links.end()) {
+        continue;
+      }
+      Link& link = it->second;
+      auto idle_time = now - link._last_activity;
+      if(idle_time < _idle_interval) {
+        link._ping_time = {};
+        _wheel.Schedule(id, std::chrono::duration_cast<std::chrono::milliseconds>(_idle_interval - idle_time));
+      } else if(link._ping_time == std::chrono::steady_clock::time_point()) {
+        link._ping_time = now;
+        pings.push_back(client_id);
+        _wheel.Schedule(id, _pong_timeout);
+      } else {
+        timeouts.push_back(client_id);
+        _links.erase(it);
+        _wheel.Cancel(id);
+      }
+    }
+  }
+
+  auto listener = _listener.lock();
+  if(!listener) {
+    return;
+  }
+  for(uint32_t client_id : pings) {
+    listener->OnLivenessPing(client_id);
+  }
+  for(uint32_t client_id : timeouts) {
+    listener->OnLivenessTimeout(client_id);
+  }
+  _timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(LIVENESS_TICK),
+                   std::bind(&LivenessMonitor::Tick, shared_from_this()));
+}
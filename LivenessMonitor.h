@@ -0,0 +1,74 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "TimerWheel.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class TaskTimer;
+
+class LivenessListener {
+public:
+  virtual void OnLivenessPing(uint32_t client_id) = 0;
+  virtual void OnLivenessTimeout(uint32_t client_id) = 0;
+};
+
+/*
+ Traffic-aware replacement of ConnectionChecker::MonitorClient. Any frame received from a client
+ proves it's alive, only links idle for idle_interval get a PING, and a client still silent
+ pong_timeout after it is reported. Deadlines live in a TimerWheel and are only looked at when
+ they expire, traffic just stores a timestamp.
+*/
+class LivenessMonitor : public std::enable_shared_from_this<LivenessMonitor> {
+public:
+  LivenessMonitor(std::weak_ptr<LivenessListener> listener,
+                  std::shared_ptr<TaskTimer> timer,
+                  std::chrono::milliseconds idle_interval,
+                  std::chrono::milliseconds pong_timeout);
+  void Init();
+  void Add(uint32_t client_id);
+  void Remove(uint32_t client_id);
+  void OnActivity(uint32_t client_id);
+
+private:
+  struct Link {
+    std::chrono::steady_clock::time_point _last_activity;
+    std::chrono::steady_clock::time_point _ping_time;
+  };
+
+  void Tick();
+
+  std::weak_ptr<LivenessListener> _listener;
+  std::shared_ptr<TaskTimer> _timer;
+  std::chrono::milliseconds _idle_interval;
+  std::chrono::milliseconds _pong_timeout;
+  std::mutex _mutex;
+  TimerWheel _wheel;
+  std::unordered_map<uint32_t, Link> _links;
+};
@@ -41,9 +41,44 @@ public:
     FILE_TRANSFER_REQ,
     FILE_TRANSFER_INIT,
     FILE_TRANSFER_ACK,
+    FILE_TRANSFER_DATA,
+    FILE_TRANSFER_DATA_ACK,
+    FILE_TRANSFER_END,
+    FILE_TRANSFER_DELTA_SIG,
+    FILE_LIST_REQ,
+    FILE_LIST_RESP,
+    FILE_TRANSFER_CACHED,
+    DIST_JOB,
+    DIST_READY,
+    DIST_JOIN,
+    DIST_CHUNK_REQ,
+    DIST_CHUNK,
+    DIST_PROGRESS,
+    DIST_DONE,
+    DIST_RELEASE,
+    EXEC_REQ,
+    EXEC_OUTPUT,
+    EXEC_END,
+    EXEC_CANCEL,
+    TERMINAL_GROUP,
+    ON_TERMINAL_GROUP_WRITE,
+    TERMINAL_WRITE_STATE,
+    TERMINAL_RESUME,
+    TERMINAL_RESYNC,
+    ON_TERMINAL_WRITE_ACKED,
+    LINK_COMPRESSION,
+    ON_TERMINAL_READ_DEFLATED,
     END
   };
 
+  // largest terminal output the server inflates from one ON_TERMINAL_READ_DEFLATED frame,
+  // bigger output is sent uncompressed
+  static constexpr uint32_t MAX_INFLATED_READ_SIZE = 64 * 1024;
+
+  // browser key a terminal is created for, sent with CREATE_TERMINAL and echoed back in TERMINAL_RESUME,
+  // zero filled when the browser didn't send one
+  static constexpr uint32_t OWNER_KEY_SIZE = 32;
+
   static Type TypeFromInt(uint8_t type) {
     if(type < Type::END)
       return (Type) type;
@@ -0,0 +1,258 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "PtyReactor.h"
+#include "PtyTerminal.h"
+#include "Data.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+const size_t MIN_READ_BUFFER_SIZE = 1024;
+const size_t MAX_READ_BUFFER_SIZE = 64 * 1024;
+const size_t INITIAL_READ_BUFFER_SIZE = 4 * 1024;
+// reads per terminal before moving on, a busy shell can't starve the others
+const int READS_PER_TURN = 4;
+const int MAX_EVENTS = 64;
+
+
+PtyReactor::PtyReactor(std::weak_ptr<TerminalListener> listener)
+    : _listener(listener)
+    , _epoll_fd(-1)
+    , _wake_fd(-1)
+    , _running(false)
+    , _read_enabled(true)
+    , _avg_read_size(INITIAL_READ_BUFFER_SIZE) {
+  _buffer.resize(INITIAL_READ_BUFFER_SIZE);
+}
+
+PtyReactor::~PtyReactor() {
+  if(_epoll_fd >= 0) {
+    close(_epoll_fd);
+  }
+  if(_wake_fd >= 0) {
+    close(_wake_fd);
+  }
+}
+
+bool PtyReactor::Init() {
+  _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if(_epoll_fd < 0) {
+    DLOG(error, "PtyReactor : epoll_create1 failed : {}", errno);
+    return false;
+  }
+
+  _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(_wake_fd < 0) {
+    DLOG(error, "PtyReactor : eventfd failed : {}", errno);
+    return false;
+  }
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = _wake_fd;
+  if(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &event)) {
+    DLOG(error, "PtyReactor : can't watch wake fd : {}", errno);
+    return false;
+  }
+
+  _running = true;
+  _thread = std::thread(std::bind(&PtyReactor::Run, shared_from_this()));
+  return true;
+}
+
+void PtyReactor::Stop() {
+  _running = false;
+  uint64_t value = 1;
+  if(_wake_fd >= 0 && write(_wake_fd, &value, sizeof(value)) < 0) {
+    DLOG(warn, "PtyReactor : wake failed : {}", errno);
+  }
+  if(!_thread.joinable()) {
+    return;
+  }
+  // the owner may be released from one of the reactor's own callbacks
+  if(_thread.get_id() == std::this_thread::get_id()) {
+    _thread.detach();
+  } else {
+    _thread.join();
+  }
+}
+
+bool PtyReactor::Add(std::shared_ptr<PtyTerminal> terminal) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  int fd = terminal->GetFd();
+  if(!SetInterest(fd, EPOLL_CTL_ADD)) {
+    return false;
+  }
+  _terminals[fd] = terminal;
+  return true;
+}
+
+void PtyReactor::Remove(std::shared_ptr<PtyTerminal> terminal) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _terminals.find(terminal->GetFd());
+  if(it == _terminals.end() || it->second != terminal) {
+    return;
+  }
+  epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, it->first, nullptr);
+  _terminals.erase(it);
+}
+
+void PtyReactor::EnableRead(bool enabled) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_read_enabled == enabled) {
+    return;
+  }
+  _read_enabled = enabled;
+  for(auto& terminal : _terminals) {
+    SetInterest(terminal.first, EPOLL_CTL_MOD);
+  }
+}
+
+bool PtyReactor::SetInterest(int fd, int op) {
+  struct epoll_event event = {};
+  // EPOLLOUT stays in the set, with edge triggering it only fires when a full PTY drains
+  event.events = _read_enabled ? (EPOLLIN | EPOLLOUT | EPOLLET) : (EPOLLOUT | EPOLLET);
+  event.data.fd = fd;
+  if(epoll_ctl(_epoll_fd, op, fd, &event)) {
+    DLOG(error, "PtyReactor : epoll_ctl failed for fd : {}, errno : {}", fd, errno);
+    return false;
+  }
+  return true;
+}
+
+void PtyReactor::Run() {
+  std::vector<struct epoll_event> events(MAX_EVENTS);
+  std::vector<int> pending;
+
+  while(_running) {
+    int count = epoll_wait(_epoll_fd, events.data(), MAX_EVENTS, pending.empty() ? -1 : 0);
+    if(count < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      DLOG(error, "PtyReactor : epoll_wait failed : {}", errno);
+      break;
+    }
+
+    for(int i = 0; i < count; ++i) {
+      int fd = events[i].data.fd;
+      if(fd == _wake_fd) {
+        uint64_t value;
+        while(read(_wake_fd, &value, sizeof(value)) > 0) {
+        }
+        continue;
+      }
+      if(events[i].events & EPOLLOUT) {
+        FlushWrites(fd);
+      }
+      if((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) &&
+         std::find(pending.begin(), pending.end(), fd) == pending.end()) {
+        pending.push_back(fd);
+      }
+    }
+
+    std::vector<int> ready;
+    ready.swap(pending);
+    for(int fd : ready) {
+      std::shared_ptr<PtyTerminal> terminal;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _terminals.find(fd);
+        if(it == _terminals.end() || !_read_enabled) {
+          continue;
+        }
+        terminal = it->second;
+      }
+
+      ReadResult result = ReadTerminal(terminal);
+      if(result == BUSY) {
+        pending.push_back(fd);
+      } else if(result == ENDED) {
+        Remove(terminal);
+        auto listener = _listener.lock();
+        if(listener) {
+          listener->OnTerminalEnd(terminal);
+        }
+      }
+    }
+  }
+}
+
+void PtyReactor::FlushWrites(int fd) {
+  std::shared_ptr<PtyTerminal> terminal;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _terminals.find(fd);
+    if(it == _terminals.end()) {
+      return;
+    }
+    terminal = it->second;
+  }
+  if(terminal->HasPendingWrites()) {
+    terminal->FlushWrites();
+  }
+}
+
+PtyReactor::ReadResult PtyReactor::ReadTerminal(std::shared_ptr<PtyTerminal> terminal) {
+  auto listener = _listener.lock();
+  if(!listener) {
+    return DRAINED;
+  }
+
+  for(int i = 0; i < READS_PER_TURN; ++i) {
+    ssize_t size = read(terminal->GetFd(), _buffer.data(), _buffer.size());
+    if(size > 0) {
+      listener->OnTerminalRead(terminal, std::make_shared<Data>((uint32_t)size, _buffer.data()));
+      UpdateBufferSize((size_t)size);
+      continue;
+    }
+    if(size < 0 && errno == EINTR) {
+      continue;
+    }
+    if(size < 0 && errno == EAGAIN) {
+      return DRAINED;
+    }
+    // EIO once the shell and everything it started closed the slave side
+    return ENDED;
+  }
+  return BUSY;
+}
+
+void PtyReactor::UpdateBufferSize(size_t read_size) {
+  _avg_read_size = (_avg_read_size * 7 + read_size) / 8;
+
+  size_t buffer_size = _buffer.size();
+  if(read_size == buffer_size && buffer_size < MAX_READ_BUFFER_SIZE) {
+    _buffer.resize(buffer_size * 2);
+  } else if(_avg_read_size < buffer_size / 8 && buffer_size > MIN_READ_BUFFER_SIZE) {
+    _buffer.resize(buffer_size / 2);
+    _buffer.shrink_to_fit();
+  }
+}
@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PtyTerminal;
+class TerminalListener;
+
+/*
+ Reads the PTY masters of all terminals with a single edge triggered epoll thread and
+ one reusable buffer sized from recent reads. Output goes to TerminalListener::OnTerminalRead
+ as it does for terminals with their own read task. Throttling removes EPOLLIN from the
+ interest set, edge triggering picks up whatever was left once it's added back.
+ Queued input is flushed from the same thread when a PTY becomes writable again.
+ The thread is owned and joined by Stop(), TerminalHandler stops the reactor before it goes away.
+*/
+class PtyReactor : public std::enable_shared_from_this<PtyReactor> {
+public:
+  PtyReactor(std::weak_ptr<TerminalListener> listener);
+  ~PtyReactor();
+  bool Init();
+  void Stop();
+  bool Add(std::shared_ptr<PtyTerminal> terminal);
+  void Remove(std::shared_ptr<PtyTerminal> terminal);
+  void EnableRead(bool enabled);
+
+private:
+  enum ReadResult {
+    DRAINED,
+    BUSY,
+    ENDED
+  };
+
+  void Run();
+  ReadResult ReadTerminal(std::shared_ptr<PtyTerminal> terminal);
+  void FlushWrites(int fd);
+  void UpdateBufferSize(size_t read_size);
+  bool SetInterest(int fd, int op);
+
+  std::weak_ptr<TerminalListener> _listener;
+  int _epoll_fd;
+  int _wake_fd;
+  std::atomic_bool _running;
+  std::thread _thread;
+  std::mutex _mutex;
+  std::map<int, std::shared_ptr<PtyTerminal>> _terminals; // by fd
+  bool _read_enabled;
+  std::vector<unsigned char> _buffer;
+  size_t _avg_read_size;
+};
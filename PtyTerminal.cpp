@@ -0,0 +1,268 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "PtyTerminal.h"
+#include "PtyZygote.h"
+#include "Logger.h"
+#include "TaskTimer.h"
+
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+const size_t WRITE_QUEUE_HIGH = 256 * 1024;
+const size_t WRITE_QUEUE_LOW = 64 * 1024;
+// input already in flight when the browser is told to hold, beyond this it's dropped
+const size_t MAX_WRITE_QUEUE = 4 * 1024 * 1024;
+// SIGHUP gets EXIT_WAIT_STEPS checks before SIGKILL, SIGKILL gets KILL_WAIT_STEPS before giving up
+const int EXIT_WAIT_STEPS = 10;
+const int KILL_WAIT_STEPS = 100;
+const std::chrono::milliseconds EXIT_WAIT_STEP(10);
+
+
+PtyTerminal::PtyTerminal(uint32_t terminal_id,
+                         std::shared_ptr<TerminalListener> listener,
+                         std::weak_ptr<TerminalWriteListener> write_listener,
+                         std::shared_ptr<TaskTimer> task_timer)
+    : Terminal(terminal_id, listener)
+    , _fd(-1)
+    , _pid(-1)
+    , _pidfd(-1)
+    , _write_listener(write_listener)
+    , _task_timer(task_timer)
+    , _write_offset(0)
+    , _pending_write_bytes(0)
+    , _write_blocked(false) {
+}
+
+PtyTerminal::~PtyTerminal() {
+  Terminate(_fd, _pid, _pidfd, _task_timer);
+}
+
+bool PtyTerminal::Spawn(const std::string& shell_cmd, int width, int height, int& out_fd, pid_t& out_pid, int& out_pidfd) {
+  if(PtyZygote::IsRunning() && PtyZygote::Spawn(shell_cmd, width, height, out_fd, out_pid, out_pidfd)) {
+    return true;
+  }
+  return PtyZygote::ForkShell(shell_cmd, width, height, out_fd, out_pid, out_pidfd);
+}
+
+void PtyTerminal::Terminate(int fd, pid_t pid, int pidfd, std::shared_ptr<TaskTimer> task_timer) {
+  if(fd >= 0) {
+    close(fd);
+  }
+  if(pid > 0 && !HasExited(pid, pidfd)) {
+    // the shell gets a moment to handle the hangup, closing many terminals doesn't wait for any of them
+    SendSignal(pid, pidfd, SIGHUP);
+    if(task_timer) {
+      task_timer->Schedule(EXIT_WAIT_STEP, std::bind(&PtyTerminal::WaitExit, pid, pidfd, std::weak_ptr<TaskTimer>(task_timer), 1));
+      return;
+    }
+    SendSignal(pid, pidfd, SIGKILL);
+  }
+  if(pidfd >= 0) {
+    close(pidfd);
+  }
+}
+
+void PtyTerminal::WaitExit(pid_t pid, int pidfd, std::weak_ptr<TaskTimer> task_timer, int step) {
+  if(HasExited(pid, pidfd)) {
+    if(pidfd >= 0) {
+      close(pidfd);
+    }
+    return;
+  }
+
+  if(step == EXIT_WAIT_STEPS) {
+    SendSignal(pid, pidfd, SIGKILL);
+  }
+  auto timer = task_timer.lock();
+  if(!timer || step >= EXIT_WAIT_STEPS + KILL_WAIT_STEPS) {
+    // stuck in the kernel or the client is going away, zygote shells are still reaped by the zygote
+    DLOG(warn, "PtyTerminal : shell {} hasn't exited, no longer waiting", pid);
+    SendSignal(pid, pidfd, SIGKILL);
+    if(pidfd >= 0) {
+      close(pidfd);
+    }
+    return;
+  }
+  timer->Schedule(EXIT_WAIT_STEP, std::bind(&PtyTerminal::WaitExit, pid, pidfd, task_timer, step + 1));
+}
+
+bool PtyTerminal::HasExited(pid_t pid, int pidfd) {
+  if(pidfd < 0) {
+    // no pidfd only for shells forked in this process, unreaped children keep their pid
+    return waitpid(pid, nullptr, WNOHANG) != 0;
+  }
+
+  struct pollfd exit_poll = {pidfd, POLLIN, 0};
+  if(poll(&exit_poll, 1, 0) <= 0) {
+    return false;
+  }
+  // reaps shells forked in this process, zygote shells fail with ECHILD and are reaped there
+  siginfo_t info = {};
+  waitid((idtype_t)P_PIDFD, (id_t)pidfd, &info, WEXITED | WNOHANG);
+  return true;
+}
+
+void PtyTerminal::SendSignal(pid_t pid, int pidfd, int signal_num) {
+  if(pidfd >= 0) {
+    syscall(SYS_pidfd_send_signal, pidfd, signal_num, nullptr, 0);
+  } else {
+    kill(pid, signal_num);
+  }
+}
+
+bool PtyTerminal::Start(const std::string& shell_cmd) {
+  int fd = -1;
+  pid_t pid = -1;
+  int pidfd = -1;
+  if(!Spawn(shell_cmd, 0, 0, fd, pid, pidfd)) {
+    return false;
+  }
+  Attach(fd, pid, pidfd);
+  return true;
+}
+
+void PtyTerminal::Attach(int fd, pid_t pid, int pidfd) {
+  _fd = fd;
+  _pid = pid;
+  _pidfd = pidfd;
+}
+
+int PtyTerminal::GetFd() {
+  return _fd;
+}
+
+void PtyTerminal::Resize(int width, int height) {
+  struct winsize size = {};
+  size.ws_col = (unsigned short)width;
+  size.ws_row = (unsigned short)height;
+  if(ioctl(_fd, TIOCSWINSZ, &size)) {
+    DLOG(warn, "PtyTerminal : resize failed : {}", GetId());
+  }
+}
+
+void PtyTerminal::Write(const std::string& data) {
+  bool notify = false;
+  bool blocked = false;
+  uint32_t dropped_bytes = 0;
+  {
+    std::lock_guard<std::mutex> lock(_write_mutex);
+    if(_pending_write_bytes + data.size() > MAX_WRITE_QUEUE) {
+      // a writer that ignored the blocked state, the owner is told what was lost
+      DLOG(warn, "PtyTerminal : write queue full : {}, dropped {} bytes", GetId(), data.size());
+      notify = true;
+      dropped_bytes = (uint32_t)data.size();
+    } else {
+      _write_queue.append(data);
+      WriteQueued();
+      notify = UpdateWriteBlocked();
+    }
+    blocked = _write_blocked;
+  }
+
+  auto listener = _write_listener.lock();
+  if(notify && listener) {
+    listener->OnTerminalWriteState(GetId(), blocked, dropped_bytes);
+  }
+}
+
+bool PtyTerminal::HasPendingWrites() {
+  return _pending_write_bytes > 0;
+}
+
+void PtyTerminal::FlushWrites() {
+  bool notify = false;
+  bool blocked = false;
+  {
+    std::lock_guard<std::mutex> lock(_write_mutex);
+    WriteQueued();
+    notify = UpdateWriteBlocked();
+    blocked = _write_blocked;
+  }
+
+  auto listener = _write_listener.lock();
+  if(notify && listener) {
+    listener->OnTerminalWriteState(GetId(), blocked, 0);
+  }
+}
+
+void PtyTerminal::ReleaseBuffers() {
+  std::lock_guard<std::mutex> lock(_write_mutex);
+  _write_queue.erase(0, _write_offset);
+  _write_offset = 0;
+  _write_queue.shrink_to_fit();
+}
+
+void PtyTerminal::WriteQueued() {
+  while(_write_offset < _write_queue.size()) {
+    ssize_t written = write(_fd, _write_queue.data() + _write_offset, _write_queue.size() - _write_offset);
+    if(written > 0) {
+      _write_offset += (size_t)written;
+      continue;
+    }
+    if(written < 0 && errno == EINTR) {
+      continue;
+    }
+    if(written < 0 && errno == EAGAIN) {
+      break;
+    }
+    DLOG(warn, "PtyTerminal : write failed : {}, dropped {} bytes", GetId(), _write_queue.size() - _write_offset);
+    _write_offset = _write_queue.size();
+  }
+
+  if(_write_offset == _write_queue.size()) {
+    _write_queue.clear();
+    _write_offset = 0;
+  } else if(_write_offset > WRITE_QUEUE_LOW) {
+    _write_queue.erase(0, _write_offset);
+    _write_offset = 0;
+  }
+  _pending_write_bytes = _write_queue.size() - _write_offset;
+}
+
+bool PtyTerminal::UpdateWriteBlocked() {
+  if(!_write_blocked && _pending_write_bytes > WRITE_QUEUE_HIGH) {
+    _write_blocked = true;
+    return true;
+  }
+  if(_write_blocked && _pending_write_bytes <= WRITE_QUEUE_LOW) {
+    _write_blocked = false;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+#include "Terminal.h"
+
+class TaskTimer;
+
+class TerminalWriteListener {
+public:
+  virtual void OnTerminalWriteState(uint32_t terminal_id, bool blocked, uint32_t dropped_bytes) = 0;
+};
+
+/*
+ Terminal whose PTY master is read by PtyReactor instead of a read task of its own.
+ The base Terminal is only used for its id, so listeners keep getting the same type.
+ Input is queued and written without blocking, the reactor flushes the rest on EPOLLOUT.
+ The write listener is told to hold input while the queue is above its high watermark,
+ and about input dropped because the queue was already full.
+ The shell is signalled and watched through a pidfd when there is one, zygote shells are reaped
+ by the zygote and their pid alone could already belong to another process.
+ Closing doesn't wait for the shell, the task timer checks for its exit and kills it if it lingers.
+*/
+class PtyTerminal : public Terminal {
+public:
+  PtyTerminal(uint32_t terminal_id,
+              std::shared_ptr<TerminalListener> listener,
+              std::weak_ptr<TerminalWriteListener> write_listener,
+              std::shared_ptr<TaskTimer> task_timer);
+  ~PtyTerminal();
+  static bool Spawn(const std::string& shell_cmd, int width, int height, int& out_fd, pid_t& out_pid, int& out_pidfd);
+  static void Terminate(int fd, pid_t pid, int pidfd, std::shared_ptr<TaskTimer> task_timer);
+  static bool HasExited(pid_t pid, int pidfd);
+  bool Start(const std::string& shell_cmd);
+  void Attach(int fd, pid_t pid, int pidfd);
+  int GetFd();
+  void Resize(int width, int height);
+  void Write(const std::string& data);
+  bool HasPendingWrites();
+  void FlushWrites();
+  void ReleaseBuffers();
+private:
+  static void SendSignal(pid_t pid, int pidfd, int signal_num);
+  static void WaitExit(pid_t pid, int pidfd, std::weak_ptr<TaskTimer> task_timer, int step);
+  void WriteQueued();
+  bool UpdateWriteBlocked();
+
+  int _fd;
+  pid_t _pid;
+  int _pidfd;
+  std::weak_ptr<TerminalWriteListener> _write_listener;
+  std::shared_ptr<TaskTimer> _task_timer;
+  std::mutex _write_mutex;
+  std::string _write_queue;
+  size_t _write_offset;
+  std::atomic<size_t> _pending_write_bytes;
+  bool _write_blocked;
+};
@@ -0,0 +1,352 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "PtyZygote.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+extern char** environ;
+
+const std::string ZYGOTE_PATH_ENV = "TERMINAL_ZYGOTE_PATH";
+const std::string ZYGOTE_HELPER_NAME = "term_zygote";
+const std::string SHELL_TERM = "TERM=xterm-256color";
+const size_t MAX_REQUEST_SIZE = 64 * 1024;
+const size_t REQUEST_HEADER_SIZE = 4;
+const size_t RESPONSE_SIZE = 5;
+const size_t RESPONSE_FDS = 2;
+// exited shells are reaped at least this often while no requests come in
+const int REAP_INTERVAL_MS = 1000;
+
+std::mutex PtyZygote::_mutex;
+int PtyZygote::_socket = -1;
+pid_t PtyZygote::_pid = -1;
+
+
+bool PtyZygote::Start() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_socket >= 0) {
+    return true;
+  }
+
+  // without the helper shells are forked in process, there is nothing to start
+  std::string helper = FindHelper();
+  if(helper.empty()) {
+    DLOG(info, "PtyZygote : {} not found, shells are forked in process", ZYGOTE_HELPER_NAME);
+    return false;
+  }
+
+  int fds[2];
+  if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds)) {
+    DLOG(error, "PtyZygote : socketpair failed : {}", errno);
+    return false;
+  }
+
+  // only async-signal-safe calls are allowed after fork, everything else is prepared here
+  std::string socket_arg = std::to_string(fds[1]);
+  char* const argv[] = {(char*)helper.c_str(), (char*)socket_arg.c_str(), nullptr};
+  struct rlimit fd_limit = {};
+  int max_fd = getrlimit(RLIMIT_NOFILE, &fd_limit) || fd_limit.rlim_cur == RLIM_INFINITY ? 65536 : (int)fd_limit.rlim_cur;
+
+  pid_t pid = fork();
+  if(pid < 0) {
+    DLOG(error, "PtyZygote : fork failed : {}", errno);
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+
+  if(!pid) {
+    setsid();
+    CloseInheritedFds(fds[1], max_fd);
+    fcntl(fds[1], F_SETFD, 0);
+    execve(argv[0], argv, environ);
+    _exit(127);
+  }
+
+  close(fds[1]);
+  _socket = fds[0];
+  _pid = pid;
+  DLOG(info, "PtyZygote : started {} : {}", pid, helper);
+  return true;
+}
+
+bool PtyZygote::IsRunning() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _socket >= 0;
+}
+
+bool PtyZygote::Spawn(const std::string& shell_cmd, int width, int height, int& out_fd, pid_t& out_pid, int& out_pidfd) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_socket < 0) {
+    return false;
+  }
+
+  std::vector<unsigned char> request(REQUEST_HEADER_SIZE + shell_cmd.size());
+  uint16_t width_val = (uint16_t)width;
+  uint16_t height_val = (uint16_t)height;
+  memcpy(request.data(), &width_val, 2);
+  memcpy(request.data() + 2, &height_val, 2);
+  memcpy(request.data() + REQUEST_HEADER_SIZE, shell_cmd.data(), shell_cmd.size());
+  if(send(_socket, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+    DLOG(error, "PtyZygote : request failed : {}", errno);
+    Stop();
+    return false;
+  }
+
+  unsigned char response[RESPONSE_SIZE];
+  char control[CMSG_SPACE(RESPONSE_FDS * sizeof(int))];
+  struct iovec iov = {response, RESPONSE_SIZE};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t size = 0;
+  while((size = recvmsg(_socket, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {
+  }
+  if(size != (ssize_t)RESPONSE_SIZE) {
+    DLOG(error, "PtyZygote : no response, zygote is gone");
+    Stop();
+    return false;
+  }
+
+  // master fd and pidfd, the pid alone could be reused once the zygote reaps the shell
+  int fds[RESPONSE_FDS] = {-1, -1};
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+     cmsg->cmsg_len == CMSG_LEN(RESPONSE_FDS * sizeof(int))) {
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  }
+  if(!response[0] || fds[0] < 0 || fds[1] < 0) {
+    DLOG(warn, "PtyZygote : spawn failed");
+    for(int fd : fds) {
+      if(fd >= 0) {
+        close(fd);
+      }
+    }
+    return false;
+  }
+
+  memcpy(&out_pid, response + 1, 4);
+  out_fd = fds[0];
+  out_pidfd = fds[1];
+  return true;
+}
+
+void PtyZygote::Stop() {
+  close(_socket);
+  _socket = -1;
+  waitpid(_pid, nullptr, WNOHANG);
+}
+
+int PtyZygote::Run(int socket_fd) {
+  // shells stay zombies until reaped here, so a pidfd is always opened on the right process
+  signal(SIGINT, SIG_IGN);
+  signal(SIGHUP, SIG_IGN);
+
+  std::vector<unsigned char> request(MAX_REQUEST_SIZE);
+  while(true) {
+    ReapChildren();
+    struct pollfd socket_poll = {socket_fd, POLLIN, 0};
+    int ready = poll(&socket_poll, 1, REAP_INTERVAL_MS);
+    if(ready < 0 && errno != EINTR) {
+      break;
+    }
+    if(ready <= 0) {
+      continue;
+    }
+
+    ssize_t size = recv(socket_fd, request.data(), request.size(), 0);
+    if(size < 0 && errno == EINTR) {
+      continue;
+    }
+    if(size < (ssize_t)REQUEST_HEADER_SIZE) {
+      // client closed the socket or exited
+      break;
+    }
+
+    uint16_t width = 0;
+    uint16_t height = 0;
+    memcpy(&width, request.data(), 2);
+    memcpy(&height, request.data() + 2, 2);
+    std::string shell_cmd((char*)request.data() + REQUEST_HEADER_SIZE, (size_t)size - REQUEST_HEADER_SIZE);
+
+    int fds[RESPONSE_FDS] = {-1, -1};
+    pid_t pid = -1;
+    bool spawned = ForkShell(shell_cmd, width, height, fds[0], pid, fds[1]);
+    if(spawned && fds[1] < 0) {
+      // no pidfd support, the client falls back to forking shells it can wait for itself
+      kill(pid, SIGKILL);
+      close(fds[0]);
+      fds[0] = -1;
+      spawned = false;
+    }
+
+    unsigned char response[RESPONSE_SIZE] = {};
+    response[0] = (unsigned char)spawned;
+    memcpy(response + 1, &pid, 4);
+
+    char control[CMSG_SPACE(RESPONSE_FDS * sizeof(int))] = {};
+    struct iovec iov = {response, RESPONSE_SIZE};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if(spawned) {
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN(RESPONSE_FDS * sizeof(int));
+      memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    }
+
+    ssize_t sent = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+    for(int fd : fds) {
+      if(fd >= 0) {
+        close(fd);
+      }
+    }
+    if(sent < 0) {
+      break;
+    }
+  }
+  close(socket_fd);
+  return 0;
+}
+
+bool PtyZygote::ForkShell(const std::string& shell_cmd, int width, int height, int& out_fd, pid_t& out_pid, int& out_pidfd) {
+  struct winsize size = {};
+  size.ws_col = (unsigned short)width;
+  size.ws_row = (unsigned short)height;
+
+  // the client may be multithreaded, the child only gets to call async-signal-safe functions
+  std::string exec_cmd = "exec " + shell_cmd;
+  char* const argv[] = {(char*)"sh", (char*)"-c", (char*)exec_cmd.c_str(), nullptr};
+  std::vector<char*> envp;
+  for(char** env = environ; env && *env; ++env) {
+    if(strncmp(*env, "TERM=", 5)) {
+      envp.push_back(*env);
+    }
+  }
+  envp.push_back((char*)SHELL_TERM.c_str());
+  envp.push_back(nullptr);
+
+  int fd = -1;
+  pid_t pid = forkpty(&fd, nullptr, nullptr, (width > 0 && height > 0) ? &size : nullptr);
+  if(pid < 0) {
+    DLOG(error, "PtyZygote : forkpty failed : {}", errno);
+    return false;
+  }
+
+  if(!pid) {
+    // the zygote may run with signals blocked, the shell shouldn't inherit that
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigprocmask(SIG_SETMASK, &signals, nullptr);
+    signal(SIGCHLD, SIG_DFL);
+    execve("/bin/sh", argv, envp.data());
+    _exit(127);
+  }
+
+  // reads are edge triggered, the master has to be drained until EAGAIN
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  out_fd = fd;
+  out_pid = pid;
+  out_pidfd = OpenPidFd(pid);
+  return true;
+}
+
+int PtyZygote::OpenPidFd(pid_t pid) {
+  // the child isn't reaped yet, so the pid can't refer to anything else
+  int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+  if(pidfd < 0) {
+    DLOG(warn, "PtyZygote : pidfd_open failed : {}", errno);
+    return -1;
+  }
+  fcntl(pidfd, F_SETFD, FD_CLOEXEC);
+  return pidfd;
+}
+
+void PtyZygote::ReapChildren() {
+  while(waitpid(-1, nullptr, WNOHANG) > 0) {
+  }
+}
+
+std::string PtyZygote::FindHelper() {
+  char* path = std::getenv(ZYGOTE_PATH_ENV.c_str());
+  if(path) {
+    return access(path, X_OK) ? std::string() : std::string(path);
+  }
+
+  // next to libterm_client.so
+  Dl_info info;
+  if(!dladdr((void*)&PtyZygote::Run, &info) || !info.dli_fname) {
+    return {};
+  }
+  std::string lib_path = info.dli_fname;
+  size_t slash = lib_path.rfind('/');
+  std::string helper = (slash == std::string::npos) ? ZYGOTE_HELPER_NAME : lib_path.substr(0, slash + 1) + ZYGOTE_HELPER_NAME;
+  if(helper.find('/') == std::string::npos) {
+    helper = "./" + helper;
+  }
+  return access(helper.c_str(), X_OK) ? std::string() : helper;
+}
+
+void PtyZygote::CloseInheritedFds(int keep_fd, int max_fd) {
+  // runs between fork and exec : raw syscalls only, sockets of the host application must not stay open
+  if(keep_fd > STDERR_FILENO + 1 && syscall(SYS_close_range, STDERR_FILENO + 1, keep_fd - 1, 0)) {
+    for(int fd = STDERR_FILENO + 1; fd < keep_fd; ++fd) {
+      close(fd);
+    }
+  }
+  if(syscall(SYS_close_range, keep_fd + 1, ~0U, 0)) {
+    for(int fd = keep_fd + 1; fd < max_fd; ++fd) {
+      close(fd);
+    }
+  }
+}
@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+/*
+ Helper process doing all PTY forks for the client. libterm_client is loaded into host applications
+ of any size, forking those for every shell copies their page tables and stalls them. The zygote is
+ forked once at init() and execs the small term_zygote binary, shells are then forked from that process
+ and their PTY masters come back over a unix socket with SCM_RIGHTS, together with a pidfd the client
+ signals and polls instead of the pid. Without the helper binary or pidfd support shells are forked
+ in the client process.
+*/
+class PtyZygote {
+public:
+  static bool Start();
+  static bool IsRunning();
+  static bool Spawn(const std::string& shell_cmd, int width, int height, int& out_fd, pid_t& out_pid, int& out_pidfd);
+  static int Run(int socket_fd);
+  static bool ForkShell(const std::string& shell_cmd, int width, int height, int& out_fd, pid_t& out_pid, int& out_pidfd);
+private:
+  static std::string FindHelper();
+  static int OpenPidFd(pid_t pid);
+  static void ReapChildren();
+  static void CloseInheritedFds(int keep_fd, int max_fd);
+  static void Stop();
+
+  static std::mutex _mutex;
+  static int _socket;
+  static pid_t _pid;
+};
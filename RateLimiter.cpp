@@ -0,0 +1,52 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "RateLimiter.h"
+
+#include <algorithm>
+
+
+RateLimiter::RateLimiter(double rate, double burst)
+    : _rate(rate)
+    , _burst(std::max(burst, 1.0))
+    , _tokens(_burst)
+    , _last_refill(std::chrono::steady_clock::now()) {
+}
+
+bool RateLimiter::Acquire() {
+  if(_rate <= 0) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed = now - _last_refill;
+  _last_refill = now;
+  _tokens = std::min(_burst, _tokens + elapsed.count() * _rate);
+  if(_tokens < 1.0) {
+    return false;
+  }
+  _tokens -= 1.0;
+  return true;
+}
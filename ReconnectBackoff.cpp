@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "ReconnectBackoff.h"
+
+#include <algorithm>
+
+
+ReconnectBackoff::ReconnectBackoff(std::chrono::milliseconds min_delay, std::chrono::milliseconds max_delay)
+    : _min_delay(min_delay)
+    , _max_delay(max_delay)
+    , _attempts(0)
+    , _random(std::random_device()()) {
+}
+
+std::chrono::milliseconds ReconnectBackoff::NextDelay() {
+  uint32_t shift = std::min<uint32_t>(_attempts, 20);
+  int64_t window = std::min<int64_t>(_min_delay.count() << shift, _max_delay.count());
+  _attempts++;
+  std::uniform_int_distribution<int64_t> distribution(0, std::max<int64_t>(window, 0));
+  return std::chrono::milliseconds(distribution(_random));
+}
+
+void ReconnectBackoff::Reset() {
+  _attempts = 0;
+}
+
+uint32_t ReconnectBackoff::GetAttempts() {
+  return _attempts;
+}
@@ -0,0 +1,48 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/*
+ Exponential reconnect delay with full jitter : every attempt waits a random time
+ below min_delay * 2^attempt (capped at max_delay), so a fleet of clients that lost
+ the same server comes back spread over the window instead of all at once.
+*/
+class ReconnectBackoff {
+public:
+  ReconnectBackoff(std::chrono::milliseconds min_delay, std::chrono::milliseconds max_delay);
+  std::chrono::milliseconds NextDelay();
+  void Reset();
+  uint32_t GetAttempts();
+
+private:
+  std::chrono::milliseconds _min_delay;
+  std::chrono::milliseconds _max_delay;
+  uint32_t _attempts;
+  std::mt19937 _random;
+};
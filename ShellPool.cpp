@@ -0,0 +1,110 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "ShellPool.h"
+#include "PtyTerminal.h"
+#include "Logger.h"
+
+#include <sys/ioctl.h>
+
+
+ShellPool::ShellPool(const std::string& shell_cmd, size_t size, std::shared_ptr<TaskTimer> task_timer)
+    : _shell_cmd(shell_cmd)
+    , _size(size)
+    , _task_timer(task_timer)
+    , _width(0)
+    , _height(0)
+    , _hits(0)
+    , _misses(0) {
+}
+
+ShellPool::~ShellPool() {
+  for(auto& shell : _shells) {
+    PtyTerminal::Terminate(shell._fd, shell._pid, shell._pidfd, _task_timer);
+  }
+}
+
+bool ShellPool::Take(int& out_fd, pid_t& out_pid, int& out_pidfd) {
+  while(!_shells.empty()) {
+    WarmShell shell = _shells.front();
+    _shells.pop_front();
+
+    // a shell that exited while idle (broken rc file, idle timeout) is no use
+    if(PtyTerminal::HasExited(shell._pid, shell._pidfd)) {
+      DLOG(warn, "ShellPool : idle shell {} exited", shell._pid);
+      PtyTerminal::Terminate(shell._fd, -1, shell._pidfd, _task_timer);
+      continue;
+    }
+
+    auto idle_time = std::chrono::steady_clock::now() - shell._spawn_time;
+    DLOG(info, "ShellPool : took shell {} idle for {} ms",
+         shell._pid,
+         std::chrono::duration_cast<std::chrono::milliseconds>(idle_time).count());
+    out_fd = shell._fd;
+    out_pid = shell._pid;
+    out_pidfd = shell._pidfd;
+    ++_hits;
+    return true;
+  }
+  ++_misses;
+  return false;
+}
+
+void ShellPool::Refill() {
+  while(_shells.size() < _size) {
+    WarmShell shell;
+    auto start = std::chrono::steady_clock::now();
+    if(!PtyTerminal::Spawn(_shell_cmd, _width, _height, shell._fd, shell._pid, shell._pidfd)) {
+      return;
+    }
+    shell._spawn_time = std::chrono::steady_clock::now();
+    DLOG(info, "ShellPool : spawned shell {} in {} us",
+         shell._pid,
+         std::chrono::duration_cast<std::chrono::microseconds>(shell._spawn_time - start).count());
+    _shells.push_back(shell);
+  }
+}
+
+void ShellPool::SetWindowSize(int width, int height) {
+  if(width == _width && height == _height) {
+    return;
+  }
+  _width = width;
+  _height = height;
+
+  struct winsize size = {};
+  size.ws_col = (unsigned short)width;
+  size.ws_row = (unsigned short)height;
+  for(auto& shell : _shells) {
+    ioctl(shell._fd, TIOCSWINSZ, &size);
+  }
+}
+
+size_t ShellPool::GetHits() {
+  return _hits;
+}
+
+size_t ShellPool::GetMisses() {
+  return _misses;
+}
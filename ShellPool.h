@@ -0,0 +1,65 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+class TaskTimer;
+
+/*
+ Idle PTY + shell pairs spawned ahead of time, so a new terminal doesn't wait for the shell's
+ rc files. Idle shells follow the last terminal size, a taken shell already has its prompt drawn.
+ Used from the TerminalHandler's thread only.
+*/
+class ShellPool {
+public:
+  ShellPool(const std::string& shell_cmd, size_t size, std::shared_ptr<TaskTimer> task_timer);
+  ~ShellPool();
+  bool Take(int& out_fd, pid_t& out_pid, int& out_pidfd);
+  void Refill();
+  void SetWindowSize(int width, int height);
+  size_t GetHits();
+  size_t GetMisses();
+private:
+  struct WarmShell {
+    int _fd;
+    pid_t _pid;
+    int _pidfd;
+    std::chrono::steady_clock::time_point _spawn_time;
+  };
+
+  std::string _shell_cmd;
+  size_t _size;
+  std::shared_ptr<TaskTimer> _task_timer;
+  std::deque<WarmShell> _shells;
+  int _width;
+  int _height;
+  size_t _hits;
+  size_t _misses;
+};
@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "StreamCompressor.h"
+#include "Data.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const uint32_t OUT_BUFFER_SIZE = 64 * 1024;
+const uint32_t SAMPLE_SLICES = 4;
+const uint32_t SAMPLE_SLICE_SIZE = 1024;
+const double INCOMPRESSIBLE_ENTROPY = 7.5; // bits per byte
+const int GZIP_WINDOW_BITS = 15 + 16;
+const int DEFLATE_WINDOW_BITS = -15;
+const int MEM_LEVEL = 8;
+
+
+StreamCompressor::StreamCompressor(Format format, int level)
+    : _format(format)
+    , _level(level)
+    , _current_level(level)
+    , _is_initialized(false) {
+  std::memset(&_stream, 0, sizeof(_stream));
+}
+
+StreamCompressor::~StreamCompressor() {
+  if(_is_initialized) {
+    deflateEnd(&_stream);
+  }
+}
+
+bool StreamCompressor::Init() {
+  if(_is_initialized) {
+    return true;
+  }
+
+  int window_bits = (_format == Format::GZIP) ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
+  int res = deflateInit2(&_stream, _level, Z_DEFLATED, window_bits, MEM_LEVEL, Z_DEFAULT_STRATEGY);
+  if(res != Z_OK) {
+    DLOG(error, "StreamCompressor::Init : deflateInit2 failed : {}", res);
+    return false;
+  }
+  _out_buffer.resize(OUT_BUFFER_SIZE);
+  _is_initialized = true;
+  return true;
+}
+
+std::shared_ptr<Data> StreamCompressor::Compress(const unsigned char* data, uint32_t size, bool finish) {
+  if(!_is_initialized) {
+    DLOG(error, "StreamCompressor::Compress : not initialized");
+    return nullptr;
+  }
+
+  _output.clear();
+
+  // Blocks which look like random data are stored instead of deflated,
+  // the stream stays a single valid gzip / deflate stream either way.
+  if(size) {
+    int level = LooksIncompressible(data, size) ? Z_NO_COMPRESSION : _level;
+    if(!SetLevel(level)) {
+      return nullptr;
+    }
+  }
+
+  _stream.next_in = (Bytef*)data;
+  _stream.avail_in = size;
+
+  int flush = finish ? Z_FINISH : (_format == Format::DEFLATE ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+  if(!RunDeflate(flush)) {
+    return nullptr;
+  }
+
+  if(_output.empty()) {
+    return std::make_shared<Data>();
+  }
+  return std::make_shared<Data>((uint32_t)_output.size(), _output.data());
+}
+
+uint64_t StreamCompressor::GetTotalIn() {
+  return (uint64_t)_stream.total_in;
+}
+
+uint64_t StreamCompressor::GetTotalOut() {
+  return (uint64_t)_stream.total_out;
+}
+
+bool StreamCompressor::SetLevel(int level) {
+  if(level == _current_level) {
+    return true;
+  }
+
+  int res = Z_BUF_ERROR;
+  while(res == Z_BUF_ERROR) {
+    _stream.next_out = _out_buffer.data();
+    _stream.avail_out = (uInt)_out_buffer.size();
+    res = deflateParams(&_stream, level, Z_DEFAULT_STRATEGY);
+    _output.insert(_output.end(), _out_buffer.data(), _out_buffer.data() + (_out_buffer.size() - _stream.avail_out));
+    if(res == Z_BUF_ERROR && _stream.avail_out != 0) {
+      break;
+    }
+  }
+
+  if(res != Z_OK) {
+    DLOG(error, "StreamCompressor::SetLevel : deflateParams failed : {}", res);
+    return false;
+  }
+  _current_level = level;
+  return true;
+}
+
+bool StreamCompressor::RunDeflate(int flush) {
+  int res = Z_OK;
+  do {
+    _stream.next_out = _out_buffer.data();
+    _stream.avail_out = (uInt)_out_buffer.size();
+    res = deflate(&_stream, flush);
+    if(res == Z_STREAM_ERROR) {
+      DLOG(error, "StreamCompressor::RunDeflate : deflate failed");
+      return false;
+    }
+    _output.insert(_output.end(), _out_buffer.data(), _out_buffer.data() + (_out_buffer.size() - _stream.avail_out));
+  } while(_stream.avail_out == 0 || (flush == Z_FINISH && res != Z_STREAM_END));
+  return true;
+}
+
+bool StreamCompressor::LooksIncompressible(const unsigned char* data, uint32_t size) {
+  uint32_t counts[256] = {0};
+  uint32_t sampled = 0;
+
+  uint32_t slice_size = std::min(SAMPLE_SLICE_SIZE, size);
+  uint32_t stride = size / SAMPLE_SLICES;
+  for(uint32_t slice = 0; slice < SAMPLE_SLICES; ++slice) {
+    uint32_t begin = slice * stride;
+    uint32_t end = std::min(begin + slice_size, size);
+    for(uint32_t i = begin; i < end; ++i) {
+      counts[data[i]]++;
+    }
+    sampled += end - begin;
+    if(!stride) {
+      break;
+    }
+  }
+
+  if(!sampled) {
+    return false;
+  }
+
+  double entropy = 0;
+  for(uint32_t count : counts) {
+    if(count) {
+      double p = (double)count / sampled;
+      entropy -= p * std::log2(p);
+    }
+  }
+  return entropy > INCOMPRESSIBLE_ENTROPY;
+}
@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <zlib.h>
+
+class Data;
+
+class StreamCompressor {
+public:
+  enum Format {
+    GZIP = 0,
+    DEFLATE
+  };
+
+  StreamCompressor(Format format, int level);
+  ~StreamCompressor();
+  bool Init();
+  std::shared_ptr<Data> Compress(const unsigned char* data, uint32_t size, bool finish);
+  uint64_t GetTotalIn();
+  uint64_t GetTotalOut();
+  static bool LooksIncompressible(const unsigned char* data, uint32_t size);
+
+private:
+  bool SetLevel(int level);
+  bool RunDeflate(int flush);
+
+  Format _format;
+  int _level;
+  int _current_level;
+  bool _is_initialized;
+  z_stream _stream;
+  std::vector<unsigned char> _out_buffer;
+  std::vector<unsigned char> _output;
+};
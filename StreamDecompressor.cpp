@@ -0,0 +1,109 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "StreamDecompressor.h"
+#include "Data.h"
+#include "Logger.h"
+
+#include <cstring>
+
+const uint32_t OUT_BUFFER_SIZE = 64 * 1024;
+const int DEFLATE_WINDOW_BITS = -15;
+const unsigned char SYNC_FLUSH_TAIL[] = {0x00, 0x00, 0xff, 0xff};
+
+
+StreamDecompressor::StreamDecompressor(uint32_t max_output)
+    : _max_output(max_output)
+    , _is_initialized(false) {
+  std::memset(&_stream, 0, sizeof(_stream));
+}
+
+StreamDecompressor::~StreamDecompressor() {
+  if(_is_initialized) {
+    inflateEnd(&_stream);
+  }
+}
+
+bool StreamDecompressor::Init() {
+  if(_is_initialized) {
+    return true;
+  }
+
+  int res = inflateInit2(&_stream, DEFLATE_WINDOW_BITS);
+  if(res != Z_OK) {
+    DLOG(error, "StreamDecompressor::Init : inflateInit2 failed : {}", res);
+    return false;
+  }
+  _out_buffer.resize(OUT_BUFFER_SIZE);
+  _is_initialized = true;
+  return true;
+}
+
+std::shared_ptr<Data> StreamDecompressor::Decompress(const unsigned char* data, uint32_t size, bool restore_flush_tail) {
+  if(!_is_initialized) {
+    DLOG(error, "StreamDecompressor::Decompress : not initialized");
+    return nullptr;
+  }
+
+  _output.clear();
+  if(!RunInflate(data, size)) {
+    return nullptr;
+  }
+  if(restore_flush_tail && !RunInflate(SYNC_FLUSH_TAIL, sizeof(SYNC_FLUSH_TAIL))) {
+    return nullptr;
+  }
+
+  if(_output.empty()) {
+    return std::make_shared<Data>();
+  }
+  return std::make_shared<Data>((uint32_t)_output.size(), _output.data());
+}
+
+uint64_t StreamDecompressor::GetTotalIn() {
+  return (uint64_t)_stream.total_in;
+}
+
+uint64_t StreamDecompressor::GetTotalOut() {
+  return (uint64_t)_stream.total_out;
+}
+
+bool StreamDecompressor::RunInflate(const unsigned char* data, uint32_t size) {
+  _stream.next_in = (Bytef*)data;
+  _stream.avail_in = size;
+  do {
+    _stream.next_out = _out_buffer.data();
+    _stream.avail_out = (uInt)_out_buffer.size();
+    int res = inflate(&_stream, Z_SYNC_FLUSH);
+    if(res != Z_OK && res != Z_BUF_ERROR) {
+      DLOG(error, "StreamDecompressor::RunInflate : inflate failed : {}", res);
+      return false;
+    }
+    _output.insert(_output.end(), _out_buffer.data(), _out_buffer.data() + (_out_buffer.size() - _stream.avail_out));
+    if(_output.size() > _max_output) {
+      DLOG(error, "StreamDecompressor::RunInflate : output exceeds {} bytes", _max_output);
+      return false;
+    }
+  } while(_stream.avail_out == 0 || _stream.avail_in != 0);
+  return true;
+}
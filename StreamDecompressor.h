@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <zlib.h>
+
+class Data;
+
+/*
+ Inflates a raw deflate stream which arrives in sync flushed pieces, the counterpart of
+ StreamCompressor's DEFLATE format. The window persists between pieces. Senders may strip
+ the 00 00 ff ff trailer every sync flush ends with, Decompress puts it back when asked.
+ A piece inflating to more than max_output fails, a small frame can't expand without bound.
+*/
+class StreamDecompressor {
+public:
+  StreamDecompressor(uint32_t max_output);
+  ~StreamDecompressor();
+  bool Init();
+  std::shared_ptr<Data> Decompress(const unsigned char* data, uint32_t size, bool restore_flush_tail);
+  uint64_t GetTotalIn();
+  uint64_t GetTotalOut();
+
+private:
+  bool RunInflate(const unsigned char* data, uint32_t size);
+
+  uint32_t _max_output;
+  bool _is_initialized;
+  z_stream _stream;
+  std::vector<unsigned char> _out_buffer;
+  std::vector<unsigned char> _output;
+};
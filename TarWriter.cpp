@@ -0,0 +1,268 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TarWriter.h"
+#include "Data.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+
+namespace {
+
+const uint32_t TAR_BLOCK_SIZE = 512;
+const uint32_t TAR_NAME_SIZE = 100;
+const char TAR_TYPE_FILE = '0';
+const char TAR_TYPE_SYMLINK = '2';
+const char TAR_TYPE_DIR = '5';
+const char TAR_TYPE_LONG_NAME = 'L';
+const char TAR_TYPE_LONG_LINK = 'K';
+const std::string LONG_NAME_ENTRY = "././@LongLink";
+
+void WriteOctal(unsigned char* field, uint32_t field_size, uint64_t value) {
+  std::string octal(field_size - 1, '0');
+  for(int pos = (int)octal.size() - 1; pos >= 0 && value; --pos) {
+    octal[pos] = '0' + (value & 7);
+    value >>= 3;
+  }
+  memcpy(field, octal.c_str(), field_size);
+}
+
+// values that don't fit in the octal digits (files of 8 GiB and more) use
+// the GNU base-256 form : high bit of the first byte set, big-endian value
+void WriteNumber(unsigned char* field, uint32_t field_size, uint64_t value) {
+  uint32_t octal_bits = (field_size - 1) * 3;
+  if(octal_bits >= 64 || value < (1ULL << octal_bits)) {
+    WriteOctal(field, field_size, value);
+    return;
+  }
+  memset(field, 0, field_size);
+  for(int pos = (int)field_size - 1; pos > 0 && value; --pos) {
+    field[pos] = value & 0xFF;
+    value >>= 8;
+  }
+  field[0] = 0x80;
+}
+
+void WriteString(unsigned char* field, uint32_t field_size, const std::string& value) {
+  memcpy(field, value.c_str(), std::min((uint32_t)value.length(), field_size));
+}
+
+}
+
+
+TarWriter::TarWriter(const std::string& root_path)
+    : _root_path(root_path)
+    , _root_added(false)
+    , _finished(false)
+    , _file_remaining(0)
+    , _file_size(0)
+    , _entries_count(0)
+    , _total_size(0) {
+}
+
+bool TarWriter::Init() {
+  std::error_code fs_error;
+  _root_path = std::filesystem::absolute(_root_path, fs_error).lexically_normal();
+  if(!_root_path.has_filename()) {
+    _root_path = _root_path.parent_path();
+  }
+  _archive_root = _root_path.filename();
+  if(_archive_root.empty()) {
+    _archive_root = "root";
+  }
+
+  _dir_it = std::filesystem::recursive_directory_iterator(_root_path,
+                                                          std::filesystem::directory_options::skip_permission_denied,
+                                                          fs_error);
+  if(fs_error) {
+    DLOG(error, "TarWriter : can't open directory : {}", _root_path.string());
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<Data> TarWriter::ReadNextBlock(uint32_t max_size, bool& out_is_last) {
+  _output.clear();
+  while(_output.size() < max_size && !_finished) {
+    if(_file_remaining) {
+      ReadFileContent(max_size);
+    } else if(!OpenNextEntry()) {
+      // end of archive : two zero blocks
+      _output.resize(_output.size() + 2 * TAR_BLOCK_SIZE, 0);
+      _finished = true;
+    }
+  }
+  out_is_last = _finished;
+  _total_size += _output.size();
+  return std::make_shared<Data>((uint32_t)_output.size(), _output.data());
+}
+
+uint64_t TarWriter::GetEntriesCount() {
+  return _entries_count;
+}
+
+uint64_t TarWriter::GetTotalSize() {
+  return _total_size;
+}
+
+bool TarWriter::OpenNextEntry() {
+  if(!_root_added) {
+    _root_added = true;
+    if(AddEntry(_root_path)) {
+      return true;
+    }
+  }
+
+  std::error_code fs_error;
+  while(_dir_it != std::filesystem::recursive_directory_iterator()) {
+    std::filesystem::path path = _dir_it->path();
+    _dir_it.increment(fs_error);
+    if(fs_error) {
+      DLOG(warn, "TarWriter : directory iteration failed near : {}", path.string());
+      _dir_it = std::filesystem::recursive_directory_iterator();
+    }
+    if(AddEntry(path)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TarWriter::AddEntry(const std::filesystem::path& path) {
+  struct stat info;
+  if(lstat(path.c_str(), &info)) {
+    DLOG(warn, "TarWriter : can't stat : {}", path.string());
+    return false;
+  }
+
+  std::string name = (_archive_root / path.lexically_relative(_root_path)).lexically_normal().string();
+  uint32_t mode = info.st_mode & 07777;
+
+  if(S_ISDIR(info.st_mode)) {
+    if(name.back() != '/') {
+      name.push_back('/');
+    }
+    AddHeader(name, {}, TAR_TYPE_DIR, mode, info.st_uid, info.st_gid, 0, info.st_mtime);
+  } else if(S_ISLNK(info.st_mode)) {
+    std::error_code fs_error;
+    auto target = std::filesystem::read_symlink(path, fs_error);
+    if(fs_error) {
+      return false;
+    }
+    AddHeader(name, target.string(), TAR_TYPE_SYMLINK, mode, info.st_uid, info.st_gid, 0, info.st_mtime);
+  } else if(S_ISREG(info.st_mode)) {
+    _file.close();
+    _file.clear();
+    _file.open(path, std::ios::binary);
+    if(!_file.is_open()) {
+      DLOG(warn, "TarWriter : can't open : {}", path.string());
+      return false;
+    }
+    AddHeader(name, {}, TAR_TYPE_FILE, mode, info.st_uid, info.st_gid, (uint64_t)info.st_size, info.st_mtime);
+    _file_size = (uint64_t)info.st_size;
+    _file_remaining = _file_size;
+    if(!_file_remaining) {
+      _file.close();
+    }
+  } else {
+    // devices, fifos and sockets are not archived
+    return false;
+  }
+
+  _entries_count++;
+  return true;
+}
+
+void TarWriter::AddHeader(const std::string& name, const std::string& link_name, char type, uint32_t mode,
+                          uint32_t uid, uint32_t gid, uint64_t size, int64_t mtime) {
+  if(link_name.length() > TAR_NAME_SIZE) {
+    AddLongNameRecord(link_name, TAR_TYPE_LONG_LINK);
+  }
+  if(name.length() > TAR_NAME_SIZE) {
+    AddLongNameRecord(name, TAR_TYPE_LONG_NAME);
+  }
+
+  size_t offset = _output.size();
+  _output.resize(offset + TAR_BLOCK_SIZE, 0);
+  unsigned char* header = _output.data() + offset;
+
+  WriteString(header, TAR_NAME_SIZE, name);
+  WriteOctal(header + 100, 8, mode);
+  WriteOctal(header + 108, 8, uid);
+  WriteOctal(header + 116, 8, gid);
+  WriteNumber(header + 124, 12, size);
+  WriteNumber(header + 136, 12, (uint64_t)std::max<int64_t>(mtime, 0));
+  memset(header + 148, ' ', 8);
+  header[156] = type;
+  WriteString(header + 157, TAR_NAME_SIZE, link_name);
+  WriteString(header + 257, 6, "ustar");
+  WriteString(header + 263, 2, "00");
+
+  uint32_t checksum = 0;
+  for(uint32_t i = 0; i < TAR_BLOCK_SIZE; ++i) {
+    checksum += header[i];
+  }
+  WriteOctal(header + 148, 7, checksum);
+}
+
+void TarWriter::AddLongNameRecord(const std::string& name, char type) {
+  AddHeader(LONG_NAME_ENTRY, {}, type, 0, 0, 0, name.length() + 1, 0);
+  _output.insert(_output.end(), name.begin(), name.end());
+  _output.push_back(0);
+  AddPadding(name.length() + 1);
+}
+
+void TarWriter::AddPadding(uint64_t size) {
+  uint32_t remainder = size % TAR_BLOCK_SIZE;
+  if(remainder) {
+    _output.resize(_output.size() + TAR_BLOCK_SIZE - remainder, 0);
+  }
+}
+
+void TarWriter::ReadFileContent(uint32_t max_size) {
+  uint32_t to_read = (uint32_t)std::min<uint64_t>(_file_remaining, max_size - std::min<size_t>(_output.size(), max_size));
+  if(!to_read) {
+    to_read = (uint32_t)std::min<uint64_t>(_file_remaining, TAR_BLOCK_SIZE);
+  }
+
+  size_t offset = _output.size();
+  _output.resize(offset + to_read, 0);
+  uint32_t read_size = 0;
+  if(_file.is_open()) {
+    _file.read((char*)_output.data() + offset, to_read);
+    read_size = (uint32_t)_file.gcount();
+  }
+  if(read_size < to_read && _file.is_open()) {
+    // file shrunk while archiving : keep the announced size, rest stays zeroed
+    DLOG(warn, "TarWriter : file changed during read, padding with zeros");
+    _file.close();
+  }
+
+  _file_remaining -= to_read;
+  if(!_file_remaining) {
+    _file.close();
+    AddPadding(_file_size);
+  }
+}
@@ -0,0 +1,62 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Data;
+
+class TarWriter {
+public:
+  TarWriter(const std::string& root_path);
+  bool Init();
+  std::shared_ptr<Data> ReadNextBlock(uint32_t max_size, bool& out_is_last);
+  uint64_t GetEntriesCount();
+  uint64_t GetTotalSize();
+
+private:
+  bool OpenNextEntry();
+  bool AddEntry(const std::filesystem::path& path);
+  void AddHeader(const std::string& name, const std::string& link_name, char type, uint32_t mode,
+                 uint32_t uid, uint32_t gid, uint64_t size, int64_t mtime);
+  void AddLongNameRecord(const std::string& name, char type);
+  void AddPadding(uint64_t size);
+  void ReadFileContent(uint32_t max_size);
+
+  std::filesystem::path _root_path;
+  std::filesystem::path _archive_root;
+  std::filesystem::recursive_directory_iterator _dir_it;
+  bool _root_added;
+  bool _finished;
+  std::ifstream _file;
+  uint64_t _file_remaining;
+  uint64_t _file_size;
+  uint64_t _entries_count;
+  uint64_t _total_size;
+  std::vector<unsigned char> _output;
+};
@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TaskTimer.h"
+
+
+TaskTimer::TaskTimer()
+    : _state(std::make_shared<State>()) {
+}
+
+TaskTimer::~TaskTimer() {
+  {
+    std::lock_guard<std::mutex> lock(_state->_mutex);
+    _state->_stop = true;
+  }
+  _state->_condition.notify_all();
+  if(!_thread.joinable()) {
+    return;
+  }
+  // last owner may drop the timer from inside one of its own tasks
+  if(_thread.get_id() == std::this_thread::get_id()) {
+    _thread.detach();
+  } else {
+    _thread.join();
+  }
+}
+
+void TaskTimer::Init() {
+  _thread = std::thread(&TaskTimer::Run, _state);
+}
+
+void TaskTimer::Schedule(std::chrono::microseconds delay, std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(_state->_mutex);
+    _state->_tasks.insert(std::make_pair(std::chrono::steady_clock::now() + delay, task));
+  }
+  _state->_condition.notify_all();
+}
+
+void TaskTimer::Run(std::shared_ptr<State> state) {
+  std::unique_lock<std::mutex> lock(state->_mutex);
+  while(!state->_stop) {
+    if(state->_tasks.empty()) {
+      state->_condition.wait(lock);
+      continue;
+    }
+
+    auto it = state->_tasks.begin();
+    if(it->first > std::chrono::steady_clock::now()) {
+      state->_condition.wait_until(lock, it->first);
+      continue;
+    }
+
+    auto task = it->second;
+    state->_tasks.erase(it);
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
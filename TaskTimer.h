@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+ Runs delayed tasks in deadline order on one thread. Each FileTransferHandler owns a single
+ instance that its scheduler and liveness checks share.
+*/
+class TaskTimer {
+public:
+  TaskTimer();
+  ~TaskTimer();
+  void Init();
+  void Schedule(std::chrono::microseconds delay, std::function<void()> task);
+
+private:
+  struct State {
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> _tasks;
+    bool _stop = false;
+  };
+
+  static void Run(std::shared_ptr<State> state);
+
+  std::shared_ptr<State> _state;
+  std::thread _thread;
+};
@@ -30,12 +30,33 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Data.h"
 #include "DataResource.h"
 #include "Connection.h"
+#include "TransferScheduler.h"
+#include "TaskTimer.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-const int READ_BLOCK_HIGH = 10;
-const int READ_BLOCK_LOW = 5;
+// the server acks reads in batches of up to 16, the window has to hold a few of them
+const int READ_BLOCK_HIGH = 64;
+const int READ_BLOCK_LOW = 32;
 const std::string TERMINAL_CLIENT_NAME_ENV = "TERMINAL_CLIENT_NAME";
+const std::string TERMINAL_SPILL_SIZE_ENV = "TERMINAL_SPILL_SIZE";
+const size_t DEFAULT_SPILL_SIZE = 1024 * 1024;
+const size_t RESYNC_CHUNK_SIZE = 64 * 1024;
+const std::string TERMINAL_IDLE_TIMEOUT_ENV = "TERMINAL_IDLE_TIMEOUT";
+const std::chrono::minutes DEFAULT_IDLE_TIMEOUT(15);
+const std::chrono::minutes IDLE_CHECK_INTERVAL(1);
+const std::string TERMINAL_COMPRESSION_LEVEL_ENV = "TERMINAL_COMPRESSION_LEVEL";
+const int DEFAULT_COMPRESSION_LEVEL = 3;
+// smaller output, a single echoed key for one, goes out as it is
+const size_t MIN_COMPRESSED_OUTPUT = 8;
+const unsigned char SYNC_FLUSH_TAIL[] = {0x00, 0x00, 0xff, 0xff};
+const std::chrono::milliseconds RECONNECT_MIN_DELAY(1000);
+const std::chrono::milliseconds RECONNECT_MAX_DELAY(30000);
+// same window the server's LivenessMonitor uses, a link that carried a frame in it isn't pinged
+const std::chrono::milliseconds PING_IDLE_INTERVAL(5000);
 
 
 std::shared_ptr<TerminalClient> TerminalClient::Create(std::shared_ptr<Connection> connection,
@@ -56,13 +77,40 @@ TerminalClient::TerminalClient(std::shared_ptr<Connection> connection,
     , _port(port)
     , _host(host)
     , _shell_cmd(shell_cmd)
-    , _pending_msg_counter(0) {
+    , _pending_msg_counter(0)
+    , _connected(false)
+    , _spill_size(DEFAULT_SPILL_SIZE)
+    , _link_compression_level(DEFAULT_COMPRESSION_LEVEL)
+    , _backoff(RECONNECT_MIN_DELAY, RECONNECT_MAX_DELAY)
+    , _connect_pending(false)
+    , _idle_timeout(DEFAULT_IDLE_TIMEOUT) {
+  char* spill_size = std::getenv(TERMINAL_SPILL_SIZE_ENV.c_str());
+  if(spill_size) {
+    _spill_size = (size_t)std::strtoul(spill_size, nullptr, 10);
+  }
+  char* compression_level = std::getenv(TERMINAL_COMPRESSION_LEVEL_ENV.c_str());
+  if(compression_level) {
+    _link_compression_level = std::min(std::max(std::atoi(compression_level), 0), Z_BEST_COMPRESSION);
+  }
+  char* idle_timeout = std::getenv(TERMINAL_IDLE_TIMEOUT_ENV.c_str());
+  if(idle_timeout) {
+    _idle_timeout = std::chrono::minutes(std::strtoul(idle_timeout, nullptr, 10));
+  }
   _thread = std::make_shared<ThreadLoop>();
   _thread->Init();
 }
 
 void TerminalClient::Init() {
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+  _command_runner = std::make_shared<CommandRunner>(shared_from_this());
+  // started before the first terminal is requested so the shell pool can warm up
+  _term_handler = std::make_shared<TerminalHandler>(shared_this, shared_this, _thread, _task_timer, _shell_cmd);
+  _thread->Post(std::bind(&TerminalHandler::Init, _term_handler));
   ConnectionChecker::MointorUrl(_host, _port, shared_from_this());
+  if(_idle_timeout.count()) {
+    _task_timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(IDLE_CHECK_INTERVAL),
+                          std::bind(&TerminalClient::HibernateIdleTerminals, shared_this));
+  }
 }
 
 std::shared_ptr<FileTransferHandler> TerminalClient::GetSptr() {
@@ -70,11 +118,39 @@ std::shared_ptr<FileTransferHandler> TerminalClient::GetSptr() {
 }
 
 void TerminalClient::SendPingToClient(std::shared_ptr<Client> client) {
+  {
+    std::lock_guard<std::mutex> lock(_rtt_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if(now - _last_receive_time < PING_IDLE_INTERVAL) {
+      return;
+    }
+    _ping_time = now;
+  }
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::PING);
   client->Send(msg);
 }
 
 void TerminalClient::CreateClient(std::shared_ptr<MonitorTask> task, const std::string& url, int port) {
+  std::chrono::milliseconds delay;
+  {
+    std::lock_guard<std::mutex> lock(_connect_mutex);
+    if(_connect_pending) {
+      return;
+    }
+    _connect_pending = true;
+    delay = _backoff.NextDelay();
+  }
+  DLOG(info, "TerminalClient : connecting in {} ms", delay.count());
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+  _task_timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(delay),
+                        std::bind(&TerminalClient::Connect, shared_this, task, url, port));
+}
+
+void TerminalClient::Connect(std::shared_ptr<MonitorTask> task, const std::string& url, int port) {
+  {
+    std::lock_guard<std::mutex> lock(_connect_mutex);
+    _connect_pending = false;
+  }
   _connection->CreateClient(port, url, task);
 }
 
@@ -89,37 +165,100 @@ void TerminalClient::OnClientRead(std::shared_ptr<Client> client, std::shared_pt
   auto msg_content = simple_msg->GetContent();
   auto msg_data = msg_content->GetMemCache();
 
+  {
+    std::lock_guard<std::mutex> lock(_rtt_mutex);
+    _last_receive_time = std::chrono::steady_clock::now();
+  }
+
   if(!msg_content->IsCompleted()) {
     return;
   }
 
   switch(MessageType::TypeFromInt(msg_header->_type)) {
     case MessageType::PING:
+      {
+        // the server only monitors hosts it admitted
+        std::lock_guard<std::mutex> lock(_connect_mutex);
+        _backoff.Reset();
+      }
       HandlePingMessage(client);
       break;
     case MessageType::PONG:
+      {
+        std::chrono::steady_clock::time_point ping_time;
+        {
+          std::lock_guard<std::mutex> lock(_rtt_mutex);
+          ping_time = _ping_time;
+          _ping_time = {};
+        }
+        HandleRttSample(ping_time);
+      }
       break;
     case MessageType::ON_TERMINAL_READ_ACK:
       {
-        _pending_msg_counter--;
-        ResolvePendingMsgUpdated();
+        // cumulative, an empty ack stands for a single read
+        uint32_t count = 1;
+        msg_data->CopyTo(&count, 0, 4);
+        HandleReadAck(count);
       }
       break;
+    case MessageType::LINK_COMPRESSION:
+      HandleLinkCompression();
+      break;
     case MessageType::CREATE_TERMINAL:
       HandleCreateTerminal(msg_data);
       break;
     case MessageType::RESIZE_TERMINAL:
-      HandleResizeTerminal(msg_data);
+      {
+        uint32_t count = 0;
+        if(msg_data->CopyTo(&count, 8, 4)) {
+          HandleReadAck(count);
+        }
+        HandleResizeTerminal(msg_data);
+      }
       break;
     case MessageType::DELETE_TERMINAL :
       HandleDeleteTerminal(msg_data);
       break;
     case MessageType::ON_TERMINAL_WRITE:
-      HandleTerminalWrite(msg_data);
+      HandleTerminalWrite(msg_data, 4);
+      break;
+    case MessageType::ON_TERMINAL_WRITE_ACKED:
+      {
+        uint32_t count = 0;
+        if(msg_data->CopyTo(&count, 4, 4)) {
+          HandleReadAck(count);
+        }
+        HandleTerminalWrite(msg_data, 8);
+      }
+      break;
+    case MessageType::TERMINAL_GROUP:
+      HandleTerminalGroup(msg_data);
+      break;
+    case MessageType::ON_TERMINAL_GROUP_WRITE:
+      HandleTerminalGroupWrite(msg_data);
+      break;
+    case MessageType::TERMINAL_RESYNC:
+      HandleTerminalResync(msg_data);
       break;
     case MessageType::FILE_TRANSFER_REQ:
       HandleFileRequest(msg_data);
       break;
+    case MessageType::FILE_LIST_REQ:
+      HandleFileListRequest(msg_data);
+      break;
+    case MessageType::DIST_JOB:
+      HandleDistributionJob(msg_data);
+      break;
+    case MessageType::DIST_RELEASE:
+      HandleDistributionRelease(msg_data);
+      break;
+    case MessageType::EXEC_REQ:
+      HandleExecRequest(msg_data);
+      break;
+    case MessageType::EXEC_CANCEL:
+      HandleExecCancel(msg_data);
+      break;
     default:
       break;
   }
@@ -135,14 +274,26 @@ bool TerminalClient::OnClientConnecting(std::shared_ptr<Client> client, NetError
 }
 
 void TerminalClient::OnClientConnected(std::shared_ptr<Client> client) {
-  _client = client;
+  {
+    std::lock_guard<std::mutex> lock(_connect_mutex);
+    _client = client;
+  }
   SendClientInfoMsg();
+  SendLinkCompressionReq();
+  SendTerminalResume();
+  InitConnectionPool(_connection, _host, _port);
 }
 
 void TerminalClient::OnClientClosed(std::shared_ptr<Client> client) {
   HandleDisconnected();
 }
 
+std::shared_ptr<Client> TerminalClient::GetServerClient() {
+  // for senders outside the network thread, _client is replaced on reconnect
+  std::lock_guard<std::mutex> lock(_connect_mutex);
+  return _client;
+}
+
 void TerminalClient::SendClientInfoMsg() {
   char* user_name = std::getenv("USER");
   char* client_name = std::getenv(TERMINAL_CLIENT_NAME_ENV.c_str());
@@ -158,7 +309,55 @@ void TerminalClient::SendClientInfoMsg() {
 
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::CLIENT_INFO,
                                              std::make_shared<DataResource>(msg_data));
-  _client->Send(msg);
+  GetServerClient()->Send(msg);
+}
+
+void TerminalClient::SendLinkCompressionReq() {
+  if(!_link_compression_level) {
+    return;
+  }
+  // output stays uncompressed until the server answers, older servers never do
+  auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::LINK_COMPRESSION);
+  GetServerClient()->Send(msg);
+}
+
+void TerminalClient::HandleLinkCompression() {
+  auto compressor = std::make_shared<StreamCompressor>(StreamCompressor::Format::DEFLATE, _link_compression_level);
+  if(!compressor->Init()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_output_mutex);
+  _link_compressor = compressor;
+  DLOG(info, "TerminalClient : link compression enabled, level : {}", _link_compression_level);
+}
+
+void TerminalClient::SendTerminalResume() {
+  std::lock_guard<std::mutex> lock(_output_mutex);
+  _connected = true;
+  if(_terminal_outputs.empty()) {
+    return;
+  }
+
+  // shells that survived the outage, the server answers with TERMINAL_RESYNC for each one it takes back
+  // owner keys follow all the entries, servers without owner keys stop reading before them
+  uint32_t count = (uint32_t)_terminal_outputs.size();
+  auto data = std::make_shared<Data>(4 + count * (24 + MessageType::OWNER_KEY_SIZE));
+  data->Add(4, (unsigned char*)&count);
+  for(auto& output : _terminal_outputs) {
+    uint32_t terminal_id = output.first;
+    uint32_t server_instance = output.second._server_instance;
+    uint64_t start_offset = output.second._spill.GetStartOffset();
+    uint64_t end_offset = output.second._spill.GetEndOffset();
+    data->Add(4, (unsigned char*)&terminal_id);
+    data->Add(4, (unsigned char*)&server_instance);
+    data->Add(8, (unsigned char*)&start_offset);
+    data->Add(8, (unsigned char*)&end_offset);
+  }
+  for(auto& output : _terminal_outputs) {
+    data->Add(MessageType::OWNER_KEY_SIZE, (unsigned char*)output.second._owner_key.data());
+  }
+  DLOG(info, "TerminalClient : resuming {} terminals", count);
+  GetServerClient()->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::TERMINAL_RESUME, std::make_shared<DataResource>(data)));
 }
 
 void TerminalClient::HandlePingMessage(std::shared_ptr<Client> client) {
@@ -166,6 +365,46 @@ void TerminalClient::HandlePingMessage(std::shared_ptr<Client> client) {
   client->Send(msg);
 }
 
+void TerminalClient::HandleRttSample(std::chrono::steady_clock::time_point send_time) {
+  if(send_time == std::chrono::steady_clock::time_point()) {
+    return;
+  }
+  auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - send_time);
+  _scheduler->OnRttSample(0, rtt);
+}
+
+void TerminalClient::HandleReadAck(uint32_t count) {
+  std::chrono::steady_clock::time_point send_time;
+  {
+    // the newest acked read waited the least for the delayed ack, it gives the best rtt sample
+    std::lock_guard<std::mutex> lock(_rtt_mutex);
+    for(uint32_t i = 0; i < count && !_read_send_times.empty(); ++i) {
+      send_time = _read_send_times.front();
+      _read_send_times.pop_front();
+    }
+  }
+  HandleRttSample(send_time);
+  {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    for(uint32_t i = 0; i < count && !_read_acks.empty(); ++i) {
+      uint32_t terminal_id = _read_acks.front().first;
+      uint64_t end_offset = _read_acks.front().second;
+      _read_acks.pop_front();
+      // offsets only grow, acking the last read of a run covers the ones before it
+      bool run_continues = i + 1 < count && !_read_acks.empty() && _read_acks.front().first == terminal_id;
+      if(run_continues) {
+        continue;
+      }
+      auto it = _terminal_outputs.find(terminal_id);
+      if(it != _terminal_outputs.end()) {
+        it->second._spill.Ack(end_offset);
+      }
+    }
+  }
+  _pending_msg_counter -= (int)count;
+  ResolvePendingMsgUpdated();
+}
+
 void TerminalClient::HandleCreateTerminal(std::shared_ptr<Data> msg_data) {
   auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
 
@@ -175,23 +414,36 @@ void TerminalClient::HandleCreateTerminal(std::shared_ptr<Data> msg_data) {
   }
 
   uint32_t terminal_id = 0;
+  uint32_t server_instance = 0;
   if(!msg_data->CopyTo(&terminal_id, 0, sizeof(uint32_t))) {
     DLOG(error, "TerminalClient::HandleCreateTerminal : Failed to parse terminal_id");
     return;
   }
+  msg_data->CopyTo(&server_instance, 4, 4);
+  std::string owner_key(MessageType::OWNER_KEY_SIZE, '\0');
+  msg_data->CopyTo(&owner_key[0], 8, MessageType::OWNER_KEY_SIZE);
 
   if(!_term_handler) {
-    _term_handler = std::make_shared<TerminalHandler>(shared_this, _thread, _shell_cmd);
+    _term_handler = std::make_shared<TerminalHandler>(shared_this, shared_this, _thread, _task_timer, _shell_cmd);
   }
 
+  {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    _terminal_outputs.erase(terminal_id);
+    _terminal_outputs.emplace(terminal_id, TerminalOutput(_spill_size, server_instance, owner_key));
+  }
   uint8_t result = (uint8_t)_term_handler->CreateTerminal(terminal_id);
+  if(!result) {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    _terminal_outputs.erase(terminal_id);
+  }
 
   auto data = std::make_shared<Data>(5);
   data->Add(4, (unsigned char*)&terminal_id);
   data->Add(1, (unsigned char*)&result);
   auto resource = std::make_shared<DataResource>(data);
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::ON_TERMINAL_CREATED, resource);
-  _client->Send(msg);
+  GetServerClient()->Send(msg);
 }
 
 void TerminalClient::HandleDeleteTerminal(std::shared_ptr<Data> msg_data) {
@@ -210,6 +462,8 @@ void TerminalClient::HandleDeleteTerminal(std::shared_ptr<Data> msg_data) {
   if(_term_handler) {
     _term_handler->DeleteTerminal(terminal_id);
   }
+  std::lock_guard<std::mutex> lock(_output_mutex);
+  _terminal_outputs.erase(terminal_id);
 }
 
 void TerminalClient::HandleResizeTerminal(std::shared_ptr<Data> msg_data) {
@@ -234,11 +488,11 @@ void TerminalClient::HandleResizeTerminal(std::shared_ptr<Data> msg_data) {
   }
 }
 
-void TerminalClient::HandleTerminalWrite(std::shared_ptr<Data> msg_data) {
+void TerminalClient::HandleTerminalWrite(std::shared_ptr<Data> msg_data, uint32_t key_offset) {
   auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
 
   if(_thread->OnDifferentThread()) {
-    _thread->Post(std::bind(&TerminalClient::HandleTerminalWrite, shared_this, msg_data));
+    _thread->Post(std::bind(&TerminalClient::HandleTerminalWrite, shared_this, msg_data, key_offset));
     return;
   }
 
@@ -249,36 +503,269 @@ void TerminalClient::HandleTerminalWrite(std::shared_ptr<Data> msg_data) {
     return;
   }
 
-  msg_data->AddOffset(4);
+  msg_data->AddOffset(key_offset);
+  MarkTerminalActive(terminal_id);
   if(_term_handler) {
     _term_handler->SendKeyEvent(terminal_id, msg_data->ToString());
   }
 }
 
+void TerminalClient::HandleTerminalGroup(std::shared_ptr<Data> msg_data) {
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalClient::HandleTerminalGroup, shared_this, msg_data));
+    return;
+  }
+
+  uint32_t group_id = 0;
+  uint16_t count = 0;
+  bool data_retrieved = true;
+  data_retrieved = data_retrieved && msg_data->CopyTo(&group_id, 0, 4);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&count, 4, 2);
+
+  std::vector<uint32_t> terminal_ids(count);
+  if(data_retrieved && count) {
+    data_retrieved = msg_data->CopyTo(terminal_ids.data(), 6, 4 * count);
+  }
+  if(!data_retrieved) {
+    DLOG(error, "TerminalClient::HandleTerminalGroup : data error");
+    return;
+  }
+
+  if(terminal_ids.empty()) {
+    _terminal_groups.erase(group_id);
+  } else {
+    _terminal_groups[group_id] = terminal_ids;
+  }
+}
+
+void TerminalClient::HandleTerminalGroupWrite(std::shared_ptr<Data> msg_data) {
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalClient::HandleTerminalGroupWrite, shared_this, msg_data));
+    return;
+  }
+
+  uint32_t group_id = 0;
+  if(!msg_data->CopyTo(&group_id, 0, 4)) {
+    DLOG(error, "TerminalClient::HandleTerminalGroupWrite : Failed to parse group_id");
+    return;
+  }
+
+  auto it = _terminal_groups.find(group_id);
+  if(it == _terminal_groups.end() || !_term_handler) {
+    return;
+  }
+  msg_data->AddOffset(4);
+  std::string key = msg_data->ToString();
+  for(uint32_t terminal_id : it->second) {
+    MarkTerminalActive(terminal_id);
+    _term_handler->SendKeyEvent(terminal_id, key);
+  }
+}
+
+void TerminalClient::HandleTerminalResync(std::shared_ptr<Data> msg_data) {
+  uint32_t terminal_id = 0;
+  uint64_t offset = 0;
+  if(!msg_data->CopyTo(&terminal_id, 0, 4) || !msg_data->CopyTo(&offset, 4, 8)) {
+    DLOG(error, "TerminalClient::HandleTerminalResync : data error");
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    auto it = _terminal_outputs.find(terminal_id);
+    if(it == _terminal_outputs.end()) {
+      DLOG(warn, "TerminalClient::HandleTerminalResync : unknown terminal : {}", terminal_id);
+      return;
+    }
+
+    TerminalSpill& spill = it->second._spill;
+    if(offset < spill.GetStartOffset()) {
+      DLOG(warn, "TerminalClient : terminal {} lost {} bytes of output while disconnected",
+           terminal_id,
+           spill.GetStartOffset() - offset);
+    }
+    spill.Ack(offset);
+
+    std::string chunk;
+    uint64_t read_offset = spill.GetStartOffset();
+    while(spill.Read(read_offset, RESYNC_CHUNK_SIZE, chunk)) {
+      read_offset += chunk.size();
+      SendTerminalOutput(terminal_id, (const unsigned char*)chunk.data(), chunk.size(), read_offset);
+    }
+    it->second._live = true;
+    if(it->second._ended) {
+      SendTerminalEnd(terminal_id);
+      _terminal_outputs.erase(it);
+    }
+  }
+  ResolvePendingMsgUpdated();
+}
+
 void TerminalClient::HandleDisconnected() {
   _pending_msg_counter.store(0);
-  DeleteTerminals();
+  ClearConnectionPool();
+  {
+    std::lock_guard<std::mutex> lock(_rtt_mutex);
+    _read_send_times.clear();
+    _last_receive_time = {};
+  }
+  {
+    std::lock_guard<std::mutex> lock(_distribution_mutex);
+    for(auto& distribution : _distributions) {
+      distribution.second->Release();
+    }
+    _distributions.clear();
+  }
+  _command_runner->CancelAll();
+  {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    _connected = false;
+    _read_acks.clear();
+    _link_compressor.reset();
+    for(auto& output : _terminal_outputs) {
+      output.second._live = false;
+    }
+  }
+  // shells keep running through the outage, their output waits in the spill buffers
+  ClearTerminalGroups();
+  EnableReadFromTerminals(true);
+}
+
+void TerminalClient::MarkTerminalActive(uint32_t terminal_id) {
+  std::lock_guard<std::mutex> lock(_output_mutex);
+  auto it = _terminal_outputs.find(terminal_id);
+  if(it != _terminal_outputs.end()) {
+    it->second._last_io = std::chrono::steady_clock::now();
+    it->second._hibernated = false;
+  }
+}
+
+void TerminalClient::HibernateIdleTerminals() {
+  std::vector<uint32_t> idle_terminals;
+  {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    auto now = std::chrono::steady_clock::now();
+    for(auto& output : _terminal_outputs) {
+      if(output.second._hibernated || now - output.second._last_io < _idle_timeout) {
+        continue;
+      }
+      // unacked output stays, only the spare capacity is returned
+      output.second._spill.Compact();
+      output.second._hibernated = true;
+      idle_terminals.push_back(output.first);
+    }
+  }
+
+  if(!idle_terminals.empty()) {
+    DLOG(info, "TerminalClient : hibernating {} idle terminals", idle_terminals.size());
+  }
+  for(uint32_t terminal_id : idle_terminals) {
+    _thread->Post(std::bind(&TerminalHandler::Hibernate, _term_handler, terminal_id));
+  }
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+  _task_timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(IDLE_CHECK_INTERVAL),
+                        std::bind(&TerminalClient::HibernateIdleTerminals, shared_this));
 }
 
 void TerminalClient::OnTerminalRead(std::shared_ptr<Terminal> terminal, std::shared_ptr<Data> output) {
   uint32_t terminal_id = terminal->GetId();
-  auto data = std::make_shared<Data>(4 + output->GetCurrentSize());
-  data->Add(4, (unsigned char*)&terminal_id);
-  data->Add(output->GetCurrentSize(), output->GetCurrentDataRaw());
+  {
+    std::lock_guard<std::mutex> lock(_output_mutex);
+    auto it = _terminal_outputs.find(terminal_id);
+    if(it == _terminal_outputs.end()) {
+      return;
+    }
+    it->second._last_io = std::chrono::steady_clock::now();
+    it->second._hibernated = false;
+    // kept until the server acks it, so it can be replayed after a reconnect
+    TerminalSpill& spill = it->second._spill;
+    spill.Append(output->GetCurrentDataRaw(), output->GetCurrentSize());
+    if(!_connected || !it->second._live) {
+      return;
+    }
+    SendTerminalOutput(terminal_id, output->GetCurrentDataRaw(), output->GetCurrentSize(), spill.GetEndOffset());
+  }
+  ResolvePendingMsgUpdated();
+}
+
+void TerminalClient::SendTerminalOutput(uint32_t terminal_id, const unsigned char* output, size_t size, uint64_t end_offset) {
+  std::shared_ptr<Data> compressed;
+  if(_link_compressor && size >= MIN_COMPRESSED_OUTPUT && size <= MessageType::MAX_INFLATED_READ_SIZE &&
+     !StreamCompressor::LooksIncompressible(output, (uint32_t)size)) {
+    compressed = _link_compressor->Compress(output, (uint32_t)size, false);
+    if(!compressed) {
+      // the stream can't be trusted anymore, the rest of this connection goes uncompressed
+      _link_compressor.reset();
+    }
+  }
+
+  std::shared_ptr<Data> data;
+  MessageType::Type type = MessageType::ON_TERMINAL_READ;
+  if(compressed) {
+    // every piece ends with the sync flush trailer, the server puts it back
+    uint32_t compressed_size = compressed->GetCurrentSize();
+    const unsigned char* compressed_raw = compressed->GetCurrentDataRaw();
+    if(compressed_size >= sizeof(SYNC_FLUSH_TAIL) &&
+       !std::memcmp(compressed_raw + compressed_size - sizeof(SYNC_FLUSH_TAIL), SYNC_FLUSH_TAIL, sizeof(SYNC_FLUSH_TAIL))) {
+      compressed_size -= sizeof(SYNC_FLUSH_TAIL);
+    }
+    data = std::make_shared<Data>(4 + compressed_size);
+    data->Add(4, (unsigned char*)&terminal_id);
+    data->Add(compressed_size, compressed_raw);
+    type = MessageType::ON_TERMINAL_READ_DEFLATED;
+  } else {
+    data = std::make_shared<Data>(4 + size);
+    data->Add(4, (unsigned char*)&terminal_id);
+    data->Add(size, output);
+  }
   auto resource = std::make_shared<DataResource>(data);
-  auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::ON_TERMINAL_READ, resource);
+  auto msg = std::make_shared<SimpleMessage>((uint8_t)type, resource);
 
+  _read_acks.push_back(std::make_pair(terminal_id, end_offset));
   _pending_msg_counter++;
-  _client->Send(msg);
-  ResolvePendingMsgUpdated();
+  {
+    std::lock_guard<std::mutex> lock(_rtt_mutex);
+    _read_send_times.push_back(std::chrono::steady_clock::now());
+  }
+  GetServerClient()->Send(msg);
 }
 
 void TerminalClient::OnTerminalEnd(std::shared_ptr<Terminal> terminal) {
   uint32_t terminal_id = terminal->GetId();
+  std::lock_guard<std::mutex> lock(_output_mutex);
+  auto it = _terminal_outputs.find(terminal_id);
+  if(it != _terminal_outputs.end()) {
+    if(!_connected || !it->second._live) {
+      // reported once the server takes the terminal back
+      it->second._ended = true;
+      return;
+    }
+    _terminal_outputs.erase(it);
+  }
+  if(_connected) {
+    SendTerminalEnd(terminal_id);
+  }
+}
+
+void TerminalClient::SendTerminalEnd(uint32_t terminal_id) {
   auto data = std::make_shared<Data>(4, (unsigned char*)&terminal_id);
   auto resource = std::make_shared<DataResource>(data);
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::ON_TERMINAL_END, resource);
-  _client->Send(msg);
+  GetServerClient()->Send(msg);
+}
+
+void TerminalClient::OnTerminalWriteState(uint32_t terminal_id, bool blocked, uint32_t dropped_bytes) {
+  auto data = std::make_shared<Data>(9);
+  data->Add(4, (unsigned char*)&terminal_id);
+  uint8_t blocked_val = (uint8_t)blocked;
+  data->Add(1, &blocked_val);
+  data->Add(4, (unsigned char*)&dropped_bytes);
+  auto resource = std::make_shared<DataResource>(data);
+  GetServerClient()->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::TERMINAL_WRITE_STATE, resource));
 }
 
 void TerminalClient::DeleteTerminals() {
@@ -287,9 +774,19 @@ void TerminalClient::DeleteTerminals() {
     _thread->Post(std::bind(&TerminalClient::DeleteTerminals, shared_this));
     return;
   }
+  _terminal_groups.clear();
   _term_handler->DeleteTerminals();
 }
 
+void TerminalClient::ClearTerminalGroups() {
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalClient::ClearTerminalGroups, shared_this));
+    return;
+  }
+  _terminal_groups.clear();
+}
+
 void TerminalClient::ResolvePendingMsgUpdated() {
   int counter = _pending_msg_counter.load();
   if(counter > READ_BLOCK_HIGH) {
@@ -313,14 +810,16 @@ void TerminalClient::EnableReadFromTerminals(bool enabled) {
 void TerminalClient::HandleFileRequest(std::shared_ptr<Data> msg_data) {
   uint32_t req_id = 0;
   uint8_t is_download_from_client = 0;
+  uint8_t flags = 0;
   std::string path;
   bool data_retrieved = true;
 
   data_retrieved = data_retrieved && msg_data->CopyTo(&req_id, 0, 4);
   data_retrieved = data_retrieved && msg_data->CopyTo(&is_download_from_client, 4, 1);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&flags, 5, 1);
 
   if(data_retrieved) {
-    msg_data->SetOffset(5);
+    msg_data->SetOffset(6);
     path = msg_data->ToString();
     data_retrieved = !path.empty();
   }
@@ -330,7 +829,31 @@ void TerminalClient::HandleFileRequest(std::shared_ptr<Data> msg_data) {
     return;
   }
 
-  MakeFileTransferRequest(req_id, is_download_from_client, path, _connection, _host, _port);
+  MakeFileTransferRequest(req_id, is_download_from_client, flags, path, _connection, _host, _port);
+}
+
+void TerminalClient::HandleFileListRequest(std::shared_ptr<Data> msg_data) {
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+
+  if(_file_thread->OnDifferentThread()) {
+    _file_thread->Post(std::bind(&TerminalClient::HandleFileListRequest, shared_this, msg_data));
+    return;
+  }
+
+  auto msg = MakeDirectoryListingResponse(msg_data);
+  auto client = GetServerClient();
+  if(msg && client) {
+    client->Send(msg);
+  }
+  _file_thread->Post(std::bind(&TerminalClient::PrefetchDirectories, shared_this));
+}
+
+void TerminalClient::PrefetchDirectories() {
+  // one directory per task, so listing requests queued meanwhile are not delayed
+  if(PrefetchNextDirectory()) {
+    auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+    _file_thread->Post(std::bind(&TerminalClient::PrefetchDirectories, shared_this));
+  }
 }
 
 void TerminalClient::OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<SimpleMessage> msg, bool success) {
@@ -339,4 +862,117 @@ void TerminalClient::OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_
 
 void TerminalClient::OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<Message> msg) {
   //TODO
-}
\ No newline at end of file
+}
+
+void TerminalClient::HandleDistributionJob(std::shared_ptr<Data> msg_data) {
+  auto shared_this = std::static_pointer_cast<TerminalClient>(shared_from_this());
+
+  if(_file_thread->OnDifferentThread()) {
+    _file_thread->Post(std::bind(&TerminalClient::HandleDistributionJob, shared_this, msg_data));
+    return;
+  }
+
+  auto node = DistributionNode::Create(shared_this, _connection, _host, _port, msg_data);
+  if(!node) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_distribution_mutex);
+    _distributions[node->GetJobId()] = node;
+  }
+  node->Start();
+}
+
+void TerminalClient::HandleDistributionRelease(std::shared_ptr<Data> msg_data) {
+  uint32_t job_id = 0;
+  if(!msg_data->CopyTo(&job_id, 0, 4)) {
+    DLOG(error, "HandleDistributionRelease : data error");
+    return;
+  }
+
+  std::shared_ptr<DistributionNode> node;
+  {
+    std::lock_guard<std::mutex> lock(_distribution_mutex);
+    auto it = _distributions.find(job_id);
+    if(it == _distributions.end()) {
+      return;
+    }
+    node = it->second;
+    _distributions.erase(it);
+  }
+  node->Release();
+}
+
+void TerminalClient::OnDistributionRelayReady(std::shared_ptr<DistributionNode> node, uint16_t port) {
+  uint32_t job_id = node->GetJobId();
+  auto data = std::make_shared<Data>(6);
+  data->Add(4, (unsigned char*)&job_id);
+  data->Add(2, (unsigned char*)&port);
+  GetServerClient()->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_READY, std::make_shared<DataResource>(data)));
+}
+
+void TerminalClient::OnDistributionProgress(std::shared_ptr<DistributionNode> node, uint32_t chunks_done) {
+  uint32_t job_id = node->GetJobId();
+  auto data = std::make_shared<Data>(8);
+  data->Add(4, (unsigned char*)&job_id);
+  data->Add(4, (unsigned char*)&chunks_done);
+  GetServerClient()->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_PROGRESS, std::make_shared<DataResource>(data)));
+}
+
+void TerminalClient::OnDistributionDone(std::shared_ptr<DistributionNode> node, bool success) {
+  uint32_t job_id = node->GetJobId();
+  uint8_t success_ui8 = success ? 1 : 0;
+  auto data = std::make_shared<Data>(5);
+  data->Add(4, (unsigned char*)&job_id);
+  data->Add(1, &success_ui8);
+  GetServerClient()->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::DIST_DONE, std::make_shared<DataResource>(data)));
+}
+
+void TerminalClient::HandleExecRequest(std::shared_ptr<Data> msg_data) {
+  uint32_t exec_id = 0;
+  uint32_t timeout_ms = 0;
+  std::string command;
+  bool data_retrieved = true;
+
+  data_retrieved = data_retrieved && msg_data->CopyTo(&exec_id, 0, 4);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&timeout_ms, 4, 4);
+  if(data_retrieved) {
+    msg_data->SetOffset(8);
+    command = msg_data->ToString();
+    data_retrieved = !command.empty();
+  }
+
+  if(!data_retrieved) {
+    DLOG(error, "HandleExecRequest : data error");
+    return;
+  }
+
+  if(!_command_runner->Run(exec_id, command, timeout_ms)) {
+    OnCommandEnd(exec_id, -1, CommandRunner::EndFlags::NONE);
+  }
+}
+
+void TerminalClient::HandleExecCancel(std::shared_ptr<Data> msg_data) {
+  uint32_t exec_id = 0;
+  if(!msg_data->CopyTo(&exec_id, 0, 4)) {
+    DLOG(error, "HandleExecCancel : data error");
+    return;
+  }
+  _command_runner->Cancel(exec_id);
+}
+
+void TerminalClient::OnCommandOutput(uint32_t exec_id, uint8_t stream, std::shared_ptr<Data> output) {
+  auto data = std::make_shared<Data>(5 + output->GetCurrentSize());
+  data->Add(4, (unsigned char*)&exec_id);
+  data->Add(1, &stream);
+  data->Add(output->GetCurrentSize(), output->GetCurrentDataRaw());
+  GetServerClient()->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::EXEC_OUTPUT, std::make_shared<DataResource>(data)));
+}
+
+void TerminalClient::OnCommandEnd(uint32_t exec_id, int32_t exit_code, uint8_t flags) {
+  auto data = std::make_shared<Data>(9);
+  data->Add(4, (unsigned char*)&exec_id);
+  data->Add(4, (unsigned char*)&exit_code);
+  data->Add(1, &flags);
+  GetServerClient()->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::EXEC_END, std::make_shared<DataResource>(data)));
+}
@@ -27,8 +27,19 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Terminal.h"
 #include "NetUtils.h"
 #include "FileTransferHandlerClient.h"
+#include "DistributionNode.h"
+#include "CommandRunner.h"
+#include "PtyTerminal.h"
+#include "TerminalSpill.h"
+#include "ReconnectBackoff.h"
+#include "StreamCompressor.h"
 
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
 
 
 class Connection;
@@ -37,11 +48,28 @@ class Message;
 class Data;
 class ThreadLoop;
 class TerminalHandler;
+class TaskTimer;
+
+struct TerminalOutput {
+  TerminalOutput(size_t spill_size, uint32_t server_instance, const std::string& owner_key)
+    : _spill(spill_size), _server_instance(server_instance), _owner_key(owner_key), _live(true), _ended(false)
+    , _last_io(std::chrono::steady_clock::now()), _hibernated(false) {}
+  TerminalSpill _spill;
+  uint32_t _server_instance; // server run that created the terminal
+  std::string _owner_key; // opaque to the client, lets a restarted server offer the shell to its owner only
+  bool _live; // false from a disconnect until the server asks to resync
+  bool _ended;
+  std::chrono::steady_clock::time_point _last_io;
+  bool _hibernated; // buffers released, any input or output wakes it
+};
 
 class TerminalClient
   : public MonitoringManager
   , public TerminalListener
   , public FileTransferHandlerClient
+  , public DistributionNodeListener
+  , public CommandRunnerListener
+  , public TerminalWriteListener
   , public std::enable_shared_from_this<TerminalClient>  {
 public:
   static std::shared_ptr<TerminalClient> Create(std::shared_ptr<Connection> connection,
@@ -65,15 +93,39 @@ public:
   void OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<SimpleMessage> msg, bool success) override;
   void OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<Message> msg) override;
 
+  void OnDistributionRelayReady(std::shared_ptr<DistributionNode> node, uint16_t port) override;
+  void OnDistributionProgress(std::shared_ptr<DistributionNode> node, uint32_t chunks_done) override;
+  void OnDistributionDone(std::shared_ptr<DistributionNode> node, bool success) override;
+
+  void OnCommandOutput(uint32_t exec_id, uint8_t stream, std::shared_ptr<Data> output) override;
+  void OnCommandEnd(uint32_t exec_id, int32_t exit_code, uint8_t flags) override;
+
+  //TerminalWriteListener
+  void OnTerminalWriteState(uint32_t terminal_id, bool blocked, uint32_t dropped_bytes) override;
+
   void DeleteTerminals();
+  void ClearTerminalGroups();
 
   void HandlePingMessage(std::shared_ptr<Client> client);
+  void HandleRttSample(std::chrono::steady_clock::time_point send_time);
+  void HandleReadAck(uint32_t count);
   void HandleCreateTerminal(std::shared_ptr<Data> msg_data);
   void HandleDeleteTerminal(std::shared_ptr<Data> msg_data);
   void HandleResizeTerminal(std::shared_ptr<Data> msg_data);
-  void HandleTerminalWrite(std::shared_ptr<Data> msg_data);
+  void HandleTerminalWrite(std::shared_ptr<Data> msg_data, uint32_t key_offset);
+  void HandleTerminalGroup(std::shared_ptr<Data> msg_data);
+  void HandleTerminalGroupWrite(std::shared_ptr<Data> msg_data);
+  void HandleTerminalResync(std::shared_ptr<Data> msg_data);
   void HandleFileRequest(std::shared_ptr<Data> msg_data);
+  void HandleFileListRequest(std::shared_ptr<Data> msg_data);
+  void PrefetchDirectories();
+  void HandleDistributionJob(std::shared_ptr<Data> msg_data);
+  void HandleDistributionRelease(std::shared_ptr<Data> msg_data);
+  void HandleExecRequest(std::shared_ptr<Data> msg_data);
+  void HandleExecCancel(std::shared_ptr<Data> msg_data);
   void HandleDisconnected();
+  std::shared_ptr<Client> GetServerClient();
+  void HibernateIdleTerminals();
 
   void EnableReadFromTerminals(bool enabled);
 
@@ -85,6 +137,13 @@ protected:
   void Init();
   void ResolvePendingMsgUpdated();
   void SendClientInfoMsg();
+  void SendLinkCompressionReq();
+  void HandleLinkCompression();
+  void Connect(std::shared_ptr<MonitorTask> task, const std::string& url, int port);
+  void SendTerminalResume();
+  void SendTerminalOutput(uint32_t terminal_id, const unsigned char* data, size_t size, uint64_t end_offset);
+  void SendTerminalEnd(uint32_t terminal_id);
+  void MarkTerminalActive(uint32_t terminal_id);
 
 private :
   std::shared_ptr<Connection> _connection;
@@ -93,6 +152,25 @@ private :
   std::string _shell_cmd;
   std::atomic_int _pending_msg_counter;
   std::shared_ptr<TerminalHandler> _term_handler;
+  std::map<uint32_t, std::vector<uint32_t>> _terminal_groups;
   std::shared_ptr<ThreadLoop> _thread;
   std::shared_ptr<Client> _client;
+  std::mutex _rtt_mutex;
+  std::chrono::steady_clock::time_point _ping_time;
+  std::chrono::steady_clock::time_point _last_receive_time; // any frame from the server
+  std::deque<std::chrono::steady_clock::time_point> _read_send_times;
+  std::mutex _output_mutex;
+  bool _connected;
+  size_t _spill_size;
+  std::map<uint32_t, TerminalOutput> _terminal_outputs;
+  std::deque<std::pair<uint32_t, uint64_t>> _read_acks; // terminal_id, end offset of each unacked read
+  int _link_compression_level;
+  std::shared_ptr<StreamCompressor> _link_compressor; // set once the server accepts compression
+  std::mutex _connect_mutex;
+  ReconnectBackoff _backoff;
+  bool _connect_pending;
+  std::chrono::minutes _idle_timeout;
+  std::mutex _distribution_mutex;
+  std::map<uint32_t, std::shared_ptr<DistributionNode>> _distributions;
+  std::shared_ptr<CommandRunner> _command_runner;
 };
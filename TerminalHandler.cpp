@@ -24,15 +24,81 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "TerminalHandler.h"
 #include "Logger.h"
+#include "PtyReactor.h"
+#include "PtyTerminal.h"
+#include "ShellPool.h"
+
+#include <chrono>
+#include <cstdlib>
+
+const std::string TERMINAL_REACTOR_ENV = "TERMINAL_REACTOR";
+const std::string TERMINAL_POOL_SIZE_ENV = "TERMINAL_POOL_SIZE";
 
 
 TerminalHandler::TerminalHandler(std::shared_ptr<TerminalListener> parent_listener,
+                              std::weak_ptr<TerminalWriteListener> write_listener,
                               std::shared_ptr<ThreadLoop> thread,
+                              std::shared_ptr<TaskTimer> task_timer,
                               const std::string& shell_cmd)
     : _parent_listener(parent_listener)
+    , _write_listener(write_listener)
     , _thread(thread)
+    , _task_timer(task_timer)
     , _read_enabled(true)
-    , _shell_cmd(shell_cmd) {
+    , _shell_cmd(shell_cmd)
+    , _use_reactor(IsReactorEnabled()) {
+}
+
+bool TerminalHandler::IsReactorEnabled() {
+  // on by default, TERMINAL_REACTOR=0 keeps a read task per terminal
+  char* use_reactor = std::getenv(TERMINAL_REACTOR_ENV.c_str());
+  return !use_reactor || std::strtoul(use_reactor, nullptr, 10) != 0;
+}
+
+TerminalHandler::~TerminalHandler() {
+  if(_reactor) {
+    _reactor->Stop();
+  }
+}
+
+void TerminalHandler::Init() {
+  if(_thread->OnDifferentThread()) {
+    DLOG(error, "Init : Called on wrong thread");
+    return;
+  }
+  if(_use_reactor) {
+    InitReactor();
+  }
+}
+
+bool TerminalHandler::InitReactor() {
+  if(_reactor) {
+    return true;
+  }
+
+  auto reactor = std::make_shared<PtyReactor>(shared_from_this());
+  if(!reactor->Init()) {
+    return false;
+  }
+  reactor->EnableRead(_read_enabled);
+  _reactor = reactor;
+
+  size_t pool_size = 0;
+  char* pool_size_env = std::getenv(TERMINAL_POOL_SIZE_ENV.c_str());
+  if(pool_size_env) {
+    pool_size = (size_t)std::strtoul(pool_size_env, nullptr, 10);
+  }
+  if(pool_size) {
+    _shell_pool.reset(new ShellPool(_shell_cmd, pool_size, _task_timer));
+    _shell_pool->Refill();
+  }
+  return true;
+}
+
+void TerminalHandler::RefillShellPool() {
+  if(_shell_pool) {
+    _shell_pool->Refill();
+  }
 }
 
 bool TerminalHandler::CreateTerminal(uint32_t terminal_id) {
@@ -42,22 +108,70 @@ bool TerminalHandler::CreateTerminal(uint32_t terminal_id) {
   }
 
   auto it = _terminals.find(terminal_id);
-  if(it != _terminals.end()) {
+  if(it != _terminals.end() || _pty_terminals.count(terminal_id)) {
     DLOG(error, "CreateTerminal : Terminal with id : {} already exists", terminal_id);
     return false;
   }
 
+  if(_use_reactor && InitReactor()) {
+    return CreatePtyTerminal(terminal_id);
+  }
+
   auto term = std::make_shared<Terminal>(terminal_id, shared_from_this());
   _terminals[terminal_id] = term;
   return term->Init(_shell_cmd);
 }
 
+bool TerminalHandler::CreatePtyTerminal(uint32_t terminal_id) {
+  if(!InitReactor()) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto term = std::make_shared<PtyTerminal>(terminal_id, shared_from_this(), _write_listener, _task_timer);
+  int fd = -1;
+  pid_t pid = -1;
+  int pidfd = -1;
+  bool from_pool = _shell_pool && _shell_pool->Take(fd, pid, pidfd);
+  if(from_pool) {
+    term->Attach(fd, pid, pidfd);
+  } else if(!term->Start(_shell_cmd)) {
+    return false;
+  }
+
+  if(!_reactor->Add(term)) {
+    return false;
+  }
+  _pty_terminals[terminal_id] = term;
+
+  if(_shell_pool) {
+    // refill after the reply to CREATE_TERMINAL is out
+    _thread->Post(std::bind(&TerminalHandler::RefillShellPool, shared_from_this()));
+    size_t hits = _shell_pool->GetHits();
+    size_t total = hits + _shell_pool->GetMisses();
+    DLOG(info, "CreateTerminal : {} {} in {} us, pool hit rate {}/{}",
+         terminal_id,
+         from_pool ? "taken from pool" : "spawned",
+         std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(),
+         hits,
+         total);
+  }
+  return true;
+}
+
 void TerminalHandler::DeleteTerminal(uint32_t terminal_id) {
   if(_thread->OnDifferentThread()) {
     DLOG(error, "DeleteTerminal : Called on wrong thread");
     return;
   }
 
+  auto pty_it = _pty_terminals.find(terminal_id);
+  if(pty_it != _pty_terminals.end()) {
+    _reactor->Remove(pty_it->second);
+    _pty_terminals.erase(pty_it);
+    return;
+  }
+
   auto it = _terminals.find(terminal_id);
   if(it == _terminals.end()) {
     DLOG(error, "DeleteTerminal : Can't find terminal id : {}", terminal_id);
@@ -73,6 +187,10 @@ void TerminalHandler::DeleteTerminals() {
     return;
   }
   _terminals.clear();
+  for(auto& terminal : _pty_terminals) {
+    _reactor->Remove(terminal.second);
+  }
+  _pty_terminals.clear();
 }
 
 void TerminalHandler::Resize(uint32_t terminal_id, int width, int height) {
@@ -81,6 +199,15 @@ void TerminalHandler::Resize(uint32_t terminal_id, int width, int height) {
     return;
   }
 
+  auto pty_it = _pty_terminals.find(terminal_id);
+  if(pty_it != _pty_terminals.end()) {
+    pty_it->second->Resize(width, height);
+    if(_shell_pool) {
+      _shell_pool->SetWindowSize(width, height);
+    }
+    return;
+  }
+
   auto it = _terminals.find(terminal_id);
   if(it == _terminals.end()) {
     DLOG(error, "Resize : Terminal with id : {} don't exists", terminal_id);
@@ -96,6 +223,12 @@ void TerminalHandler::SendKeyEvent(uint32_t terminal_id, const std::string& key)
     return;
   }
 
+  auto pty_it = _pty_terminals.find(terminal_id);
+  if(pty_it != _pty_terminals.end()) {
+    pty_it->second->Write(key);
+    return;
+  }
+
   auto it = _terminals.find(terminal_id);
   if(it == _terminals.end()) {
     DLOG(error, "SendKeyEvent : Cant find Terminal with id : {}", terminal_id);
@@ -105,6 +238,19 @@ void TerminalHandler::SendKeyEvent(uint32_t terminal_id, const std::string& key)
   it->second->Write(key);
 }
 
+void TerminalHandler::Hibernate(uint32_t terminal_id) {
+  if(_thread->OnDifferentThread()) {
+    DLOG(error, "Hibernate : Called on wrong thread");
+    return;
+  }
+
+  // with TERMINAL_REACTOR=0 the read buffer lives in Terminal and stays, the client still compacts the spill
+  auto pty_it = _pty_terminals.find(terminal_id);
+  if(pty_it != _pty_terminals.end()) {
+    pty_it->second->ReleaseBuffers();
+  }
+}
+
 void TerminalHandler::EnableReadFromTerminals(bool enabled) {
   if(_thread->OnDifferentThread()) {
     DLOG(error, "EnableReadFromTerminals : Called on wrong thread");
@@ -120,6 +266,9 @@ void TerminalHandler::EnableReadFromTerminals(bool enabled) {
   for (auto& terminal : _terminals) {
     terminal.second->EnableRead(enabled);
   }
+  if(_reactor) {
+    _reactor->EnableRead(enabled);
+  }
 }
 
 void TerminalHandler::OnTerminalRead(std::shared_ptr<Terminal> terminal, std::shared_ptr<Data> output) {
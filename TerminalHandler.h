@@ -33,18 +33,30 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Terminal.h"
 #include "Data.h"
 
+class PtyReactor;
+class PtyTerminal;
+class ShellPool;
+class TaskTimer;
+class TerminalWriteListener;
+
 class TerminalHandler
     : public std::enable_shared_from_this<TerminalHandler>
     , public TerminalListener {
 public:
   TerminalHandler(std::shared_ptr<TerminalListener> parent_listener,
+                  std::weak_ptr<TerminalWriteListener> write_listener,
                   std::shared_ptr<ThreadLoop> thread,
+                  std::shared_ptr<TaskTimer> task_timer,
                   const std::string& shell_cmd);
+  ~TerminalHandler();
+  static bool IsReactorEnabled();
+  void Init();
   bool CreateTerminal(uint32_t terminal_id);
   void DeleteTerminal(uint32_t terminal_id);
   void DeleteTerminals();
   void Resize(uint32_t terminal_id, int width, int height);
   void SendKeyEvent(uint32_t terminal_id, const std::string& key);
+  void Hibernate(uint32_t terminal_id);
 
   void EnableReadFromTerminals(bool enabled);
 
@@ -52,9 +64,19 @@ public:
   void OnTerminalRead(std::shared_ptr<Terminal> terminal, std::shared_ptr<Data> output) override;
   void OnTerminalEnd(std::shared_ptr<Terminal> terminal) override;
 protected:
+  bool InitReactor();
+  bool CreatePtyTerminal(uint32_t terminal_id);
+  void RefillShellPool();
+
   std::shared_ptr<TerminalListener> _parent_listener;
+  std::weak_ptr<TerminalWriteListener> _write_listener;
   std::shared_ptr<ThreadLoop> _thread;
+  std::shared_ptr<TaskTimer> _task_timer; // waits for closed shells to exit
   std::map<uint32_t, std::shared_ptr<Terminal>> _terminals;
   bool _read_enabled;
   std::string _shell_cmd;
+  bool _use_reactor;
+  std::shared_ptr<PtyReactor> _reactor;
+  std::unique_ptr<ShellPool> _shell_pool;
+  std::map<uint32_t, std::shared_ptr<PtyTerminal>> _pty_terminals;
 };
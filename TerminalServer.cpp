@@ -29,13 +29,40 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "TerminalHandler.h"
 #include "SimpleMessage.h"
 #include "MessageType.h"
+#include "TransferScheduler.h"
 #include "Data.h"
 #include "DataResource.h"
 #include "Connection.h"
 #include "Server.h"
+#include "TaskTimer.h"
+#include "CommandRunner.h"
+#include "RateLimiter.h"
+#include "StreamDecompressor.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
 
 
 std::atomic<uint32_t> TerminalServer::_id_counter(0);
+const size_t MAX_FINISHED_DISTRIBUTIONS = 16;
+const size_t DEFAULT_EXEC_MAX_ACTIVE = 64;
+const std::string EXEC_MAX_ACTIVE_ENV = "EXEC_MAX_ACTIVE";
+// the client kills the command on its own timeout, this covers clients that stopped answering
+const std::chrono::milliseconds EXEC_TIMEOUT_GRACE(2000);
+// a host resuming later still keeps its shells, so does a browser reattaching shells resumed after a restart
+const std::chrono::hours DETACHED_TERMINAL_TIMEOUT(1);
+const std::string SERVER_ACCEPT_RATE_ENV = "SERVER_ACCEPT_RATE";
+const double DEFAULT_ACCEPT_RATE = 1000;
+// hosts announced to the browsers and monitored per batch
+const size_t REGISTRATION_BATCH_SIZE = 256;
+const std::chrono::milliseconds REGISTRATION_BATCH_INTERVAL(20);
+// hosts are pinged only after this long without any frame from them
+const std::chrono::milliseconds LIVENESS_IDLE_INTERVAL(5000);
+const std::chrono::milliseconds LIVENESS_PONG_TIMEOUT(5000);
+// reads are acked cumulatively, at the latest after the delay or once the batch is full
+const std::chrono::milliseconds READ_ACK_DELAY(5);
+const uint32_t READ_ACK_BATCH = 16;
 
 
 void RemoteHost::AddTerminal(uint32_t terminal_id, TerminalInfo info) {
@@ -51,11 +78,58 @@ bool RemoteHost::GetTerminalInfo(uint32_t terminal_id, TerminalInfo& out_result)
   return true;
 }
 
+bool RemoteHost::RemoveTerminal(uint32_t terminal_id, TerminalInfo& out_info) {
+  auto it = _terminals.find(terminal_id);
+  if(it == _terminals.end()) {
+    return false;
+  }
+  out_info = it->second;
+  _terminals.erase(it);
+  return true;
+}
+
+void RemoteHost::AddTerminalOutput(uint32_t terminal_id, size_t size) {
+  auto it = _terminals.find(terminal_id);
+  if(it != _terminals.end()) {
+    it->second._output_offset += size;
+  }
+}
+
+bool RemoteHost::ClaimTerminal(uint32_t terminal_id, uint32_t app_client_id, const std::string& owner_key, TerminalInfo& out_info) {
+  auto it = _terminals.find(terminal_id);
+  if(it == _terminals.end() || it->second._app_client_id || owner_key.empty() || it->second._owner_key != owner_key) {
+    return false;
+  }
+  it->second._app_client_id = app_client_id;
+  out_info = it->second;
+  return true;
+}
+
 void TerminalServer::Init(std::shared_ptr<WebAppServer> server_impl, std::shared_ptr<Server> proxy_server) {
   _webapp_server = server_impl;
   _proxy_server = proxy_server;
   _thread = std::make_shared<ThreadLoop>();
   _thread->Init();
+  double accept_rate = DEFAULT_ACCEPT_RATE;
+  char* accept_rate_env = std::getenv(SERVER_ACCEPT_RATE_ENV.c_str());
+  if(accept_rate_env) {
+    accept_rate = std::strtod(accept_rate_env, nullptr);
+  }
+  _accept_limiter = std::make_shared<RateLimiter>(accept_rate, accept_rate);
+  _rejected_connections = 0;
+  _liveness = std::make_shared<LivenessMonitor>(shared_from_this(), _task_timer, LIVENESS_IDLE_INTERVAL, LIVENESS_PONG_TIMEOUT);
+  _liveness->Init();
+  _registration_scheduled = false;
+  _read_ack_scheduled = false;
+  std::random_device random;
+  do {
+    _instance_id = random();
+  } while(!_instance_id);
+  _exec_max_active = DEFAULT_EXEC_MAX_ACTIVE;
+  char* exec_max_active = std::getenv(EXEC_MAX_ACTIVE_ENV.c_str());
+  if(exec_max_active) {
+    _exec_max_active = (size_t)std::strtoul(exec_max_active, nullptr, 10);
+  }
 }
 
 uint32_t TerminalServer::NextId() {
@@ -65,13 +139,14 @@ uint32_t TerminalServer::NextId() {
   return ++_id_counter;
 }
 
-void TerminalServer::CreateNewTerminal(uint32_t app_client_id, uint32_t remote_host_id) {
+void TerminalServer::CreateNewTerminal(uint32_t app_client_id, uint32_t remote_host_id, const std::string& owner_key) {
 
   if(_thread->OnDifferentThread()) {
     _thread->Post(std::bind(&TerminalServer::CreateNewTerminal,
                             shared_from_this(),
                             app_client_id,
-                            remote_host_id));
+                            remote_host_id,
+                            owner_key));
     return;
   }
 
@@ -82,15 +157,61 @@ void TerminalServer::CreateNewTerminal(uint32_t app_client_id, uint32_t remote_h
   }
 
   uint32_t terminal_id = NextId();
-  _remote_hosts[remote_host_id].AddTerminal(terminal_id, {remote_host_id, app_client_id});
-
-  auto data = std::make_shared<Data>(4, (unsigned char*)&terminal_id);
+  _remote_hosts[remote_host_id].AddTerminal(terminal_id, {remote_host_id, app_client_id, 0, owner_key});
+
+  std::string wire_owner_key(owner_key);
+  wire_owner_key.resize(MessageType::OWNER_KEY_SIZE, '\0');
+  auto data = std::make_shared<Data>(8 + MessageType::OWNER_KEY_SIZE);
+  data->Add(4, (unsigned char*)&terminal_id);
+  data->Add(4, (unsigned char*)&_instance_id);
+  data->Add(MessageType::OWNER_KEY_SIZE, (unsigned char*)wire_owner_key.data());
   auto resource = std::make_shared<DataResource>(data);
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::CREATE_TERMINAL, resource);
 
   remote_host->Send(msg);
 }
 
+void TerminalServer::ReattachTerminal(uint32_t app_client_id, const std::string& owner_key, uint32_t remote_host_id, uint32_t terminal_id) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::ReattachTerminal, shared_from_this(), app_client_id, owner_key, remote_host_id, terminal_id));
+    return;
+  }
+
+  auto host_it = _remote_hosts.find(remote_host_id);
+  TerminalInfo info;
+  if(host_it == _remote_hosts.end() || !host_it->second.ClaimTerminal(terminal_id, app_client_id, owner_key, info)) {
+    DLOG(warn, "TerminalServer::ReattachTerminal : can't reattach terminal : client : {}, terminal : {}", app_client_id, terminal_id);
+    return;
+  }
+  _orphan_times.erase(terminal_id);
+
+  DLOG(info, "TerminalServer::ReattachTerminal : client : {}, terminal : {}", app_client_id, terminal_id);
+  _webapp_server->OnTerminalCreated(app_client_id, terminal_id, remote_host_id, true);
+  ResyncTerminal(remote_host_id, terminal_id, info._output_offset);
+}
+
+void TerminalServer::OfferOrphanedTerminals(const std::string& owner_key) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::OfferOrphanedTerminals, shared_from_this(), owner_key));
+    return;
+  }
+
+  if(owner_key.empty()) {
+    return;
+  }
+  for(auto& host : _remote_hosts) {
+    std::vector<uint32_t> terminal_ids;
+    for(auto& terminal : host.second.GetTerminals()) {
+      if(!terminal.second._app_client_id && terminal.second._owner_key == owner_key) {
+        terminal_ids.push_back(terminal.first);
+      }
+    }
+    if(!terminal_ids.empty()) {
+      _webapp_server->OnTerminalsOrphaned(owner_key, host.first, terminal_ids);
+    }
+  }
+}
+
 void TerminalServer::ResizeTerminal(int remote_host_id, int terminal_id, int width, int height) {
   if(_thread->OnDifferentThread()) {
     _thread->Post(std::bind(&TerminalServer::ResizeTerminal,
@@ -115,6 +236,10 @@ void TerminalServer::ResizeTerminal(int remote_host_id, int terminal_id, int wid
   auto data = std::make_shared<Data>(4, (unsigned char*)&terminal_id_ui32);
   data->Add(2, (unsigned char*)&width_ui16);
   data->Add(2, (unsigned char*)&height_ui16);
+  uint32_t read_acks = TakeReadAcks((uint32_t)remote_host_id);
+  if(read_acks) {
+    data->Add(4, (unsigned char*)&read_acks);
+  }
   auto resource = std::make_shared<DataResource>(data);
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::RESIZE_TERMINAL, resource);
 
@@ -145,6 +270,24 @@ void TerminalServer::DeleteTerminal(int remote_host_id, int terminal_id){
   proxy_client->Send(msg);
 }
 
+void TerminalServer::ResyncTerminal(uint32_t remote_host_id, uint32_t terminal_id, uint64_t offset) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::ResyncTerminal, shared_from_this(), remote_host_id, terminal_id, offset));
+    return;
+  }
+
+  auto proxy_client = _proxy_server->GetClient(remote_host_id);
+  if(!proxy_client) {
+    DLOG(warn, "TerminalServer::ResyncTerminal : terminal client doesn't exist");
+    return;
+  }
+
+  auto data = std::make_shared<Data>(12);
+  data->Add(4, (unsigned char*)&terminal_id);
+  data->Add(8, (unsigned char*)&offset);
+  proxy_client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::TERMINAL_RESYNC, std::make_shared<DataResource>(data)));
+}
+
 void TerminalServer::SendKeyEvent(int remote_host_id, int terminal_id, const std::string& key) {
   if(_thread->OnDifferentThread()) {
     _thread->Post(std::bind(&TerminalServer::SendKeyEvent, shared_from_this(), remote_host_id, terminal_id, key));
@@ -157,15 +300,82 @@ void TerminalServer::SendKeyEvent(int remote_host_id, int terminal_id, const std
     return;
   }
 
+  // pending read acks ride along with the keystroke instead of a frame of their own
+  uint32_t read_acks = TakeReadAcks((uint32_t)remote_host_id);
   auto data = std::make_shared<Data>();
   data->Add(4, (const unsigned char*)&terminal_id);
+  if(read_acks) {
+    data->Add(4, (const unsigned char*)&read_acks);
+  }
   data->Add(key.length(), (const unsigned char*)key.c_str());
   auto resource = std::make_shared<DataResource>(data);
-  auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::ON_TERMINAL_WRITE, resource);
+  auto type = read_acks ? MessageType::ON_TERMINAL_WRITE_ACKED : MessageType::ON_TERMINAL_WRITE;
+  auto msg = std::make_shared<SimpleMessage>((uint8_t)type, resource);
 
   proxy_client->Send(msg);
 }
 
+void TerminalServer::SetTerminalGroup(uint32_t group_id, std::map<uint32_t, std::vector<uint32_t>> terminals_by_host) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::SetTerminalGroup, shared_from_this(), group_id, terminals_by_host));
+    return;
+  }
+
+  // hosts dropped from the group get an empty member list
+  std::set<uint32_t>& group_hosts = _terminal_groups[group_id];
+  for(uint32_t host_id : group_hosts) {
+    terminals_by_host.insert(std::make_pair(host_id, std::vector<uint32_t>()));
+  }
+  group_hosts.clear();
+
+  for(auto& host_terminals : terminals_by_host) {
+    auto host_client = _proxy_server->GetClient(host_terminals.first);
+    if(!host_client) {
+      continue;
+    }
+    uint16_t count = (uint16_t)host_terminals.second.size();
+    auto data = std::make_shared<Data>(6 + 4 * count);
+    data->Add(4, (unsigned char*)&group_id);
+    data->Add(2, (unsigned char*)&count);
+    for(uint32_t terminal_id : host_terminals.second) {
+      data->Add(4, (unsigned char*)&terminal_id);
+    }
+    host_client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::TERMINAL_GROUP, std::make_shared<DataResource>(data)));
+    if(count) {
+      group_hosts.insert(host_terminals.first);
+    }
+  }
+
+  if(group_hosts.empty()) {
+    _terminal_groups.erase(group_id);
+  }
+}
+
+void TerminalServer::BroadcastKeyEvent(uint32_t group_id, const std::string& key) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::BroadcastKeyEvent, shared_from_this(), group_id, key));
+    return;
+  }
+
+  auto it = _terminal_groups.find(group_id);
+  if(it == _terminal_groups.end()) {
+    return;
+  }
+
+  // hosts know their group members, so every host gets the very same message
+  auto data = std::make_shared<Data>(4 + key.length());
+  data->Add(4, (const unsigned char*)&group_id);
+  data->Add(key);
+  auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::ON_TERMINAL_GROUP_WRITE, std::make_shared<DataResource>(data));
+
+  for(uint32_t host_id : it->second) {
+    auto host_client = _proxy_server->GetClient(host_id);
+    if(host_client) {
+      host_client->Send(msg);
+    }
+  }
+}
+
 
 void TerminalServer::OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) {
   std::shared_ptr<SimpleMessage> simple_msg = std::static_pointer_cast<SimpleMessage>(msg);
@@ -177,6 +387,7 @@ void TerminalServer::OnClientRead(std::shared_ptr<Client> client, std::shared_pt
   if(!msg_content->IsCompleted()) {
     return;
   }
+  _liveness->OnActivity(client_id);
 
   switch(MessageType::TypeFromInt(simple_msg->GetHeader()->_type)) {
     case MessageType::CLIENT_INFO:
@@ -187,21 +398,62 @@ void TerminalServer::OnClientRead(std::shared_ptr<Client> client, std::shared_pt
       break;
     case MessageType::ON_TERMINAL_READ:
       {
-        client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::ON_TERMINAL_READ_ACK));
+        QueueReadAck(client);
         HandleTerminalRead(client, msg_data);
       }
       break;
+    case MessageType::ON_TERMINAL_READ_DEFLATED:
+      {
+        auto output = InflateTerminalRead(client, msg_data);
+        if(!output) {
+          // later frames depend on this one, the host resumes its terminals after reconnecting
+          DLOG(error, "TerminalServer : broken or oversized compressed output from client : {}", client_id);
+          _proxy_server->RemoveClient(client);
+          OnClientClosed(client);
+          break;
+        }
+        QueueReadAck(client);
+        HandleTerminalRead(client, output);
+      }
+      break;
+    case MessageType::LINK_COMPRESSION:
+      HandleLinkCompression(client);
+      break;
     case MessageType::ON_TERMINAL_END:
       HandleTerminalEnd(client, msg_data);
       break;
+    case MessageType::TERMINAL_WRITE_STATE:
+      HandleTerminalWriteState(client, msg_data);
+      break;
+    case MessageType::TERMINAL_RESUME:
+      HandleTerminalResume(client, msg_data);
+      break;
     case MessageType::PING:
       HandlePingMessage(client);
       break;
     case MessageType::PONG :
+      HandlePongMessage(client);
       break;
     case MessageType::FILE_TRANSFER_INIT :
       HandleFileTransferInit(client, msg_data);
       break;
+    case MessageType::FILE_LIST_RESP :
+      HandleDirectoryListing(client, msg_data);
+      break;
+    case MessageType::DIST_JOIN :
+      HandleDistributionJoin(client, msg_data);
+      break;
+    case MessageType::EXEC_OUTPUT :
+      HandleExecOutput(client, msg_data);
+      break;
+    case MessageType::EXEC_END :
+      HandleExecEnd(client, msg_data);
+      break;
+    case MessageType::DIST_READY :
+    case MessageType::DIST_PROGRESS :
+    case MessageType::DIST_DONE :
+      HandleDistributionMsg(client, MessageType::TypeFromInt(simple_msg->GetHeader()->_type), msg_data);
+      break;
     default:
       log()->warn("TerminalServer : Got Unexpected message type : {}", simple_msg->GetHeader()->_type);
       break;
@@ -214,7 +466,57 @@ void TerminalServer::OnClientClosed(std::shared_ptr<Client> client) {
     return;
   }
 
-  _remote_hosts.erase(client->GetId());
+  // the host keeps its shells running and resumes them once it reconnects
+  auto now = std::chrono::steady_clock::now();
+  auto host_it = _remote_hosts.find(client->GetId());
+  if(host_it != _remote_hosts.end()) {
+    for(auto& terminal : host_it->second.GetTerminals()) {
+      if(terminal.second._app_client_id) {
+        _detached_terminals[terminal.first] = {terminal.second, now};
+      }
+    }
+    _remote_hosts.erase(host_it);
+  }
+  _pending_registrations.erase(client->GetId());
+  _liveness->Remove(client->GetId());
+  for(auto it = _detached_terminals.begin(); it != _detached_terminals.end();) {
+    if(now - it->second._detach_time > DETACHED_TERMINAL_TIMEOUT) {
+      it = _detached_terminals.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(_ping_mutex);
+    _ping_times.erase(client->GetId());
+  }
+  {
+    std::lock_guard<std::mutex> lock(_read_ack_mutex);
+    _pending_read_acks.erase(client->GetId());
+  }
+  {
+    std::lock_guard<std::mutex> lock(_link_mutex);
+    _link_decompressors.erase(client->GetId());
+  }
+  RemoveTransferHost(client->GetId());
+  {
+    std::lock_guard<std::mutex> lock(_distribution_mutex);
+    for(auto& distribution : _distributions) {
+      distribution.second->OnHostClosed(client->GetId());
+    }
+  }
+  for(auto& group : _terminal_groups) {
+    group.second.erase(client->GetId());
+  }
+  std::vector<uint32_t> lost_execs;
+  for(auto& running : _exec_running) {
+    if(running.first.second == client->GetId()) {
+      lost_execs.push_back(running.first.first);
+    }
+  }
+  for(uint32_t exec_id : lost_execs) {
+    FinishExecTask(exec_id, client->GetId(), -1, CommandRunner::EndFlags::HOST_LOST);
+  }
   _webapp_server->OnTerminalClientClosed(client->GetId());
 }
 
@@ -222,6 +524,11 @@ bool TerminalServer::OnClientConnecting(std::shared_ptr<Client> client, NetError
   if(err != NetError::OK) {
     return false;
   }
+  // refused hosts back off and retry, see ReconnectBackoff
+  if(!_accept_limiter->Acquire()) {
+    _rejected_connections++;
+    return false;
+  }
   auto msg_builder = std::unique_ptr<SimpleMessageBuilder>(new SimpleMessageBuilder());
   client->SetMsgBuilder(std::move(msg_builder));
   return true;
@@ -231,6 +538,10 @@ void TerminalServer::OnClientConnected(std::shared_ptr<Client> client) {
 }
 
 void TerminalServer::SendPingToClient(std::shared_ptr<Client> client) {
+  {
+    std::lock_guard<std::mutex> lock(_ping_mutex);
+    _ping_times[client->GetId()] = std::chrono::steady_clock::now();
+  }
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::PING);
   client->Send(msg);
 }
@@ -244,13 +555,88 @@ void TerminalServer::OnClientUnresponsive(std::shared_ptr<Client> client) {
   OnClientClosed(client);
 }
 
+void TerminalServer::OnLivenessPing(uint32_t client_id) {
+  auto client = _proxy_server->GetClient(client_id);
+  if(client) {
+    SendPingToClient(client);
+  }
+}
+
+void TerminalServer::OnLivenessTimeout(uint32_t client_id) {
+  auto client = _proxy_server->GetClient(client_id);
+  if(client) {
+    OnClientUnresponsive(client);
+  }
+}
+
 void TerminalServer::HandleClientInfo(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::HandleClientInfo, shared_from_this(), client, msg_data));
+    return;
+  }
+
   auto data = msg_data->GetCurrentDataRaw();
   std::string user_name((char*)msg_data->GetCurrentDataRaw());
   std::string host_name((char*)msg_data->GetCurrentDataRaw() + user_name.size() + 1,
                           (size_t)(msg_data->GetCurrentSize() - user_name.size() - 1));
-  ConnectionChecker::MonitorClient(client, shared_from_this());
-  _webapp_server->OnRemoteHostInfoReceived(client->GetId(), client->GetIp(), user_name, host_name);
+
+  // admitted in batches, a reconnecting fleet doesn't turn into one broadcast per host
+  _pending_registrations[client->GetId()] = {client, user_name, host_name, nullptr};
+  _registration_order.push_back(client->GetId());
+  ScheduleRegistrations();
+}
+
+void TerminalServer::ScheduleRegistrations() {
+  if(_registration_scheduled) {
+    return;
+  }
+  _registration_scheduled = true;
+  _task_timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(REGISTRATION_BATCH_INTERVAL),
+                        std::bind(&TerminalServer::ProcessRegistrations, shared_from_this()));
+}
+
+void TerminalServer::ProcessRegistrations() {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::ProcessRegistrations, shared_from_this()));
+    return;
+  }
+
+  _registration_scheduled = false;
+  std::map<uint32_t, RemoteHostInfo> remote_hosts;
+  std::vector<PendingRegistration> resumes;
+  while(!_registration_order.empty() && remote_hosts.size() < REGISTRATION_BATCH_SIZE) {
+    uint32_t client_id = _registration_order.front();
+    _registration_order.pop_front();
+    auto it = _pending_registrations.find(client_id);
+    if(it == _pending_registrations.end()) {
+      continue;
+    }
+    PendingRegistration registration = it->second;
+    _pending_registrations.erase(it);
+
+    // the first PING also tells the host it was admitted
+    _liveness->Add(client_id);
+    SendPingToClient(registration._client);
+    remote_hosts[client_id] = {registration._client->GetIp(), registration._user_name, registration._host_name};
+    if(registration._resume_data) {
+      resumes.push_back(registration);
+    }
+  }
+
+  if(!remote_hosts.empty()) {
+    _webapp_server->OnRemoteHostsInfoReceived(remote_hosts);
+  }
+  for(auto& registration : resumes) {
+    HandleTerminalResume(registration._client, registration._resume_data);
+  }
+
+  DLOG(info, "ProcessRegistrations : admitted : {}, waiting : {}, refused connections : {}",
+       remote_hosts.size(),
+       _pending_registrations.size(),
+       _rejected_connections.exchange(0));
+  if(!_registration_order.empty()) {
+    ScheduleRegistrations();
+  }
 }
 
 void TerminalServer::HandleTerminalCreated(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
@@ -297,9 +683,110 @@ void TerminalServer::HandleTerminalRead(std::shared_ptr<Client> client, std::sha
     return;
   }
 
+  _remote_hosts[client_id].AddTerminalOutput(terminal_id, msg_data->GetCurrentSize());
   _webapp_server->OnTerminalOutput(app_client_id, terminal_id, msg_data);
 }
 
+void TerminalServer::QueueReadAck(std::shared_ptr<Client> client) {
+  uint32_t count = 0;
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(_read_ack_mutex);
+    auto it = _pending_read_acks.find(client->GetId());
+    if(it == _pending_read_acks.end()) {
+      it = _pending_read_acks.insert({client->GetId(), 0}).first;
+    }
+    if(++it->second >= READ_ACK_BATCH) {
+      count = it->second;
+      _pending_read_acks.erase(it);
+    } else if(!_read_ack_scheduled) {
+      _read_ack_scheduled = true;
+      schedule = true;
+    }
+  }
+
+  if(count) {
+    SendReadAck(client, count);
+  }
+  if(schedule) {
+    _task_timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(READ_ACK_DELAY),
+                          std::bind(&TerminalServer::FlushReadAcks, shared_from_this()));
+  }
+}
+
+uint32_t TerminalServer::TakeReadAcks(uint32_t remote_host_id) {
+  std::lock_guard<std::mutex> lock(_read_ack_mutex);
+  auto it = _pending_read_acks.find(remote_host_id);
+  if(it == _pending_read_acks.end()) {
+    return 0;
+  }
+  uint32_t count = it->second;
+  _pending_read_acks.erase(it);
+  return count;
+}
+
+void TerminalServer::FlushReadAcks() {
+  std::map<uint32_t, uint32_t> pending_acks;
+  {
+    std::lock_guard<std::mutex> lock(_read_ack_mutex);
+    pending_acks.swap(_pending_read_acks);
+    _read_ack_scheduled = false;
+  }
+
+  for(auto& pending : pending_acks) {
+    auto client = _proxy_server->GetClient(pending.first);
+    if(client) {
+      SendReadAck(client, pending.second);
+    }
+  }
+}
+
+void TerminalServer::SendReadAck(std::shared_ptr<Client> client, uint32_t count) {
+  auto data = std::make_shared<Data>(4, (unsigned char*)&count);
+  auto resource = std::make_shared<DataResource>(data);
+  client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::ON_TERMINAL_READ_ACK, resource));
+}
+
+void TerminalServer::HandleLinkCompression(std::shared_ptr<Client> client) {
+  auto decompressor = std::make_shared<StreamDecompressor>(MessageType::MAX_INFLATED_READ_SIZE);
+  if(!decompressor->Init()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_link_mutex);
+    _link_decompressors[client->GetId()] = decompressor;
+  }
+  // the host starts compressing once it gets the answer
+  client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::LINK_COMPRESSION));
+}
+
+std::shared_ptr<Data> TerminalServer::InflateTerminalRead(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  std::shared_ptr<StreamDecompressor> decompressor;
+  {
+    std::lock_guard<std::mutex> lock(_link_mutex);
+    auto it = _link_decompressors.find(client->GetId());
+    if(it == _link_decompressors.end()) {
+      return nullptr;
+    }
+    decompressor = it->second;
+  }
+
+  uint32_t terminal_id = 0;
+  if(!msg_data->CopyTo(&terminal_id, 0, 4)) {
+    return nullptr;
+  }
+  // frames of one host are read in order, the stream is never inflated from two threads
+  auto inflated = decompressor->Decompress(msg_data->GetCurrentDataRaw() + 4, msg_data->GetCurrentSize() - 4, true);
+  if(!inflated) {
+    return nullptr;
+  }
+
+  auto output = std::make_shared<Data>(4 + inflated->GetCurrentSize());
+  output->Add(4, (unsigned char*)&terminal_id);
+  output->Add(inflated->GetCurrentSize(), inflated->GetCurrentDataRaw());
+  return output;
+}
+
 void TerminalServer::HandleTerminalEnd(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
   if(_thread->OnDifferentThread()) {
     _thread->Post(std::bind(&TerminalServer::HandleTerminalEnd, shared_from_this(), client, msg_data));
@@ -315,14 +802,214 @@ void TerminalServer::HandleTerminalEnd(std::shared_ptr<Client> client, std::shar
     return;
   }
 
+  if(!app_client_id) {
+    // an orphaned shell exited before its owner reattached it
+    TerminalInfo info;
+    _remote_hosts[remote_host_id].RemoveTerminal(terminal_id, info);
+    _orphan_times.erase(terminal_id);
+    return;
+  }
+
   _webapp_server->OnTerminalClosed(app_client_id, terminal_id, remote_host_id);
 }
 
+void TerminalServer::HandleTerminalWriteState(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::HandleTerminalWriteState, shared_from_this(), client, msg_data));
+    return;
+  }
+  uint32_t terminal_id = 0;
+  uint8_t blocked = 0;
+  uint32_t dropped_bytes = 0;
+  uint32_t app_client_id = 0;
+  if(!msg_data->CopyTo(&terminal_id, 0, 4) || !msg_data->CopyTo(&blocked, 4, 1)) {
+    DLOG(warn, "HandleTerminalWriteState : invalid message");
+    return;
+  }
+  // older agents don't send the dropped count
+  msg_data->CopyTo(&dropped_bytes, 5, 4);
+
+  if(!GetAppClinetId(client->GetId(), terminal_id, app_client_id)) {
+    DLOG(warn, "HandleTerminalWriteState Failed");
+    return;
+  }
+
+  _webapp_server->OnTerminalWriteState(app_client_id, terminal_id, (bool)blocked, dropped_bytes);
+}
+
+void TerminalServer::HandleTerminalResume(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::HandleTerminalResume, shared_from_this(), client, msg_data));
+    return;
+  }
+
+  auto pending = _pending_registrations.find(client->GetId());
+  if(pending != _pending_registrations.end()) {
+    // resumed terminals are announced after their host
+    pending->second._resume_data = msg_data;
+    return;
+  }
+
+  uint32_t remote_host_id = client->GetId();
+  uint32_t count = 0;
+  if(!msg_data->CopyTo(&count, 0, 4) || msg_data->GetCurrentSize() < 4 + (size_t)count * 24) {
+    DLOG(warn, "HandleTerminalResume : invalid message");
+    return;
+  }
+  // owner keys follow the entries, older clients don't send them
+  bool has_owner_keys = msg_data->GetCurrentSize() >= 4 + (size_t)count * (24 + MessageType::OWNER_KEY_SIZE);
+
+  size_t orphans = 0;
+  std::map<std::string, std::vector<uint32_t>> orphans_by_owner;
+  for(uint32_t i = 0; i < count; ++i) {
+    uint32_t terminal_id = 0;
+    uint32_t instance_id = 0;
+    uint64_t start_offset = 0;
+    uint64_t end_offset = 0;
+    size_t pos = 4 + (size_t)i * 24;
+    msg_data->CopyTo(&terminal_id, pos, 4);
+    msg_data->CopyTo(&instance_id, pos + 4, 4);
+    msg_data->CopyTo(&start_offset, pos + 8, 8);
+    msg_data->CopyTo(&end_offset, pos + 16, 8);
+    std::string owner_key;
+    if(has_owner_keys) {
+      owner_key.resize(MessageType::OWNER_KEY_SIZE);
+      msg_data->CopyTo(&owner_key[0], 4 + count * 24 + i * MessageType::OWNER_KEY_SIZE, MessageType::OWNER_KEY_SIZE);
+      owner_key.erase(std::find(owner_key.begin(), owner_key.end(), '\0'), owner_key.end());
+    }
+
+    TerminalInfo info;
+    TerminalInfo used_info;
+    bool known = false;
+    auto detached = _detached_terminals.find(terminal_id);
+    // shells reattached after a restart still carry the old instance, their owner key matches the stored one
+    bool is_reattached = !owner_key.empty() && detached != _detached_terminals.end() &&
+                         detached->second._info._owner_key == owner_key;
+    if(instance_id == _instance_id || is_reattached) {
+      if(detached != _detached_terminals.end()) {
+        info = detached->second._info;
+        _detached_terminals.erase(detached);
+        known = true;
+      } else {
+        // the old connection isn't closed on this side yet
+        known = TakeOverTerminal(terminal_id, info);
+      }
+    } else if(IsTerminalIdUsed(terminal_id, used_info)) {
+      if(owner_key.empty() || used_info._owner_key != owner_key) {
+        // created before a server restart, the id was given out again since
+        DLOG(warn, "HandleTerminalResume : terminal id already in use : {}", terminal_id);
+        DeleteTerminal((int)remote_host_id, (int)terminal_id);
+        continue;
+      }
+      // the same shell resumed again before its old connection was closed on this side
+      TakeOverTerminal(terminal_id, info);
+      known = info._app_client_id != 0;
+    }
+
+    if(!known) {
+      uint32_t last_id = _id_counter.load();
+      while(last_id < terminal_id && !_id_counter.compare_exchange_weak(last_id, terminal_id)) {
+      }
+      if(AddOrphanedTerminal(remote_host_id, terminal_id, start_offset, owner_key) && !owner_key.empty()) {
+        orphans_by_owner[owner_key].push_back(terminal_id);
+      }
+      orphans++;
+      continue;
+    }
+
+    info._proxy_clinet_id = remote_host_id;
+    info._output_offset = std::min(std::max(info._output_offset, start_offset), end_offset);
+    _remote_hosts[remote_host_id].AddTerminal(terminal_id, info);
+    _webapp_server->OnTerminalResumed(info._app_client_id, terminal_id, remote_host_id, info._output_offset);
+  }
+  DLOG(info, "HandleTerminalResume : host : {}, terminals : {}, without owner : {}", remote_host_id, count, orphans);
+  // browsers of the owners are asked to reattach, nobody else gets the shells or their output
+  for(auto& owner : orphans_by_owner) {
+    _webapp_server->OnTerminalsOrphaned(owner.first, remote_host_id, owner.second);
+  }
+}
+
+bool TerminalServer::AddOrphanedTerminal(uint32_t remote_host_id, uint32_t terminal_id, uint64_t start_offset, const std::string& owner_key) {
+  // the timeout runs from the first resume, a host reconnecting again doesn't extend it
+  auto now = std::chrono::steady_clock::now();
+  auto orphan_time = _orphan_times.emplace(terminal_id, now).first->second;
+  auto remaining = orphan_time + DETACHED_TERMINAL_TIMEOUT - now;
+  if(remaining <= std::chrono::steady_clock::duration::zero()) {
+    DLOG(info, "AddOrphanedTerminal : not reattached in time, deleting terminal : {}", terminal_id);
+    _orphan_times.erase(terminal_id);
+    DeleteTerminal((int)remote_host_id, (int)terminal_id);
+    return false;
+  }
+
+  _remote_hosts[remote_host_id].AddTerminal(terminal_id, {remote_host_id, 0, start_offset, owner_key});
+  _task_timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(remaining),
+                        std::bind(&TerminalServer::ExpireOrphanedTerminal, shared_from_this(), terminal_id));
+  return true;
+}
+
+void TerminalServer::ExpireOrphanedTerminal(uint32_t terminal_id) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::ExpireOrphanedTerminal, shared_from_this(), terminal_id));
+    return;
+  }
+
+  // reattached, exited, or already expired through an earlier resume
+  auto orphan_time = _orphan_times.find(terminal_id);
+  if(orphan_time == _orphan_times.end() || std::chrono::steady_clock::now() - orphan_time->second < DETACHED_TERMINAL_TIMEOUT) {
+    return;
+  }
+
+  for(auto& host : _remote_hosts) {
+    TerminalInfo info;
+    if(host.second.GetTerminalInfo(terminal_id, info) && !info._app_client_id) {
+      DLOG(info, "ExpireOrphanedTerminal : not reattached, deleting terminal : {}", terminal_id);
+      host.second.RemoveTerminal(terminal_id, info);
+      _orphan_times.erase(orphan_time);
+      DeleteTerminal((int)host.first, (int)terminal_id);
+      return;
+    }
+  }
+  // the host is offline, the terminal is deleted once it resumes
+}
+
+bool TerminalServer::TakeOverTerminal(uint32_t terminal_id, TerminalInfo& out_info) {
+  for(auto& host : _remote_hosts) {
+    if(host.second.RemoveTerminal(terminal_id, out_info)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TerminalServer::IsTerminalIdUsed(uint32_t terminal_id, TerminalInfo& out_info) {
+  for(auto& host : _remote_hosts) {
+    if(host.second.GetTerminalInfo(terminal_id, out_info)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void TerminalServer::HandlePingMessage(std::shared_ptr<Client> client) {
   auto msg = std::make_shared<SimpleMessage>((uint8_t)MessageType::PONG);
   client->Send(msg);
 }
 
+void TerminalServer::HandlePongMessage(std::shared_ptr<Client> client) {
+  std::chrono::steady_clock::time_point ping_time;
+  {
+    std::lock_guard<std::mutex> lock(_ping_mutex);
+    auto it = _ping_times.find(client->GetId());
+    if(it == _ping_times.end()) {
+      return;
+    }
+    ping_time = it->second;
+    _ping_times.erase(it);
+  }
+  auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - ping_time);
+  _scheduler->OnRttSample(client->GetId(), rtt);
+}
+
 void TerminalServer::HandleFileTransferInit(std::shared_ptr<Client> client, std::shared_ptr<Data> data) {
   FileTransferHandlerServer::HandleFileTransferInit(client, data);
   _proxy_server->RemoveClient(client);
@@ -346,14 +1033,49 @@ bool TerminalServer::GetAppClinetId(uint32_t client_id, uint32_t terminal_id, ui
 }
 
 
-std::shared_ptr<FileTransfer> TerminalServer::CreateFileRequest(int remote_host_id, uint32_t file_transfer_id, const std::string& path, bool is_download_from_client) {
+bool TerminalServer::RequestDirectoryListing(int remote_host_id, uint32_t req_id, const DirectoryPager::Options& options) {
+  auto host_client = _proxy_server->GetClient((uint32_t)remote_host_id);
+  if(!host_client) {
+    DLOG(warn, "TerminalServer::RequestDirectoryListing : host_client doesn't exist");
+    return false;
+  }
+
+  auto options_data = DirectoryPager::SerializeOptions(options);
+  auto data = std::make_shared<Data>(4 + options_data->GetCurrentSize());
+  data->Add(4, (unsigned char*)&req_id);
+  data->Add(options_data->GetCurrentSize(), options_data->GetCurrentDataRaw());
+  auto resource = std::make_shared<DataResource>(data);
+  host_client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::FILE_LIST_REQ, resource));
+  return true;
+}
+
+void TerminalServer::HandleDirectoryListing(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  uint32_t req_id = 0;
+  uint8_t status = ListingStatus::LISTING_FAILED;
+  uint32_t cursor = 0;
+  bool data_retrieved = true;
+
+  data_retrieved = data_retrieved && msg_data->CopyTo(&req_id, 0, 4);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&status, 4, 1);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&cursor, 5, 4);
+  if(!data_retrieved) {
+    DLOG(error, "HandleDirectoryListing : data error");
+    return;
+  }
+
+  msg_data->SetOffset(9);
+  auto page = std::make_shared<Data>(msg_data->GetCurrentSize(), msg_data->GetCurrentDataRaw());
+  _webapp_server->OnDirectoryListingReceived(client->GetId(), req_id, status, cursor, page);
+}
+
+std::shared_ptr<FileTransfer> TerminalServer::CreateFileRequest(int remote_host_id, uint32_t file_transfer_id, const std::string& path, bool is_download_from_client, uint8_t flags, std::shared_ptr<DownloadCache> download_cache, const std::string& cache_key) {
   auto host_client = _proxy_server->GetClient((uint32_t)remote_host_id);
   if(!host_client) {
     DLOG(warn, "TerminalServer::CreateFileRequest : host_client doesn't exist");
     return nullptr;
   }
 
-  auto request = MakeNewTransferReq(host_client, file_transfer_id, path, is_download_from_client);
+  auto request = MakeNewTransferReq(host_client, file_transfer_id, path, is_download_from_client, flags, download_cache, cache_key);
   if(!request) {
     DLOG(error, "TerminalServer::CreateFileRequest failed");
   }
@@ -370,4 +1092,223 @@ void TerminalServer::OnFileTransferDataReceived(std::shared_ptr<FileTransfer> fi
 
 std::shared_ptr<FileTransferHandler> TerminalServer::GetSptr() {
   return shared_from_this();
-}
\ No newline at end of file
+}
+
+uint32_t TerminalServer::StartDistribution(const std::string& source_path,
+                                           const std::string& dest_path,
+                                           const std::vector<uint32_t>& host_ids,
+                                           uint32_t fanout) {
+  uint32_t job_id = NextId();
+  auto job = std::make_shared<DistributionJob>(job_id, source_path, dest_path, fanout, _proxy_server);
+  if(!job->Init(host_ids)) {
+    DLOG(error, "TerminalServer::StartDistribution : failed : {}", source_path);
+    return 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_distribution_mutex);
+    size_t finished_jobs = 0;
+    for(auto& distribution : _distributions) {
+      if(distribution.second->IsFinished()) {
+        ++finished_jobs;
+      }
+    }
+    // ids grow, the oldest finished jobs go first
+    for(auto it = _distributions.begin(); it != _distributions.end() && finished_jobs > MAX_FINISHED_DISTRIBUTIONS;) {
+      if(it->second->IsFinished()) {
+        it = _distributions.erase(it);
+        --finished_jobs;
+      } else {
+        ++it;
+      }
+    }
+    _distributions.insert(std::make_pair(job_id, job));
+  }
+  // the job is listed as pending until its manifest is hashed
+  _file_thread->Post(std::bind(&TerminalServer::PrepareDistribution, shared_from_this(), job));
+  return job_id;
+}
+
+void TerminalServer::PrepareDistribution(std::shared_ptr<DistributionJob> job) {
+  if(!job->Prepare()) {
+    job->Fail();
+    return;
+  }
+  job->Start();
+}
+
+bool TerminalServer::GetDistributionStatus(uint32_t job_id, std::string& out_status) {
+  auto job = GetDistribution(job_id);
+  if(!job) {
+    return false;
+  }
+  out_status = job->GetStatus();
+  return true;
+}
+
+std::shared_ptr<DistributionJob> TerminalServer::GetDistribution(uint32_t job_id) {
+  std::lock_guard<std::mutex> lock(_distribution_mutex);
+  auto it = _distributions.find(job_id);
+  if(it == _distributions.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void TerminalServer::HandleDistributionJoin(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  uint32_t job_id = 0;
+  msg_data->CopyTo(&job_id, 0, 4);
+  auto job = GetDistribution(job_id);
+  if(!job) {
+    DLOG(error, "HandleDistributionJoin : job doesn't exist : {}", job_id);
+    return;
+  }
+  job->AddPeer(client);
+  _proxy_server->RemoveClient(client);
+}
+
+void TerminalServer::HandleDistributionMsg(std::shared_ptr<Client> client, MessageType::Type type, std::shared_ptr<Data> msg_data) {
+  uint32_t job_id = 0;
+  if(!msg_data->CopyTo(&job_id, 0, 4)) {
+    DLOG(error, "HandleDistributionMsg : data error");
+    return;
+  }
+  auto job = GetDistribution(job_id);
+  if(!job) {
+    DLOG(warn, "HandleDistributionMsg : job doesn't exist : {}", job_id);
+    return;
+  }
+
+  if(type == MessageType::DIST_READY) {
+    uint16_t relay_port = 0;
+    msg_data->CopyTo(&relay_port, 4, 2);
+    job->OnMemberReady(client->GetId(), relay_port);
+  } else if(type == MessageType::DIST_PROGRESS) {
+    uint32_t chunks_done = 0;
+    msg_data->CopyTo(&chunks_done, 4, 4);
+    job->OnMemberProgress(client->GetId(), chunks_done);
+  } else {
+    uint8_t success = 0;
+    msg_data->CopyTo(&success, 4, 1);
+    job->OnMemberDone(client->GetId(), (bool)success);
+  }
+}
+
+uint32_t TerminalServer::StartExec(uint32_t app_client_id,
+                                   const std::string& command,
+                                   const std::vector<uint32_t>& host_ids,
+                                   uint32_t timeout_ms) {
+  uint32_t exec_id = NextId();
+  std::vector<ExecTask> tasks;
+  for(uint32_t host_id : host_ids) {
+    tasks.push_back({exec_id, app_client_id, host_id, command, timeout_ms});
+  }
+  QueueExecTasks(tasks);
+  return exec_id;
+}
+
+void TerminalServer::QueueExecTasks(std::vector<ExecTask> tasks) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::QueueExecTasks, shared_from_this(), tasks));
+    return;
+  }
+  _exec_queue.insert(_exec_queue.end(), tasks.begin(), tasks.end());
+  DispatchExecTasks();
+}
+
+void TerminalServer::DispatchExecTasks() {
+  while(!_exec_queue.empty() && (!_exec_max_active || _exec_running.size() < _exec_max_active)) {
+    ExecTask task = _exec_queue.front();
+    _exec_queue.pop_front();
+
+    auto host_client = _proxy_server->GetClient(task._remote_host_id);
+    if(!host_client) {
+      _webapp_server->OnExecEnd(task._app_client_id, task._exec_id, task._remote_host_id, -1, CommandRunner::EndFlags::HOST_LOST);
+      continue;
+    }
+
+    auto data = std::make_shared<Data>(8 + task._command.size());
+    data->Add(4, (unsigned char*)&task._exec_id);
+    data->Add(4, (unsigned char*)&task._timeout_ms);
+    data->Add(task._command);
+    host_client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::EXEC_REQ, std::make_shared<DataResource>(data)));
+
+    _exec_running.insert(std::make_pair(std::make_pair(task._exec_id, task._remote_host_id), task));
+    auto timeout = std::chrono::milliseconds(task._timeout_ms) + EXEC_TIMEOUT_GRACE;
+    _task_timer->Schedule(std::chrono::duration_cast<std::chrono::microseconds>(timeout),
+                          std::bind(&TerminalServer::OnExecTimeout, shared_from_this(), task._exec_id, task._remote_host_id));
+  }
+}
+
+void TerminalServer::HandleExecOutput(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::HandleExecOutput, shared_from_this(), client, msg_data));
+    return;
+  }
+
+  uint32_t exec_id = 0;
+  uint8_t stream = 0;
+  bool data_retrieved = true;
+  data_retrieved = data_retrieved && msg_data->CopyTo(&exec_id, 0, 4);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&stream, 4, 1);
+  if(!data_retrieved) {
+    DLOG(error, "HandleExecOutput : data error");
+    return;
+  }
+
+  auto it = _exec_running.find(std::make_pair(exec_id, client->GetId()));
+  if(it == _exec_running.end()) {
+    return;
+  }
+  msg_data->SetOffset(5);
+  _webapp_server->OnExecOutput(it->second._app_client_id, exec_id, client->GetId(), stream, msg_data);
+}
+
+void TerminalServer::HandleExecEnd(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::HandleExecEnd, shared_from_this(), client, msg_data));
+    return;
+  }
+
+  uint32_t exec_id = 0;
+  int32_t exit_code = -1;
+  uint8_t flags = 0;
+  bool data_retrieved = true;
+  data_retrieved = data_retrieved && msg_data->CopyTo(&exec_id, 0, 4);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&exit_code, 4, 4);
+  data_retrieved = data_retrieved && msg_data->CopyTo(&flags, 8, 1);
+  if(!data_retrieved) {
+    DLOG(error, "HandleExecEnd : data error");
+    return;
+  }
+  FinishExecTask(exec_id, client->GetId(), exit_code, flags);
+}
+
+void TerminalServer::OnExecTimeout(uint32_t exec_id, uint32_t remote_host_id) {
+  if(_thread->OnDifferentThread()) {
+    _thread->Post(std::bind(&TerminalServer::OnExecTimeout, shared_from_this(), exec_id, remote_host_id));
+    return;
+  }
+
+  if(!_exec_running.count(std::make_pair(exec_id, remote_host_id))) {
+    return;
+  }
+  DLOG(warn, "TerminalServer : exec {} timed out on host : {}", exec_id, remote_host_id);
+  auto host_client = _proxy_server->GetClient(remote_host_id);
+  if(host_client) {
+    auto data = std::make_shared<Data>(4, (unsigned char*)&exec_id);
+    host_client->Send(std::make_shared<SimpleMessage>((uint8_t)MessageType::EXEC_CANCEL, std::make_shared<DataResource>(data)));
+  }
+  FinishExecTask(exec_id, remote_host_id, -1, CommandRunner::EndFlags::TIMED_OUT);
+}
+
+void TerminalServer::FinishExecTask(uint32_t exec_id, uint32_t remote_host_id, int32_t exit_code, uint8_t flags) {
+  auto it = _exec_running.find(std::make_pair(exec_id, remote_host_id));
+  if(it == _exec_running.end()) {
+    return;
+  }
+  uint32_t app_client_id = it->second._app_client_id;
+  _exec_running.erase(it);
+  _webapp_server->OnExecEnd(app_client_id, exec_id, remote_host_id, exit_code, flags);
+  DispatchExecTasks();
+}
@@ -24,28 +24,67 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
 
 
 #include "Client.h"
 #include "Terminal.h"
 #include "ConnectionChecker.h"
+#include "MessageType.h"
 #include "FileTransferHandlerServer.h"
+#include "DirectoryPager.h"
+#include "DistributionJob.h"
+#include "LivenessMonitor.h"
 
 class WebAppServer;
 class ThreadLoop;
 class Server;
+class TaskTimer;
+class RateLimiter;
+class StreamDecompressor;
 
 struct TerminalInfo {
   uint32_t _proxy_clinet_id;
   uint32_t _app_client_id;
+  uint64_t _output_offset; // output bytes received from the terminal's start
+  std::string _owner_key; // browser that created it, the only one offered the shell after a server restart
+};
+
+struct DetachedTerminal {
+  TerminalInfo _info;
+  std::chrono::steady_clock::time_point _detach_time;
+};
+
+struct PendingRegistration {
+  std::shared_ptr<Client> _client;
+  std::string _user_name;
+  std::string _host_name;
+  std::shared_ptr<Data> _resume_data; // TERMINAL_RESUME that arrived before the host was admitted
+};
+
+struct ExecTask {
+  uint32_t _exec_id;
+  uint32_t _app_client_id;
+  uint32_t _remote_host_id;
+  std::string _command;
+  uint32_t _timeout_ms;
 };
 
 class RemoteHost {
 public:
   void AddTerminal(uint32_t terminal_id, TerminalInfo info);
   bool GetTerminalInfo(uint32_t terminal_id, TerminalInfo& out_result);
+  bool RemoveTerminal(uint32_t terminal_id, TerminalInfo& out_info);
+  void AddTerminalOutput(uint32_t terminal_id, size_t size);
+  bool ClaimTerminal(uint32_t terminal_id, uint32_t app_client_id, const std::string& owner_key, TerminalInfo& out_info);
+  const std::map<uint32_t, TerminalInfo>& GetTerminals() {return _terminals;}
 private:
   std::map<uint32_t, TerminalInfo> _terminals;
 };
@@ -53,16 +92,22 @@ private:
 class TerminalServer
   : public MonitoringManager
   , public FileTransferHandlerServer
+  , public LivenessListener
   , public std::enable_shared_from_this<TerminalServer> {
 
 public:
   void Init(std::shared_ptr<WebAppServer> server_impl,
             std::shared_ptr<Server> proxy_server);
 
-  void CreateNewTerminal(uint32_t app_client_id, uint32_t remote_host_id);
+  void CreateNewTerminal(uint32_t app_client_id, uint32_t remote_host_id, const std::string& owner_key);
+  void ReattachTerminal(uint32_t app_client_id, const std::string& owner_key, uint32_t remote_host_id, uint32_t terminal_id);
+  void OfferOrphanedTerminals(const std::string& owner_key);
   void ResizeTerminal(int remote_host_id, int terminal_id, int width, int height);
   void DeleteTerminal(int remote_host_id, int terminal_id);
+  void ResyncTerminal(uint32_t remote_host_id, uint32_t terminal_id, uint64_t offset);
   void SendKeyEvent(int remote_host_id, int terminal_id, const std::string& key);
+  void SetTerminalGroup(uint32_t group_id, std::map<uint32_t, std::vector<uint32_t>> terminals_by_host);
+  void BroadcastKeyEvent(uint32_t group_id, const std::string& key);
 
   void OnClientRead(std::shared_ptr<Client> client, std::shared_ptr<Message> msg) override;
   void OnClientClosed(std::shared_ptr<Client> client) override;
@@ -73,27 +118,91 @@ public:
   void CreateClient(std::shared_ptr<MonitorTask> task, const std::string& url, int port) override;
   void OnClientUnresponsive(std::shared_ptr<Client> client) override;
 
-  std::shared_ptr<FileTransfer> CreateFileRequest(int remote_host_id, uint32_t file_transfer_id, const std::string& path, bool is_download_from_client);
+  //LivenessListener
+  void OnLivenessPing(uint32_t client_id) override;
+  void OnLivenessTimeout(uint32_t client_id) override;
+
+  bool RequestDirectoryListing(int remote_host_id, uint32_t req_id, const DirectoryPager::Options& options);
+  std::shared_ptr<FileTransfer> CreateFileRequest(int remote_host_id, uint32_t file_transfer_id, const std::string& path, bool is_download_from_client, uint8_t flags, std::shared_ptr<DownloadCache> download_cache, const std::string& cache_key);
   void OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<SimpleMessage> msg, bool success) override;
   void OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<Message> msg) override;
   std::shared_ptr<FileTransferHandler> GetSptr() override;
 
+  uint32_t StartDistribution(const std::string& source_path,
+                             const std::string& dest_path,
+                             const std::vector<uint32_t>& host_ids,
+                             uint32_t fanout);
+  bool GetDistributionStatus(uint32_t job_id, std::string& out_status);
+
+  uint32_t StartExec(uint32_t app_client_id,
+                     const std::string& command,
+                     const std::vector<uint32_t>& host_ids,
+                     uint32_t timeout_ms);
+
 protected:
   void HandleFileTransferInit(std::shared_ptr<Client> client, std::shared_ptr<Data> data) override;
 
 private:
   uint32_t NextId();
   void HandleClientInfo(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void ScheduleRegistrations();
+  void ProcessRegistrations();
   void HandleTerminalCreated(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
   void HandleTerminalRead(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void QueueReadAck(std::shared_ptr<Client> client);
+  uint32_t TakeReadAcks(uint32_t remote_host_id);
+  void FlushReadAcks();
+  void SendReadAck(std::shared_ptr<Client> client, uint32_t count);
+  void HandleLinkCompression(std::shared_ptr<Client> client);
+  std::shared_ptr<Data> InflateTerminalRead(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
   void HandleTerminalEnd(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void HandleTerminalWriteState(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void HandleTerminalResume(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  bool IsTerminalIdUsed(uint32_t terminal_id, TerminalInfo& out_info);
+  bool TakeOverTerminal(uint32_t terminal_id, TerminalInfo& out_info);
+  bool AddOrphanedTerminal(uint32_t remote_host_id, uint32_t terminal_id, uint64_t start_offset, const std::string& owner_key);
+  void ExpireOrphanedTerminal(uint32_t terminal_id);
   void HandlePingMessage(std::shared_ptr<Client> client);
+  void HandlePongMessage(std::shared_ptr<Client> client);
+  void HandleDirectoryListing(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void HandleDistributionJoin(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void HandleDistributionMsg(std::shared_ptr<Client> client, MessageType::Type type, std::shared_ptr<Data> msg_data);
+  std::shared_ptr<DistributionJob> GetDistribution(uint32_t job_id);
+  void PrepareDistribution(std::shared_ptr<DistributionJob> job);
+  void QueueExecTasks(std::vector<ExecTask> tasks);
+  void DispatchExecTasks();
+  void HandleExecOutput(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void HandleExecEnd(std::shared_ptr<Client> client, std::shared_ptr<Data> msg_data);
+  void OnExecTimeout(uint32_t exec_id, uint32_t remote_host_id);
+  void FinishExecTask(uint32_t exec_id, uint32_t remote_host_id, int32_t exit_code, uint8_t flags);
 
   bool GetAppClinetId(uint32_t remote_host_id, uint32_t terminal_id, uint32_t& out_app_client_id);
 
   std::shared_ptr<WebAppServer> _webapp_server;
   std::map<uint32_t, RemoteHost> _remote_hosts;
+  std::map<uint32_t, DetachedTerminal> _detached_terminals; // terminals of hosts that lost the link
+  std::map<uint32_t, std::chrono::steady_clock::time_point> _orphan_times; // resumed after a restart, by terminal_id
   static std::atomic<uint32_t> _id_counter;
+  uint32_t _instance_id; // tells resuming hosts' terminals created before a restart apart
   std::shared_ptr<ThreadLoop> _thread;
   std::shared_ptr<Server> _proxy_server; 
+  std::mutex _ping_mutex;
+  std::map<uint32_t, std::chrono::steady_clock::time_point> _ping_times;
+  std::mutex _read_ack_mutex;
+  std::map<uint32_t, uint32_t> _pending_read_acks; // unacked ON_TERMINAL_READs by remote host id
+  bool _read_ack_scheduled;
+  std::mutex _link_mutex;
+  std::map<uint32_t, std::shared_ptr<StreamDecompressor>> _link_decompressors; // by remote host id
+  std::mutex _distribution_mutex;
+  std::map<uint32_t, std::shared_ptr<DistributionJob>> _distributions;
+  std::map<uint32_t, std::set<uint32_t>> _terminal_groups; // group_id, remote_host_ids
+  size_t _exec_max_active;
+  std::deque<ExecTask> _exec_queue;
+  std::map<std::pair<uint32_t, uint32_t>, ExecTask> _exec_running;
+  std::shared_ptr<RateLimiter> _accept_limiter;
+  std::shared_ptr<LivenessMonitor> _liveness;
+  std::atomic<uint32_t> _rejected_connections;
+  std::map<uint32_t, PendingRegistration> _pending_registrations;
+  std::deque<uint32_t> _registration_order;
+  bool _registration_scheduled;
 };
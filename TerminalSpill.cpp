@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "TerminalSpill.h"
+
+#include <algorithm>
+
+
+TerminalSpill::TerminalSpill(size_t max_size)
+    : _max_size(max_size)
+    , _start_offset(0)
+    , _dropped_bytes(0) {
+}
+
+void TerminalSpill::Append(const unsigned char* data, size_t size) {
+  _buffer.append((const char*)data, size);
+  if(_buffer.size() > _max_size) {
+    size_t overflow = _buffer.size() - _max_size;
+    _buffer.erase(0, overflow);
+    _start_offset += overflow;
+    _dropped_bytes += overflow;
+  }
+}
+
+void TerminalSpill::Ack(uint64_t offset) {
+  if(offset <= _start_offset) {
+    return;
+  }
+  size_t acked = (size_t)std::min<uint64_t>(offset - _start_offset, _buffer.size());
+  _buffer.erase(0, acked);
+  _start_offset += acked;
+}
+
+void TerminalSpill::Compact() {
+  // acked output only moves the start, the capacity of the largest burst stays allocated
+  _buffer.shrink_to_fit();
+}
+
+size_t TerminalSpill::Read(uint64_t offset, size_t max_size, std::string& out_data) {
+  offset = std::max(offset, _start_offset);
+  if(offset >= GetEndOffset()) {
+    out_data.clear();
+    return 0;
+  }
+  out_data = _buffer.substr((size_t)(offset - _start_offset), max_size);
+  return out_data.size();
+}
+
+uint64_t TerminalSpill::GetStartOffset() {
+  return _start_offset;
+}
+
+uint64_t TerminalSpill::GetEndOffset() {
+  return _start_offset + _buffer.size();
+}
+
+uint64_t TerminalSpill::GetDroppedBytes() {
+  return _dropped_bytes;
+}
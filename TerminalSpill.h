@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+ Terminal output the server hasn't acknowledged yet, addressed by absolute byte offsets
+ counted from the terminal's start. Bounded, when full the oldest output is dropped.
+*/
+class TerminalSpill {
+public:
+  TerminalSpill(size_t max_size);
+  void Append(const unsigned char* data, size_t size);
+  void Ack(uint64_t offset);
+  void Compact();
+  size_t Read(uint64_t offset, size_t max_size, std::string& out_data);
+  uint64_t GetStartOffset();
+  uint64_t GetEndOffset();
+  uint64_t GetDroppedBytes();
+
+private:
+  size_t _max_size;
+  std::string _buffer;
+  uint64_t _start_offset;
+  uint64_t _dropped_bytes;
+};
@@ -0,0 +1,120 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+    : _tick(tick)
+    , _start_time(std::chrono::steady_clock::now())
+    , _current_tick(0)
+    , _size(0) {
+}
+
+void TimerWheel::Schedule(uint64_t id, std::chrono::milliseconds delay) {
+  uint64_t ticks = std::max<int64_t>(1, (delay.count() + _tick.count() - 1) / _tick.count());
+  auto it = _entries.find(id);
+  if(it == _entries.end()) {
+    _spare.push_back(id);
+    it = _entries.insert({id, {0, EXPIRED, 0, std::prev(_spare.end())}}).first;
+  }
+  Entry& entry = it->second;
+  if(entry._level == EXPIRED) {
+    _size++;
+  }
+  entry._expiry_tick = _current_tick + ticks;
+  Insert(entry);
+}
+
+void TimerWheel::Cancel(uint64_t id) {
+  auto it = _entries.find(id);
+  if(it == _entries.end()) {
+    return;
+  }
+  if(it->second._level != EXPIRED) {
+    _size--;
+  }
+  _spare.splice(_spare.end(), Owner(it->second), it->second._position);
+  _spare.pop_back();
+  _entries.erase(it);
+}
+
+void TimerWheel::Advance(std::chrono::steady_clock::time_point now, std::vector<uint64_t>& out_expired) {
+  uint64_t target_tick = (uint64_t)std::max<int64_t>(0, (now - _start_time) / _tick);
+  while(_current_tick < target_tick) {
+    _current_tick++;
+    // refill the finer levels before expiring, a cascaded entry may be due right now
+    for(size_t level = 1; level < LEVELS; ++level) {
+      if(_current_tick & ((1ull << (SLOT_BITS * level)) - 1)) {
+        break;
+      }
+      Cascade(level);
+    }
+
+    // expired entries keep their node in _spare, rescheduling them allocates nothing
+    std::list<uint64_t>& slot = _slots[0][_current_tick & (SLOTS - 1)];
+    for(uint64_t id : slot) {
+      out_expired.push_back(id);
+      _entries[id]._level = EXPIRED;
+    }
+    _size -= slot.size();
+    _spare.splice(_spare.end(), slot);
+  }
+}
+
+size_t TimerWheel::GetSize() {
+  return _size;
+}
+
+std::list<uint64_t>& TimerWheel::Owner(Entry& entry) {
+  if(entry._level == EXPIRED) {
+    return _spare;
+  }
+  return _slots[entry._level][entry._slot];
+}
+
+void TimerWheel::Insert(Entry& entry) {
+  std::list<uint64_t>& owner = Owner(entry);
+  uint64_t delta = entry._expiry_tick > _current_tick ? entry._expiry_tick - _current_tick : 0;
+  size_t level = 0;
+  while(level < LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1)))) {
+    level++;
+  }
+  // beyond the last level the entry waits in its farthest slot and is placed again from there,
+  // an entry cascaded on its very tick lands in the slot expired next
+  uint64_t expiry_tick = std::min<uint64_t>(_current_tick + delta, _current_tick + (1ull << (SLOT_BITS * LEVELS)) - 1);
+  entry._level = level;
+  entry._slot = (expiry_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+  std::list<uint64_t>& slot = _slots[level][entry._slot];
+  slot.splice(slot.end(), owner, entry._position);
+}
+
+void TimerWheel::Cascade(size_t level) {
+  std::list<uint64_t>& slot = _slots[level][(_current_tick >> (SLOT_BITS * level)) & (SLOTS - 1)];
+  for(size_t count = slot.size(); count > 0; --count) {
+    Insert(_entries[slot.front()]);
+  }
+}
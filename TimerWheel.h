@@ -0,0 +1,72 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/*
+ Hierarchical timer wheel, 4 levels of 64 slots. Scheduling, cancelling and each tick are O(1)
+ no matter how many timers are pending; entries move to a finer level when their slot comes up.
+ Not thread safe, the owner serializes access.
+*/
+class TimerWheel {
+public:
+  TimerWheel(std::chrono::milliseconds tick);
+  void Schedule(uint64_t id, std::chrono::milliseconds delay);
+  void Cancel(uint64_t id);
+  void Advance(std::chrono::steady_clock::time_point now, std::vector<uint64_t>& out_expired);
+  size_t GetSize();
+
+private:
+  static const size_t LEVELS = 4;
+  static const size_t SLOT_BITS = 6;
+  static const size_t SLOTS = 1 << SLOT_BITS;
+  static const size_t EXPIRED = LEVELS;
+
+  struct Entry {
+    uint64_t _expiry_tick;
+    size_t _level;
+    size_t _slot;
+    std::list<uint64_t>::iterator _position;
+  };
+
+  std::list<uint64_t>& Owner(Entry& entry);
+  void Insert(Entry& entry);
+  void Cascade(size_t level);
+
+  std::chrono::milliseconds _tick;
+  std::chrono::steady_clock::time_point _start_time;
+  uint64_t _current_tick;
+  size_t _size;
+  std::array<std::array<std::list<uint64_t>, SLOTS>, LEVELS> _slots;
+  // nodes of expired entries, moved back into a slot when rescheduled
+  std::list<uint64_t> _spare;
+  std::unordered_map<uint64_t, Entry> _entries;
+};
@@ -0,0 +1,309 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TransferScheduler.h"
+#include "TaskTimer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const size_t DEFAULT_MAX_ACTIVE = 8;
+const size_t DEFAULT_MAX_ACTIVE_PER_HOST = 2;
+const uint64_t MIN_BUCKET_BURST = 256 * 1024;
+const uint64_t MIN_BACKOFF_RATE = 64 * 1024;
+const double BACKOFF_DECREASE = 0.7;
+const double BACKOFF_INCREASE = 1.1;
+const std::chrono::microseconds RTT_CONGESTION_MARGIN(20000);
+const std::chrono::microseconds MIN_ADJUST_INTERVAL(100000);
+const std::chrono::microseconds RATE_MEASURE_INTERVAL(500000);
+
+const std::string MAX_ACTIVE_ENV = "TRANSFER_MAX_ACTIVE";
+const std::string MAX_ACTIVE_PER_HOST_ENV = "TRANSFER_MAX_ACTIVE_PER_HOST";
+const std::string TRANSFER_RATE_ENV = "TRANSFER_RATE_LIMIT";
+const std::string HOST_RATE_ENV = "TRANSFER_HOST_RATE_LIMIT";
+const std::string GLOBAL_RATE_ENV = "TRANSFER_GLOBAL_RATE_LIMIT";
+
+uint64_t ReadEnvValue(const std::string& name, uint64_t default_value) {
+  char* value = std::getenv(name.c_str());
+  if(!value) {
+    return default_value;
+  }
+  return std::strtoull(value, nullptr, 10);
+}
+
+uint64_t MinRate(uint64_t first, uint64_t second) {
+  if(!first || !second) {
+    return std::max(first, second);
+  }
+  return std::min(first, second);
+}
+
+}
+
+
+TokenBucket::TokenBucket()
+    : _rate(0)
+    , _tokens(0)
+    , _burst(0)
+    , _last_refill(std::chrono::steady_clock::now()) {
+}
+
+void TokenBucket::SetRate(uint64_t bytes_per_sec) {
+  Refill();
+  bool was_unlimited = !_rate;
+  _rate = bytes_per_sec;
+  _burst = (double)std::max(MIN_BUCKET_BURST, _rate / 4);
+  _tokens = was_unlimited ? _burst : std::min(_tokens, _burst);
+}
+
+uint64_t TokenBucket::GetRate() {
+  return _rate;
+}
+
+void TokenBucket::Consume(uint64_t size) {
+  if(!_rate) {
+    return;
+  }
+  Refill();
+  _tokens -= (double)size;
+}
+
+std::chrono::microseconds TokenBucket::GetDelay() {
+  if(!_rate) {
+    return std::chrono::microseconds(0);
+  }
+  Refill();
+  if(_tokens >= 0) {
+    return std::chrono::microseconds(0);
+  }
+  return std::chrono::microseconds((int64_t)(-_tokens * 1000000 / _rate) + 1);
+}
+
+void TokenBucket::Refill() {
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - _last_refill).count();
+  _last_refill = now;
+  _tokens = std::min(_burst, _tokens + elapsed * _rate);
+}
+
+
+TransferScheduler::TransferScheduler(std::shared_ptr<TaskTimer> timer)
+    : _timer(timer)
+    , _max_active(ReadEnvValue(MAX_ACTIVE_ENV, DEFAULT_MAX_ACTIVE))
+    , _max_active_per_host(ReadEnvValue(MAX_ACTIVE_PER_HOST_ENV, DEFAULT_MAX_ACTIVE_PER_HOST))
+    , _transfer_rate(ReadEnvValue(TRANSFER_RATE_ENV, 0))
+    , _host_rate(ReadEnvValue(HOST_RATE_ENV, 0)) {
+  _global_bucket.SetRate(ReadEnvValue(GLOBAL_RATE_ENV, 0));
+}
+
+void TransferScheduler::StartTransfer(uint32_t host_id, uint32_t transfer_id, std::function<void()> start) {
+  std::vector<std::function<void()>> to_start;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& host = _hosts[host_id];
+    host._pending.push_back(std::make_pair(transfer_id, start));
+    CollectStartable(to_start);
+    if(!host._pending.empty()) {
+      DLOG(info, "TransferScheduler : transfer {} for host {} queued, {} waiting", transfer_id, host_id, host._pending.size());
+    }
+  }
+  for(auto& task : to_start) {
+    task();
+  }
+}
+
+void TransferScheduler::FinishTransfer(uint32_t host_id, uint32_t transfer_id) {
+  std::vector<std::function<void()>> to_start;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _transfer_buckets.erase(transfer_id);
+    auto it = _hosts.find(host_id);
+    if(it == _hosts.end()) {
+      return;
+    }
+    it->second._active.erase(transfer_id);
+    CollectStartable(to_start);
+  }
+  for(auto& task : to_start) {
+    task();
+  }
+}
+
+void TransferScheduler::RemoveHost(uint32_t host_id, std::vector<uint32_t>& out_pending) {
+  std::vector<std::function<void()>> to_start;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _hosts.find(host_id);
+    if(it == _hosts.end()) {
+      return;
+    }
+    for(auto transfer_id : it->second._active) {
+      _transfer_buckets.erase(transfer_id);
+    }
+    // queued transfers never started, their owners have to fail them
+    for(auto& pending : it->second._pending) {
+      out_pending.push_back(pending.first);
+    }
+    _hosts.erase(it);
+    CollectStartable(to_start);
+  }
+  for(auto& task : to_start) {
+    task();
+  }
+}
+
+std::chrono::microseconds TransferScheduler::GetDelay(uint32_t host_id, uint32_t transfer_id) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto delay = _global_bucket.GetDelay();
+
+  auto host_it = _hosts.find(host_id);
+  if(host_it != _hosts.end()) {
+    delay = std::max(delay, host_it->second._bucket.GetDelay());
+  }
+
+  auto transfer_it = _transfer_buckets.find(transfer_id);
+  if(transfer_it != _transfer_buckets.end()) {
+    delay = std::max(delay, transfer_it->second.GetDelay());
+  }
+  return delay;
+}
+
+void TransferScheduler::OnDataTransferred(uint32_t host_id, uint32_t transfer_id, uint32_t size) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _global_bucket.Consume(size);
+
+  auto transfer_it = _transfer_buckets.find(transfer_id);
+  if(transfer_it == _transfer_buckets.end() && _transfer_rate) {
+    transfer_it = _transfer_buckets.insert(std::make_pair(transfer_id, TokenBucket())).first;
+    transfer_it->second.SetRate(_transfer_rate);
+  }
+  if(transfer_it != _transfer_buckets.end()) {
+    transfer_it->second.Consume(size);
+  }
+
+  auto& host = _hosts[host_id];
+  host._bucket.Consume(size);
+
+  auto now = std::chrono::steady_clock::now();
+  if(!host._measured_bytes) {
+    host._measure_start = now;
+  }
+  host._measured_bytes += size;
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - host._measure_start);
+  if(elapsed >= RATE_MEASURE_INTERVAL) {
+    uint64_t rate = host._measured_bytes * 1000000 / (uint64_t)elapsed.count();
+    host._measured_rate = host._measured_rate ? (host._measured_rate * 3 + rate) / 4 : rate;
+    host._measured_bytes = 0;
+  }
+}
+
+void TransferScheduler::OnRttSample(uint32_t host_id, std::chrono::microseconds rtt) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto& host = _hosts[host_id];
+  bool congested = host._min_rtt.count() && rtt > host._min_rtt * 2 + RTT_CONGESTION_MARGIN;
+
+  if(!host._min_rtt.count() || rtt < host._min_rtt) {
+    host._min_rtt = rtt;
+  } else {
+    // let the baseline follow a route change slowly
+    host._min_rtt += (rtt - host._min_rtt) / 64;
+  }
+  host._srtt = host._srtt.count() ? (host._srtt * 7 + rtt) / 8 : rtt;
+
+  auto now = std::chrono::steady_clock::now();
+  if(host._active.empty() || now - host._last_adjust < std::max(MIN_ADJUST_INTERVAL, host._srtt)) {
+    return;
+  }
+
+  if(congested) {
+    uint64_t base_rate = host._backoff_rate ? host._backoff_rate : host._measured_rate;
+    if(!base_rate) {
+      return;
+    }
+    host._backoff_rate = std::max(MIN_BACKOFF_RATE, (uint64_t)(base_rate * BACKOFF_DECREASE));
+    DLOG(info, "TransferScheduler : host {} rtt {}us (base {}us), bulk rate reduced to {} B/s",
+               host_id, rtt.count(), host._min_rtt.count(), host._backoff_rate);
+  } else if(host._backoff_rate) {
+    host._backoff_rate = (uint64_t)(host._backoff_rate * BACKOFF_INCREASE) + MIN_BACKOFF_RATE;
+    if(host._measured_rate && host._backoff_rate > host._measured_rate * 4) {
+      host._backoff_rate = 0;
+      DLOG(info, "TransferScheduler : host {} rtt recovered, bulk rate limit lifted", host_id);
+    }
+  } else {
+    return;
+  }
+  host._last_adjust = now;
+  UpdateHostRate(host);
+}
+
+void TransferScheduler::Schedule(std::chrono::microseconds delay, std::function<void()> task) {
+  _timer->Schedule(delay, task);
+}
+
+void TransferScheduler::UpdateHostRate(HostState& host) {
+  uint64_t rate = MinRate(_host_rate, host._backoff_rate);
+  if(rate != host._bucket.GetRate()) {
+    host._bucket.SetRate(rate);
+  }
+}
+
+void TransferScheduler::CollectStartable(std::vector<std::function<void()>>& out_start) {
+  size_t active_count = GetActiveCount();
+  bool started = true;
+  // round-robin over hosts so a single busy host doesn't starve others
+  while(started && (!_max_active || active_count < _max_active)) {
+    started = false;
+    for(auto& host_it : _hosts) {
+      auto& host = host_it.second;
+      if(host._pending.empty()) {
+        continue;
+      }
+      if(_max_active_per_host && host._active.size() >= _max_active_per_host) {
+        continue;
+      }
+      if(_max_active && active_count >= _max_active) {
+        break;
+      }
+      if(host._active.empty()) {
+        UpdateHostRate(host);
+      }
+      host._active.insert(host._pending.front().first);
+      out_start.push_back(host._pending.front().second);
+      host._pending.pop_front();
+      active_count++;
+      started = true;
+    }
+  }
+}
+
+size_t TransferScheduler::GetActiveCount() {
+  size_t result = 0;
+  for(auto& host_it : _hosts) {
+    result += host_it.second._active.size();
+  }
+  return result;
+}
@@ -0,0 +1,92 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+class TaskTimer;
+
+class TokenBucket {
+public:
+  TokenBucket();
+  void SetRate(uint64_t bytes_per_sec);
+  uint64_t GetRate();
+  void Consume(uint64_t size);
+  std::chrono::microseconds GetDelay();
+
+private:
+  void Refill();
+
+  uint64_t _rate;
+  double _tokens;
+  double _burst;
+  std::chrono::steady_clock::time_point _last_refill;
+};
+
+class TransferScheduler {
+public:
+  TransferScheduler(std::shared_ptr<TaskTimer> timer);
+  void StartTransfer(uint32_t host_id, uint32_t transfer_id, std::function<void()> start);
+  void FinishTransfer(uint32_t host_id, uint32_t transfer_id);
+  void RemoveHost(uint32_t host_id, std::vector<uint32_t>& out_pending);
+  std::chrono::microseconds GetDelay(uint32_t host_id, uint32_t transfer_id);
+  void OnDataTransferred(uint32_t host_id, uint32_t transfer_id, uint32_t size);
+  void OnRttSample(uint32_t host_id, std::chrono::microseconds rtt);
+  void Schedule(std::chrono::microseconds delay, std::function<void()> task);
+
+private:
+  struct HostState {
+    std::set<uint32_t> _active;
+    std::deque<std::pair<uint32_t, std::function<void()>>> _pending;
+    TokenBucket _bucket;
+    uint64_t _backoff_rate = 0;
+    uint64_t _measured_rate = 0;
+    uint64_t _measured_bytes = 0;
+    std::chrono::steady_clock::time_point _measure_start;
+    std::chrono::steady_clock::time_point _last_adjust;
+    std::chrono::microseconds _min_rtt{0};
+    std::chrono::microseconds _srtt{0};
+  };
+
+  void UpdateHostRate(HostState& host);
+  void CollectStartable(std::vector<std::function<void()>>& out_start);
+  size_t GetActiveCount();
+
+  std::mutex _mutex;
+  std::map<uint32_t, HostState> _hosts;
+  std::map<uint32_t, TokenBucket> _transfer_buckets;
+  TokenBucket _global_bucket;
+  std::shared_ptr<TaskTimer> _timer;
+  size_t _max_active;
+  size_t _max_active_per_host;
+  uint64_t _transfer_rate;
+  uint64_t _host_rate;
+};
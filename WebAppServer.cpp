@@ -23,6 +23,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 #include "WebAppServer.h"
+#include "DownloadCache.h"
 #include "Message.h"
 #include "MimeTypeFinder.h"
 #include "WebsocketMessage.h"
@@ -36,16 +37,36 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "JsonMsg.h"
 #include "DataResource.h"
 #include "Data.h"
-#include "DirectoryListing.h"
 #include "SimpleMessage.h"
+#include "MessageType.h"
 
-
+#include <algorithm>
 #include <sstream>
 #include <vector>
 
+const int DEFAULT_EXEC_TIMEOUT_MS = 30000;
+
+
+static std::shared_ptr<Message> MakeHttpChunk(std::shared_ptr<Data> data) {
+  std::stringstream chunk_size;
+  chunk_size << std::hex << data->GetCurrentSize() << "\r\n";
+  auto chunk = std::make_shared<Data>();
+  chunk->Add(chunk_size.str());
+  chunk->Add(data->GetCurrentSize(), data->GetCurrentDataRaw());
+  chunk->Add("\r\n");
+  return std::make_shared<Message>(chunk);
+}
+
+static bool IsChunkedResponse(std::shared_ptr<FileTransfer> file_transfer) {
+  return file_transfer->IsGzipEncoded() || file_transfer->IsArchive();
+}
+
 
-WebAppServer::WebAppServer(std::shared_ptr<TerminalServer> term_proxy, bool listen_all_src)
+WebAppServer::WebAppServer(std::shared_ptr<TerminalServer> term_proxy,
+                           bool listen_all_src,
+                           std::shared_ptr<DownloadCache> download_cache)
     : _term_server(term_proxy)
+    , _download_cache(download_cache)
     , _listen_all_src(listen_all_src) {
   _thread_loop = std::make_shared<ThreadLoop>();
   _thread_loop->Init();
@@ -82,7 +103,22 @@ void WebAppServer::PerpareHTTPGetResponse(HttpRequest& request) {
   }
 
   if(!name.rfind("download?", 0)) {
-    PerpareFileDownloadResponse(request);
+    PerpareFileDownloadResponse(request, false);
+    return;
+  }
+
+  if(!name.rfind("archive?", 0)) {
+    PerpareFileDownloadResponse(request, true);
+    return;
+  }
+
+  if(!name.rfind("distribute?", 0)) {
+    PerpareDistributionStartResponse(request);
+    return;
+  }
+
+  if(!name.rfind("distribution?", 0)) {
+    PerpareDistributionStatusResponse(request);
     return;
   }
 
@@ -95,7 +131,7 @@ void WebAppServer::PerpareHTTPGetResponse(HttpRequest& request) {
   request._response_msg->GetHeader()->SetField(HttpHeaderField::CONTENT_TYPE, MimeTypeFinder::Find(name));
 }
 
-void WebAppServer::PerpareFileDownloadResponse(HttpRequest& http_request) {
+void WebAppServer::PerpareFileDownloadResponse(HttpRequest& http_request, bool is_archive) {
   int terminal_id = -1;
   uint32_t remote_host_id = 0;
   std::string path;
@@ -106,7 +142,7 @@ void WebAppServer::PerpareFileDownloadResponse(HttpRequest& http_request) {
     return;
   }
 
-  auto args_split = StringUtils::Split(target,"download?", 2);
+  auto args_split = StringUtils::Split(target, is_archive ? "archive?" : "download?", 2);
   if(args_split.size() != 2) {
     return;
   }
@@ -128,8 +164,20 @@ void WebAppServer::PerpareFileDownloadResponse(HttpRequest& http_request) {
 
   path = host_path_split.at(1);
 
+  uint8_t flags = is_archive ? FileTransfer::Flags::ARCHIVE : FileTransfer::Flags::NONE;
+  std::string cache_key;
+  std::string accept_encoding;
+  auto host_it = _active_remote_hosts.find(remote_host_id);
+  if(_download_cache && !is_archive && host_it != _active_remote_hosts.end()) {
+    flags |= FileTransfer::Flags::DELTA;
+    cache_key = _download_cache->MakeKey(host_it->second._client_user_name + "@" + host_it->second._client_name, path);
+  } else if(http_request._request_msg->GetHeader()->GetField(HttpHeaderField::ACCEPT_ENCODING, accept_encoding) &&
+            accept_encoding.find("gzip") != std::string::npos) {
+    flags |= FileTransfer::Flags::GZIP;
+  }
+
   auto file_session = _sessions.CreateFileTransferSession(web_client);
-  auto file_request = _term_server->CreateFileRequest(remote_host_id, file_session->GetId(), path, true);
+  auto file_request = _term_server->CreateFileRequest(remote_host_id, file_session->GetId(), path, true, flags, _download_cache, cache_key);
 
   if(!file_request) {
     log()->error("WebAppServer::PerpareFileDownloadResponse failed");
@@ -141,6 +189,51 @@ void WebAppServer::PerpareFileDownloadResponse(HttpRequest& http_request) {
   http_request._handled = true;
 }
 
+void WebAppServer::PerpareDistributionStartResponse(HttpRequest& http_request) {
+  int fanout = 0;
+  std::string target = http_request._request_msg->GetHeader()->GetRequestTarget();
+  http_request._response_msg = std::make_shared<HttpMessage>(400);
+
+  // distribute?<fanout>&<destination path>&<source path on server>
+  auto args_split = StringUtils::Split(target, "distribute?", 2);
+  if(args_split.size() != 2) {
+    return;
+  }
+  auto params_split = StringUtils::Split(args_split.at(1), "&", 3);
+  if(params_split.size() != 3 || !StringUtils::ToInt(params_split.at(0), fanout) || fanout < 1) {
+    log()->error("WebAppServer::PerpareDistributionStartResponse : invalid request");
+    return;
+  }
+
+  std::vector<uint32_t> host_ids;
+  for(auto& remote_host : _active_remote_hosts) {
+    host_ids.push_back(remote_host.first);
+  }
+
+  uint32_t job_id = _term_server->StartDistribution(params_split.at(2), params_split.at(1), host_ids, (uint32_t)fanout);
+  if(!job_id) {
+    return;
+  }
+  http_request._response_msg = std::make_shared<HttpMessage>(200, JsonMsg::MakeDistributionStartedMsg(job_id));
+  http_request._response_msg->GetHeader()->SetField(HttpHeaderField::CONTENT_TYPE, "application/json");
+}
+
+void WebAppServer::PerpareDistributionStatusResponse(HttpRequest& http_request) {
+  int job_id = 0;
+  std::string status;
+  std::string target = http_request._request_msg->GetHeader()->GetRequestTarget();
+
+  auto args_split = StringUtils::Split(target, "distribution?", 2);
+  if(args_split.size() != 2 ||
+     !StringUtils::ToInt(args_split.at(1), job_id) ||
+     !_term_server->GetDistributionStatus((uint32_t)job_id, status)) {
+    http_request._response_msg = std::make_shared<HttpMessage>(404);
+    return;
+  }
+  http_request._response_msg = std::make_shared<HttpMessage>(200, status);
+  http_request._response_msg->GetHeader()->SetField(HttpHeaderField::CONTENT_TYPE, "application/json");
+}
+
 
 bool WebAppServer::OnWsClientConnected(std::shared_ptr<Client> client, const std::string& request_arg) {
   AddClient(client);
@@ -164,6 +257,12 @@ void WebAppServer::OnWsClientMessage(std::shared_ptr<Client> client, std::shared
       case JsonMsg::Type::TERMINAL_ADD:
         OnTerminalAddReq(client, json.ValueToInt("remote_host_id"));
         break;
+      case JsonMsg::Type::OWNER_KEY:
+        OnOwnerKeyReq(client, json.ValueToString("key"));
+        break;
+      case JsonMsg::Type::TERMINAL_REATTACH:
+        OnTerminalReattachReq(client, json.ValueToInt("remote_host_id"), json.ValueToInt("terminal_id"));
+        break;
       case JsonMsg::Type::TERMINAL_RESIZE:
         OnTerminalResizeReq(client,
                             json.ValueToInt("terminal_id"),
@@ -177,8 +276,28 @@ void WebAppServer::OnWsClientMessage(std::shared_ptr<Client> client, std::shared
         OnTerminalKeyEvent(client, json.ValueToInt("terminal_id"), json.ValueToString("key"));
         break;
       case JsonMsg::Type::FILE_TRANSFER_REQ:
-        OnTerminalFileReq(client, json.ValueToInt("terminal_id"),
-                                  json.ValueToString("path"));
+        OnTerminalFileReq(client, json.ValueToInt("terminal_id"), json.ToListingOptions());
+        break;
+      case JsonMsg::Type::TERMINAL_VIEW_REQ:
+        OnTerminalViewReq(client, json.ValueToInt("terminal_id"));
+        break;
+      case JsonMsg::Type::TERMINAL_VIEW_DEL:
+        OnTerminalViewDelReq(client, json.ValueToInt("terminal_id"));
+        break;
+      case JsonMsg::Type::TERMINAL_VIEW_ACK:
+        OnTerminalViewAck(client, json.ValueToInt("terminal_id"), json.ValueToInt("bytes"));
+        break;
+      case JsonMsg::Type::TERMINAL_GROUP_SET:
+        OnTerminalGroupSetReq(client, json.ValueToInt("group_id"), json.ValueToIdList("terminal_ids"));
+        break;
+      case JsonMsg::Type::TERMINAL_GROUP_DEL:
+        OnTerminalGroupDelReq(client, json.ValueToInt("group_id"));
+        break;
+      case JsonMsg::Type::TERMINAL_GROUP_KEY_EVENT:
+        OnTerminalGroupKeyEvent(client, json.ValueToInt("group_id"), json.ValueToString("key"));
+        break;
+      case JsonMsg::Type::EXEC_REQ:
+        OnExecReq(client, json.ValueToString("command"), json.ValueToIdList("host_ids"), json.ValueToInt("timeout"));
         break;
       default:
         break;
@@ -191,7 +310,131 @@ void WebAppServer::OnWsClientClosed(std::shared_ptr<Client> client) {
 }
 
 void WebAppServer::OnTerminalAddReq(std::shared_ptr<Client> client, int remote_host_id) {
-  _term_server->CreateNewTerminal(client->GetId(), remote_host_id);
+  auto session = _sessions.GetWebAppSession(client);
+  if(!session) {
+    return;
+  }
+  _term_server->CreateNewTerminal(client->GetId(), remote_host_id, session->GetOwnerKey());
+}
+
+void WebAppServer::OnOwnerKeyReq(std::shared_ptr<Client> client, const std::string& owner_key) {
+  auto session = _sessions.GetWebAppSession(client);
+  if(!session || !session->GetOwnerKey().empty()) {
+    return;
+  }
+  if(owner_key.size() != MessageType::OWNER_KEY_SIZE || owner_key.find('\0') != std::string::npos) {
+    DLOG(warn, "OnOwnerKeyReq : invalid owner key : client : {}", client->GetId());
+    return;
+  }
+  session->SetOwnerKey(owner_key);
+  // shells of this browser resumed after a server restart are offered to it again
+  _term_server->OfferOrphanedTerminals(owner_key);
+}
+
+void WebAppServer::OnTerminalReattachReq(std::shared_ptr<Client> client, int remote_host_id, int terminal_id) {
+  auto session = _sessions.GetWebAppSession(client);
+  if(!session || session->GetOwnerKey().empty() || remote_host_id <= 0 || terminal_id <= 0) {
+    return;
+  }
+  _term_server->ReattachTerminal(client->GetId(), session->GetOwnerKey(), (uint32_t)remote_host_id, (uint32_t)terminal_id);
+}
+
+void WebAppServer::OnTerminalViewReq(std::shared_ptr<Client> client, int terminal_id) {
+  uint32_t remote_host_id = 0;
+  if(terminal_id <= 0 || !_sessions.AddTerminalViewer(client, (uint32_t)terminal_id, remote_host_id)) {
+    DLOG(warn, "OnTerminalViewReq : can't view terminal : client: {}, terminal: {}", client->GetId(), terminal_id);
+    return;
+  }
+
+  DLOG(info, "OnTerminalViewReq : client id : {}, terminal id : {}", client->GetId(), terminal_id);
+  client->Send(std::make_shared<WebsocketMessage>(JsonMsg::MakeTerminalViewMsg(terminal_id, remote_host_id)));
+}
+
+void WebAppServer::OnTerminalViewDelReq(std::shared_ptr<Client> client, int terminal_id) {
+  if(terminal_id <= 0) {
+    return;
+  }
+  _sessions.RemoveTerminalViewer(client, (uint32_t)terminal_id);
+}
+
+void WebAppServer::OnTerminalViewAck(std::shared_ptr<Client> client, int terminal_id, int bytes) {
+  auto session = _sessions.GetWebAppSession(client);
+  if(!session || terminal_id <= 0 || bytes <= 0) {
+    return;
+  }
+  session->AckViewOutput((uint32_t)terminal_id, (size_t)bytes);
+}
+
+void WebAppServer::SendToTerminalViewers(uint32_t terminal_id, size_t output_size, std::shared_ptr<WebsocketMessage> ws_msg) {
+  std::vector<std::shared_ptr<ActiveSessions::WebAppSession>> viewers;
+  _sessions.GetTerminalViewers(terminal_id, viewers);
+  for(auto& viewer : viewers) {
+    // a viewer that stopped acking only loses its own frames,
+    // the owner and the other viewers keep getting the shared one
+    size_t skipped_bytes = 0;
+    if(!viewer->ReserveViewOutput(terminal_id, output_size, skipped_bytes)) {
+      continue;
+    }
+    if(skipped_bytes) {
+      auto json_msg = JsonMsg::MakeTerminalViewSkippedMsg(terminal_id, skipped_bytes);
+      viewer->GetClient()->Send(std::make_shared<WebsocketMessage>(json_msg));
+    }
+    viewer->GetClient()->Send(ws_msg);
+  }
+}
+
+void WebAppServer::OnTerminalGroupSetReq(std::shared_ptr<Client> client, int group_id, const std::vector<uint32_t>& terminal_ids) {
+  auto session = _sessions.GetWebAppSession(client);
+  if(!session) {
+    return;
+  }
+
+  uint32_t result_id = session->SetTerminalGroup((uint32_t)std::max(0, group_id), terminal_ids);
+  if(!result_id) {
+    DLOG(warn, "OnTerminalGroupSetReq : invalid group : {}", group_id);
+    return;
+  }
+
+  auto terminals_by_host = session->GetTerminalGroupByHost(result_id);
+  std::vector<uint32_t> group_terminals;
+  for(auto& host_terminals : terminals_by_host) {
+    group_terminals.insert(group_terminals.end(), host_terminals.second.begin(), host_terminals.second.end());
+  }
+  _term_server->SetTerminalGroup(result_id, terminals_by_host);
+  client->Send(std::make_shared<WebsocketMessage>(JsonMsg::MakeTerminalGroupMsg(result_id, group_terminals)));
+}
+
+void WebAppServer::OnTerminalGroupDelReq(std::shared_ptr<Client> client, int group_id) {
+  auto session = _sessions.GetWebAppSession(client);
+  if(!session || group_id <= 0 || !session->DeleteTerminalGroup((uint32_t)group_id)) {
+    return;
+  }
+  _term_server->SetTerminalGroup((uint32_t)group_id, {});
+}
+
+void WebAppServer::OnTerminalGroupKeyEvent(std::shared_ptr<Client> client, int group_id, const std::string& key) {
+  auto session = _sessions.GetWebAppSession(client);
+  if(!session || group_id <= 0 || !session->HasTerminalGroup((uint32_t)group_id)) {
+    return;
+  }
+  _term_server->BroadcastKeyEvent((uint32_t)group_id, key);
+}
+
+void WebAppServer::OnExecReq(std::shared_ptr<Client> client, const std::string& command, std::vector<uint32_t> host_ids, int timeout_ms) {
+  if(command.empty()) {
+    return;
+  }
+  if(host_ids.empty()) {
+    for(auto& remote_host : _active_remote_hosts) {
+      host_ids.push_back(remote_host.first);
+    }
+  }
+  if(timeout_ms <= 0) {
+    timeout_ms = DEFAULT_EXEC_TIMEOUT_MS;
+  }
+
+  uint32_t exec_id = _term_server->StartExec(client->GetId(), command, host_ids, (uint32_t)timeout_ms);
+  client->Send(std::make_shared<WebsocketMessage>(JsonMsg::MakeExecStartedMsg(exec_id, command, host_ids)));
 }
 
 void WebAppServer::OnTerminalResizeReq(std::shared_ptr<Client> client,
@@ -250,23 +493,16 @@ void WebAppServer::OnTerminalKeyEvent(std::shared_ptr<Client> client, int termin
 }
 
 
-void WebAppServer::OnRemoteHostInfoReceived(uint32_t host_id,
-                                            const std::string& ip,
-                                            const std::string& user_name,
-                                            const std::string& host_name) {
+void WebAppServer::OnRemoteHostsInfoReceived(std::map<uint32_t, RemoteHostInfo> remote_hosts) {
   if(_thread_loop->OnDifferentThread()) {
-    _thread_loop->Post(std::bind(&WebAppServer::OnRemoteHostInfoReceived,
-                                 shared_from_this(),
-                                 host_id,
-                                 ip,
-                                 user_name,
-                                 host_name));
+    _thread_loop->Post(std::bind(&WebAppServer::OnRemoteHostsInfoReceived, shared_from_this(), remote_hosts));
     return;
   }
-  log()->info("OnRemoteHostInfoReceived - host : {}", host_id);
-  _active_remote_hosts.insert(std::make_pair(host_id, RemoteHostInfo{ip, user_name, host_name}));
+  log()->info("OnRemoteHostsInfoReceived - hosts : {}", remote_hosts.size());
+  _active_remote_hosts.insert(remote_hosts.begin(), remote_hosts.end());
 
-  auto json_msg = JsonMsg::MakeRemoteHostConnectedMsg((int)host_id, ip, user_name, host_name);
+  // one message per browser for the whole batch of registrations
+  auto json_msg = JsonMsg::MakeRemoteHostsConnectedMsg(remote_hosts);
   auto ws_msg = std::make_shared<WebsocketMessage>(json_msg);
 
   std::vector<std::shared_ptr<ActiveSessions::WebAppSession>> vec;
@@ -282,7 +518,10 @@ void WebAppServer::OnTerminalClientClosed(uint32_t proxy_client_id) {
     return;
   }
 
-  _active_remote_hosts.erase(proxy_client_id);
+  // idle pooled data connections close here too, they were never announced
+  if(!_active_remote_hosts.erase(proxy_client_id)) {
+    return;
+  }
 
   auto json_msg =JsonMsg::MakeClientDisconnectedMsg(proxy_client_id);
   auto ws_msg = std::make_shared<WebsocketMessage>(json_msg);
@@ -319,6 +558,27 @@ void WebAppServer::OnTerminalCreated(uint32_t client_id, uint32_t terminal_id, u
   session->GetClient()->Send(ws_msg);
 }
 
+void WebAppServer::OnTerminalResumed(uint32_t client_id, uint32_t terminal_id, uint32_t remote_host_id, uint64_t offset) {
+  if(_thread_loop->OnDifferentThread()) {
+    _thread_loop->Post(std::bind(&WebAppServer::OnTerminalResumed, shared_from_this(), client_id, terminal_id, remote_host_id, offset));
+    return;
+  }
+
+  auto session = _sessions.GetWebAppSession(client_id);
+  if(!session) {
+    // the owner left during the outage, its terminals would have been deleted
+    DLOG(info, "OnTerminalResumed : owner gone, deleting terminal : {}", terminal_id);
+    _term_server->DeleteTerminal((int)remote_host_id, (int)terminal_id);
+    return;
+  }
+
+  DLOG(info, "OnTerminalResumed : client : {}, terminal : {}, remote_host_id : {}", client_id, terminal_id, remote_host_id);
+  session->AddTerminal(terminal_id, remote_host_id);
+  session->GetClient()->Send(std::make_shared<WebsocketMessage>(JsonMsg::MakeTerminalCreatedMsg((int)remote_host_id, (int)terminal_id)));
+  // output missed during the outage follows the terminal_added message
+  _term_server->ResyncTerminal(remote_host_id, terminal_id, offset);
+}
+
 void WebAppServer::OnTerminalOutput(uint32_t client_id, uint32_t terminal_id, std::shared_ptr<Data> output) {
   if(_thread_loop->OnDifferentThread()) {
     _thread_loop->Post(std::bind(&WebAppServer::OnTerminalOutput, shared_from_this(), client_id, terminal_id, output));
@@ -334,6 +594,35 @@ void WebAppServer::OnTerminalOutput(uint32_t client_id, uint32_t terminal_id, st
   std::string json_msg = JsonMsg::MakeTerminalOutputMsg(terminal_id, output);
   auto ws_msg = std::make_shared<WebsocketMessage>(json_msg);
   session->GetClient()->Send(ws_msg);
+  SendToTerminalViewers(terminal_id, output->GetCurrentSize(), ws_msg);
+}
+
+void WebAppServer::OnExecOutput(uint32_t client_id, uint32_t exec_id, uint32_t remote_host_id, uint8_t stream, std::shared_ptr<Data> output) {
+  if(_thread_loop->OnDifferentThread()) {
+    _thread_loop->Post(std::bind(&WebAppServer::OnExecOutput, shared_from_this(), client_id, exec_id, remote_host_id, stream, output));
+    return;
+  }
+
+  auto session = _sessions.GetWebAppSession(client_id);
+  if(!session) {
+    return;
+  }
+  std::string json_msg = JsonMsg::MakeExecOutputMsg(exec_id, remote_host_id, stream, output);
+  session->GetClient()->Send(std::make_shared<WebsocketMessage>(json_msg));
+}
+
+void WebAppServer::OnExecEnd(uint32_t client_id, uint32_t exec_id, uint32_t remote_host_id, int32_t exit_code, uint8_t flags) {
+  if(_thread_loop->OnDifferentThread()) {
+    _thread_loop->Post(std::bind(&WebAppServer::OnExecEnd, shared_from_this(), client_id, exec_id, remote_host_id, exit_code, flags));
+    return;
+  }
+
+  auto session = _sessions.GetWebAppSession(client_id);
+  if(!session) {
+    return;
+  }
+  std::string json_msg = JsonMsg::MakeExecEndMsg(exec_id, remote_host_id, exit_code, flags);
+  session->GetClient()->Send(std::make_shared<WebsocketMessage>(json_msg));
 }
 
 void WebAppServer::OnTerminalClosed(uint32_t client_id, uint32_t terminal_id, uint32_t remote_host_id) {
@@ -351,6 +640,42 @@ void WebAppServer::OnTerminalClosed(uint32_t client_id, uint32_t terminal_id, ui
   auto json_msg = JsonMsg::MakeTerminalClosed(terminal_id, remote_host_id);
   auto ws_msg = std::make_shared<WebsocketMessage>(json_msg);
   session->GetClient()->Send(ws_msg);
+
+  std::vector<std::shared_ptr<ActiveSessions::WebAppSession>> viewers;
+  _sessions.EraseTerminalViewers(terminal_id, viewers);
+  for(auto& viewer : viewers) {
+    viewer->GetClient()->Send(ws_msg);
+  }
+}
+
+void WebAppServer::OnTerminalsOrphaned(const std::string& owner_key, uint32_t remote_host_id, std::vector<uint32_t> terminal_ids) {
+  if(_thread_loop->OnDifferentThread()) {
+    _thread_loop->Post(std::bind(&WebAppServer::OnTerminalsOrphaned, shared_from_this(), owner_key, remote_host_id, terminal_ids));
+    return;
+  }
+
+  auto ws_msg = std::make_shared<WebsocketMessage>(JsonMsg::MakeTerminalOrphansMsg(remote_host_id, terminal_ids));
+  std::vector<std::shared_ptr<ActiveSessions::WebAppSession>> vec;
+  _sessions.GetAllWebAppSessions(vec);
+  for(auto& session : vec) {
+    if(session->GetOwnerKey() == owner_key) {
+      session->GetClient()->Send(ws_msg);
+    }
+  }
+}
+
+void WebAppServer::OnTerminalWriteState(uint32_t client_id, uint32_t terminal_id, bool blocked, uint32_t dropped_bytes) {
+  if(_thread_loop->OnDifferentThread()) {
+    _thread_loop->Post(std::bind(&WebAppServer::OnTerminalWriteState, shared_from_this(), client_id, terminal_id, blocked, dropped_bytes));
+    return;
+  }
+
+  auto session = _sessions.GetWebAppSession(client_id);
+  if(!session) {
+    return;
+  }
+  auto json_msg = JsonMsg::MakeTerminalWriteStateMsg(terminal_id, blocked, dropped_bytes);
+  session->GetClient()->Send(std::make_shared<WebsocketMessage>(json_msg));
 }
 
 void WebAppServer::AddClient(std::shared_ptr<Client> client) {
@@ -360,13 +685,8 @@ void WebAppServer::AddClient(std::shared_ptr<Client> client) {
   }
 
   _sessions.CreateWebAppSession(client);
-  for(auto& term_client : _active_remote_hosts) {
-    auto json_msg = JsonMsg::MakeRemoteHostConnectedMsg((int)term_client.first,
-                                                    term_client.second._ip,
-                                                    term_client.second._client_user_name,
-                                                    term_client.second._client_name);
-    auto ws_msg = std::make_shared<WebsocketMessage>(json_msg);
-    client->Send(ws_msg);
+  if(!_active_remote_hosts.empty()) {
+    client->Send(std::make_shared<WebsocketMessage>(JsonMsg::MakeRemoteHostsConnectedMsg(_active_remote_hosts)));
   }
 }
 
@@ -386,8 +706,21 @@ void WebAppServer::RemoveClient(std::shared_ptr<Client> client) {
 
   const std::map<uint32_t, uint32_t>& terminals = session->GetTerminals();
 
+  std::vector<std::shared_ptr<ActiveSessions::WebAppSession>> viewers;
   for(auto& it : terminals) {
     _term_server->DeleteTerminal(it.second, it.first);
+    // the owner's session is gone before the terminal reports closing
+    viewers.clear();
+    _sessions.EraseTerminalViewers(it.first, viewers);
+    if(!viewers.empty()) {
+      auto ws_msg = std::make_shared<WebsocketMessage>(JsonMsg::MakeTerminalClosed(it.first, it.second));
+      for(auto& viewer : viewers) {
+        viewer->GetClient()->Send(ws_msg);
+      }
+    }
+  }
+  for(uint32_t group_id : session->GetTerminalGroupIds()) {
+    _term_server->SetTerminalGroup(group_id, {});
   }
 
   _sessions.EraseWebAppSession(client);
@@ -397,7 +730,7 @@ void WebAppServer::RemoveClient(std::shared_ptr<Client> client) {
 
 void WebAppServer::OnTerminalFileReq(std::shared_ptr<Client> client,
                                     int terminal_id,
-                                    const std::string& path) {
+                                    const DirectoryPager::Options& options) {
   if(!_sessions.IsWebAppClientOwningTerminal(client, terminal_id)) {
     DLOG(error, "OnTerminalFileReq : terminal ownership failed : client: {}, terminal: {}",
                  client->GetId(),
@@ -412,14 +745,65 @@ void WebAppServer::OnTerminalFileReq(std::shared_ptr<Client> client,
   }
 
   auto file_session = _sessions.CreateFileTransferSession(client);
-  auto file_transfer = _term_server->CreateFileRequest(remote_host_id, file_session->GetId(), path, true);
-  if(!file_transfer) {
-    DLOG(error, "OnTerminalFileReq : create new request failed");
+  file_session->SetTerminalId(terminal_id);
+  file_session->SetPath(options._path);
+  file_session->SetListingContinuation(options._cursor != 0);
+  if(!_term_server->RequestDirectoryListing(remote_host_id, file_session->GetId(), options)) {
+    DLOG(error, "OnTerminalFileReq : directory listing request failed");
     _sessions.EraseFileTransferSession(file_session->GetId());
+  }
+}
+
+void WebAppServer::OnDirectoryListingReceived(uint32_t remote_host_id,
+                                              uint32_t req_id,
+                                              uint8_t status,
+                                              uint32_t cursor,
+                                              std::shared_ptr<Data> page) {
+  if(_thread_loop->OnDifferentThread()) {
+    _thread_loop->Post(std::bind(&WebAppServer::OnDirectoryListingReceived,
+                                 shared_from_this(),
+                                 remote_host_id,
+                                 req_id,
+                                 status,
+                                 cursor,
+                                 page));
+    return;
+  };
+
+  auto session = _sessions.GetFileTransferSession(req_id);
+  if(!session) {
+    log()->error("Can't find session with id {}", req_id);
     return;
   }
-  file_session->SetFileTransfer(file_transfer);
-  file_session->SetTerminalId(terminal_id);
+
+  if(status != FileTransferHandler::ListingStatus::LISTING_OK) {
+    DLOG(warn, "OnDirectoryListingReceived : listing failed for : {}", session->GetPath());
+  } else {
+    SendDirectoryListing(session, cursor, page);
+  }
+
+  _sessions.EraseFileTransferSession(req_id);
+}
+
+void WebAppServer::SendDirectoryListing(std::shared_ptr<ActiveSessions::FileTransferSession> session,
+                                        uint32_t cursor,
+                                        std::shared_ptr<Data> page) {
+  // [type1][terminal_id4][cursor4][append1][path_len2][path][page as sent by the agent]
+  uint8_t msg_type = BinaryMsgType::DIRECTORY_LISTING;
+  uint32_t terminal_id = session->GetTerminalId();
+  uint8_t append = session->IsListingContinuation();
+  const std::string& path = session->GetPath();
+  uint16_t path_length = (uint16_t)std::min<size_t>(path.length(), UINT16_MAX);
+
+  auto data = std::make_shared<Data>(12 + path_length + page->GetCurrentSize());
+  data->Add(1, &msg_type);
+  data->Add(4, (unsigned char*)&terminal_id);
+  data->Add(4, (unsigned char*)&cursor);
+  data->Add(1, &append);
+  data->Add(2, (unsigned char*)&path_length);
+  data->Add(path_length, (unsigned char*)path.c_str());
+  data->Add(page->GetCurrentSize(), page->GetCurrentDataRaw());
+  session->GetWebClient()->Send(std::make_shared<WebsocketMessage>(data));
 }
 
 void WebAppServer::OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<SimpleMessage> msg, bool success) {
@@ -434,31 +818,34 @@ void WebAppServer::OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_tr
   };
 
   auto session = _sessions.GetFileTransferSession(file_transfer->GetRequestId());
-  uint32_t terminal_id = session->GetTerminalId();
-  if(success) {
-    if(terminal_id) {
-      std::vector<DirectoryListing::FileInfo> files;
-      if(!DirectoryListing::DeserializeDirectory(msg->GetContent()->GetMemCache(), files)) {
-        DLOG(error, "DeserializeDirectory failed");
-        return;
-      }
-      auto json_msg = JsonMsg::MakeDirectoryListingMsg(terminal_id, file_transfer->GetRequestPath(), files);
-      auto ws_msg = std::make_shared<WebsocketMessage>(json_msg);
-      session->GetWebClient()->Send(ws_msg);
+  if(!session) {
+    log()->error("Can't find session with id {}", file_transfer->GetRequestId());
+    return;
+  }
+
+  if(!success) {
+    if(!session->IsResponseStarted()) {
+      session->GetWebClient()->Send(std::make_shared<HttpMessage>(404));
+    }
+  } else if(!file_transfer->GetCachedFilePath().empty()) {
+    // file backed, written through the connection's usual buffered send path
+    auto file_resource = DataResource::CreateFromFile(file_transfer->GetCachedFilePath());
+    if(!file_resource) {
+      session->GetWebClient()->Send(std::make_shared<HttpMessage>(404));
     } else {
-     if(file_transfer->GetDataTransferCounter() == 1) {
-       auto header = std::make_shared<HttpHeader>(HttpHeaderProtocol::HTTP_1_1, 200);
-       header->SetField(HttpHeaderField::CONTENT_TYPE, "application/octet-stream");
-       header->SetField(HttpHeaderField::CONTENT_LENGTH, std::to_string(file_transfer->GetExpectedFileSize()));
-       auto http_header_msg = std::make_shared<HttpMessage>(header, nullptr);
-       session->GetWebClient()->Send(http_header_msg);
-     }
-     auto data_message = std::make_shared<Message>(msg->GetContent()->GetMemCache());
-     session->GetWebClient()->Send(data_message);
+      SendFileDownloadHeader(session, file_transfer);
+      session->GetWebClient()->Send(std::make_shared<Message>(file_resource));
     }
   } else {
-    //TODO
+    if(!session->IsResponseStarted()) {
+      SendFileDownloadHeader(session, file_transfer);
+    }
+    if(IsChunkedResponse(file_transfer)) {
+      session->GetWebClient()->Send(MakeHttpChunk(std::make_shared<Data>()));
+    }
   }
+
+  _sessions.EraseFileTransferSession(file_transfer->GetRequestId());
 }
 
 void WebAppServer::OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<Message> msg) {
@@ -476,28 +863,30 @@ void WebAppServer::OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file
     return;
   }
 
-  uint32_t terminal_id = session->GetTerminalId();
-  if(terminal_id) {
-    std::vector<DirectoryListing::FileInfo> files;
-    if(!DirectoryListing::DeserializeDirectory(msg->GetDataResource()->GetMemCache(), files)) {
-      //TODO
-      return;
-    }
-    auto json_msg = JsonMsg::MakeDirectoryListingMsg(terminal_id, file_transfer->GetRequestPath(), files);
-    auto ws_msg = std::make_shared<WebsocketMessage>(json_msg);
-    session->GetWebClient()->Send(ws_msg);
+  if(!session->IsResponseStarted()) {
+    SendFileDownloadHeader(session, file_transfer);
+  }
+
+  if(IsChunkedResponse(file_transfer)) {
+    session->GetWebClient()->Send(MakeHttpChunk(msg->GetDataResource()->GetMemCache()));
   } else {
-    if(file_transfer->GetDataTransferCounter() == 1) {
-      auto header = std::make_shared<HttpHeader>(HttpHeaderProtocol::HTTP_1_1, 200);
-      header->SetField(HttpHeaderField::CONTENT_TYPE, "application/octet-stream");
-      header->SetField(HttpHeaderField::CONTENT_LENGTH, std::to_string(file_transfer->GetExpectedFileSize()));
-      auto http_header_msg = std::make_shared<HttpMessage>(header, nullptr);
-      session->GetWebClient()->Send(http_header_msg);
-    }
     session->GetWebClient()->Send(msg);
   }
+}
 
-  if(file_transfer->GetExpectedFileSize() == file_transfer->GetReceivedFileSize()) {
-    _sessions.EraseFileTransferSession(file_transfer->GetRequestId());
+void WebAppServer::SendFileDownloadHeader(std::shared_ptr<ActiveSessions::FileTransferSession> session,
+                                          std::shared_ptr<FileTransfer> file_transfer) {
+  auto header = std::make_shared<HttpHeader>(HttpHeaderProtocol::HTTP_1_1, 200);
+  header->SetField(HttpHeaderField::CONTENT_TYPE, file_transfer->IsArchive() ? "application/x-tar" : "application/octet-stream");
+  if(file_transfer->IsGzipEncoded()) {
+    header->SetField(HttpHeaderField::CONTENT_ENCODING, "gzip");
+  }
+  if(IsChunkedResponse(file_transfer)) {
+    header->SetField(HttpHeaderField::TRANSFER_ENCODING, "chunked");
+  } else {
+    header->SetField(HttpHeaderField::CONTENT_LENGTH, std::to_string(file_transfer->GetExpectedFileSize()));
   }
+  auto http_header_msg = std::make_shared<HttpMessage>(header, nullptr);
+  session->GetWebClient()->Send(http_header_msg);
+  session->SetResponseStarted();
 }
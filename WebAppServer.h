@@ -30,6 +30,8 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Terminal.h"
 #include "Data.h"
 #include "FileTransfer.h"
+#include "DirectoryPager.h"
+#include "JsonMsg.h"
 
 #include <memory>
 #include <map>
@@ -38,6 +40,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 class Client;
 class TerminalServer;
+class DownloadCache;
 class Session;
 class SimpleMessage;
 struct TerminalInfo;
@@ -48,42 +51,67 @@ class WebAppServer : public HttpRequestHandler
                    , public std::enable_shared_from_this<WebAppServer> {
 
 public:
-  WebAppServer(std::shared_ptr<TerminalServer> term_proxy, bool listen_all_src);
+  enum BinaryMsgType {
+    DIRECTORY_LISTING = 1
+  };
+
+  WebAppServer(std::shared_ptr<TerminalServer> term_proxy,
+               bool listen_all_src,
+               std::shared_ptr<DownloadCache> download_cache);
 
   void Handle(HttpRequest& request) override;
   bool OnWsClientConnected(std::shared_ptr<Client> client, const std::string& request_arg) override;
   void OnWsClientMessage(std::shared_ptr<Client> client, std::shared_ptr<WebsocketMessage> message) override;
   void OnWsClientClosed(std::shared_ptr<Client> client) override;
 
-  void OnRemoteHostInfoReceived(uint32_t proxy_client_id,
-                                    const std::string& ip,
-                                    const std::string& user_name,
-                                    const std::string& client_name);
+  void OnRemoteHostsInfoReceived(std::map<uint32_t, RemoteHostInfo> remote_hosts);
   void OnTerminalClientClosed(uint32_t proxy_client_id);
   void OnTerminalCreated(uint32_t client_id, uint32_t terminal_id, uint32_t remote_host_id, bool success);
   void OnTerminalOutput(uint32_t client_id, uint32_t terminal_id, std::shared_ptr<Data> output);
+  void OnTerminalResumed(uint32_t client_id, uint32_t terminal_id, uint32_t remote_host_id, uint64_t offset);
   void OnTerminalClosed(uint32_t client_id, uint32_t terminal_id, uint32_t remote_host_id);
-
+  void OnTerminalWriteState(uint32_t client_id, uint32_t terminal_id, bool blocked, uint32_t dropped_bytes);
+  void OnTerminalsOrphaned(const std::string& owner_key, uint32_t remote_host_id, std::vector<uint32_t> terminal_ids);
+
+  void OnDirectoryListingReceived(uint32_t remote_host_id,
+                                  uint32_t req_id,
+                                  uint8_t status,
+                                  uint32_t cursor,
+                                  std::shared_ptr<Data> page);
+  void OnExecOutput(uint32_t client_id, uint32_t exec_id, uint32_t remote_host_id, uint8_t stream, std::shared_ptr<Data> output);
+  void OnExecEnd(uint32_t client_id, uint32_t exec_id, uint32_t remote_host_id, int32_t exit_code, uint8_t flags);
   void OnFileTransferCompleted(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<SimpleMessage> msg, bool success);
   void OnFileTransferDataReceived(std::shared_ptr<FileTransfer> file_transfer, std::shared_ptr<Message> msg);
 
 private:
-  struct RemoteHostInfo {
-    std::string _ip;
-    std::string _client_user_name;
-    std::string _client_name;
-  };
 
   void PerpareHTTPGetResponse(HttpRequest& request);
-  void PerpareFileDownloadResponse(HttpRequest& request);
+  void PerpareFileDownloadResponse(HttpRequest& request, bool is_archive);
+  void PerpareDistributionStartResponse(HttpRequest& request);
+  void PerpareDistributionStatusResponse(HttpRequest& request);
+  void SendDirectoryListing(std::shared_ptr<ActiveSessions::FileTransferSession> session,
+                            uint32_t cursor,
+                            std::shared_ptr<Data> page);
+  void SendFileDownloadHeader(std::shared_ptr<ActiveSessions::FileTransferSession> session,
+                              std::shared_ptr<FileTransfer> file_transfer);
   void AddClient(std::shared_ptr<Client> client);
   void RemoveClient(std::shared_ptr<Client> client);
 
   void OnTerminalAddReq(std::shared_ptr<Client> client, int remote_host_id);
+  void OnOwnerKeyReq(std::shared_ptr<Client> client, const std::string& owner_key);
+  void OnTerminalReattachReq(std::shared_ptr<Client> client, int remote_host_id, int terminal_id);
   void OnTerminalResizeReq(std::shared_ptr<Client> client, int terminal_id, int width, int height);
   void OnTerminalDelReq(std::shared_ptr<Client> client, int terminal_id);
   void OnTerminalKeyEvent(std::shared_ptr<Client> client, int terminal_id, const std::string& key);
-  void OnTerminalFileReq(std::shared_ptr<Client> client, int terminal_id, const std::string& key);
+  void OnTerminalViewReq(std::shared_ptr<Client> client, int terminal_id);
+  void OnTerminalViewDelReq(std::shared_ptr<Client> client, int terminal_id);
+  void OnTerminalViewAck(std::shared_ptr<Client> client, int terminal_id, int bytes);
+  void SendToTerminalViewers(uint32_t terminal_id, size_t output_size, std::shared_ptr<WebsocketMessage> ws_msg);
+  void OnTerminalGroupSetReq(std::shared_ptr<Client> client, int group_id, const std::vector<uint32_t>& terminal_ids);
+  void OnTerminalGroupDelReq(std::shared_ptr<Client> client, int group_id);
+  void OnTerminalGroupKeyEvent(std::shared_ptr<Client> client, int group_id, const std::string& key);
+  void OnTerminalFileReq(std::shared_ptr<Client> client, int terminal_id, const DirectoryPager::Options& options);
+  void OnExecReq(std::shared_ptr<Client> client, const std::string& command, std::vector<uint32_t> host_ids, int timeout_ms);
 
   std::shared_ptr<Client> GetOwnerOfTerminal(int terminal_id);
   bool IsClientOwningTerminal(std::shared_ptr<Client> client, int terminal_id);
@@ -91,6 +119,7 @@ private:
 
   std::shared_ptr<TerminalServer> _term_server;
   std::shared_ptr<WebsocketServer> _ws_server;
+  std::shared_ptr<DownloadCache> _download_cache;
 
   std::map<uint32_t, RemoteHostInfo> _active_remote_hosts;
   std::shared_ptr<ThreadLoop> _thread_loop;
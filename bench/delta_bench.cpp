@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+// Measures how much of a re-download the delta path avoids : writes a base
+// file, mutates a share of it, then runs the signature / encode / decode
+// pipeline FileTransfer uses and reports wire bytes and CPU time per stage.
+//
+// usage : delta_bench [size_mib] [changed_percent] [work_dir]
+
+#include "DeltaTransfer.h"
+#include "Data.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace {
+
+const size_t DEFAULT_SIZE_MIB = 64;
+const size_t DEFAULT_CHANGED_PERCENT = 5;
+const size_t CHANGE_RUN = 4096;
+
+double Elapsed(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(content.data(), content.size());
+  return file.good();
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  size_t size_mib = argc > 1 ? strtoul(argv[1], nullptr, 10) : DEFAULT_SIZE_MIB;
+  size_t changed_percent = argc > 2 ? strtoul(argv[2], nullptr, 10) : DEFAULT_CHANGED_PERCENT;
+  std::string work_dir = argc > 3 ? argv[3] : std::filesystem::temp_directory_path().string();
+
+  std::string base_path = work_dir + "/delta_bench.base";
+  std::string new_path = work_dir + "/delta_bench.new";
+  std::string out_path = work_dir + "/delta_bench.out";
+
+  std::mt19937 rng(1);
+  std::string base(size_mib * 1024 * 1024, 0);
+  for(auto& c : base) {
+    c = (char)(rng() & 0xFF);
+  }
+
+  // rewrite runs at random offsets and shift the tail once so matching has to resync
+  std::string modified = base;
+  size_t runs = modified.size() * changed_percent / 100 / CHANGE_RUN;
+  for(size_t i = 0; i < runs; ++i) {
+    size_t pos = rng() % (modified.size() - CHANGE_RUN);
+    for(size_t j = 0; j < CHANGE_RUN; ++j) {
+      modified[pos + j] = (char)(rng() & 0xFF);
+    }
+  }
+  modified.insert(modified.size() / 2, "delta_bench");
+
+  if(!WriteFile(base_path, base) || !WriteFile(new_path, modified)) {
+    fprintf(stderr, "can't write to : %s\n", work_dir.c_str());
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto signature = DeltaSignature::CreateFromFile(base_path);
+  double sig_time = Elapsed(start);
+  auto sig_wire = signature->Serialize()->GetCurrentSize();
+
+  DeltaEncoder encoder(DeltaSignature::Deserialize(signature->Serialize()));
+  DeltaDecoder decoder(base_path, out_path);
+  if(!encoder.Open(new_path) || !decoder.Open(signature)) {
+    fprintf(stderr, "can't open bench files\n");
+    return 1;
+  }
+
+  bool is_last = false;
+  while(!is_last) {
+    auto ops = encoder.ReadNextBlock(is_last);
+    if(!ops || (ops->GetCurrentSize() && !decoder.Decode(ops))) {
+      fprintf(stderr, "delta stream failed\n");
+      return 1;
+    }
+  }
+  unsigned char hash[DeltaSignature::STRONG_HASH_SIZE];
+  encoder.GetFileHash(hash);
+  bool is_valid = decoder.Finish(hash);
+
+  uint64_t full = modified.size();
+  uint64_t wire = decoder.GetWireSize() + sig_wire;
+  printf("size           : %zu MiB, changed %zu%%\n", size_mib, changed_percent);
+  printf("block size     : %u\n", signature->GetBlockSize());
+  printf("signature      : %lu B, %.3f s\n", (unsigned long)sig_wire, sig_time);
+  printf("copied/literal : %lu / %lu B\n", (unsigned long)encoder.GetCopiedSize(), (unsigned long)encoder.GetLiteralSize());
+  printf("wire           : %lu B of %lu B (%.1f%% saved)\n", (unsigned long)wire, (unsigned long)full,
+         100.0 * (1.0 - (double)wire / (double)full));
+  printf("cpu encode     : %.3f s\n", encoder.GetCpuTime());
+  printf("cpu decode     : %.3f s\n", decoder.GetCpuTime());
+  printf("result         : %s\n", is_valid ? "match" : "MISMATCH");
+
+  std::filesystem::remove(base_path);
+  std::filesystem::remove(new_path);
+  std::filesystem::remove(out_path);
+  return is_valid ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+// Times a directory listing the way the file browser requests it, against a
+// plain std::filesystem walk as the baseline. For every entry count a flat
+// directory is created (every 10th entry a subdirectory) and removed after.
+//
+// usage : listing_bench [work_dir] [entries...]   (default 10000 100000 1000000)
+
+#include "DirectoryPager.h"
+#include "DirectoryReader.h"
+#include "Data.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t PAGE_SIZE = 500;
+const size_t NAME_BATCH = 4096;
+const size_t DIRECTORY_EVERY = 10;
+
+double Millis(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool CreateEntries(const std::string& dir, size_t count) {
+  std::error_code error;
+  std::filesystem::remove_all(dir, error);
+  if(!std::filesystem::create_directories(dir, error)) {
+    return false;
+  }
+  for(size_t i = 0; i < count; ++i) {
+    std::string path = dir + "/entry_" + std::to_string(i);
+    if(i % DIRECTORY_EVERY == 0) {
+      if(mkdir(path.c_str(), 0755)) {
+        return false;
+      }
+      continue;
+    }
+    int fd = open(path.c_str(), O_CREAT | O_WRONLY, 0644);
+    if(fd < 0) {
+      return false;
+    }
+    close(fd);
+  }
+  return true;
+}
+
+double FilesystemWalk(const std::string& dir, size_t& out_count) {
+  auto start = std::chrono::steady_clock::now();
+  out_count = 0;
+  for(auto& entry : std::filesystem::directory_iterator(dir)) {
+    std::error_code error;
+    if(!entry.is_directory(error)) {
+      entry.file_size(error);
+    }
+    entry.last_write_time(error);
+    ++out_count;
+  }
+  return Millis(start);
+}
+
+double ReaderWalk(const std::string& dir, size_t& out_count) {
+  auto start = std::chrono::steady_clock::now();
+  DirectoryReader reader;
+  std::vector<DirectoryListing::FileInfo> entries;
+  if(reader.Open(dir)) {
+    while(reader.ReadNames(NAME_BATCH, entries));
+    reader.StatEntries(entries.begin(), entries.end());
+  }
+  out_count = entries.size();
+  return Millis(start);
+}
+
+double FirstPage(const std::string& dir,
+                 uint8_t sort,
+                 std::vector<DirectoryListing::FileInfo>& out_page) {
+  auto start = std::chrono::steady_clock::now();
+  DirectoryPager::Options options;
+  options._path = dir;
+  options._sort = sort;
+  DirectoryPager pager(options, nullptr);
+  out_page.clear();
+  if(pager.Open()) {
+    pager.ReadPage(PAGE_SIZE, out_page);
+  }
+  return Millis(start);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  std::string work_dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path().string();
+  std::vector<size_t> counts;
+  for(int i = 2; i < argc; ++i) {
+    counts.push_back(strtoul(argv[i], nullptr, 10));
+  }
+  if(counts.empty()) {
+    counts = {10000, 100000, 1000000};
+  }
+
+  for(size_t count : counts) {
+    std::string dir = work_dir + "/listing_bench_" + std::to_string(count);
+    if(!CreateEntries(dir, count)) {
+      fprintf(stderr, "can't create entries in : %s\n", dir.c_str());
+      return 1;
+    }
+
+    size_t fs_count = 0;
+    size_t reader_count = 0;
+    std::vector<DirectoryListing::FileInfo> page;
+    double fs_time = FilesystemWalk(dir, fs_count);
+    double reader_time = ReaderWalk(dir, reader_count);
+    double unsorted_time = FirstPage(dir, DirectoryPager::SortBy::NONE, page);
+    double sorted_time = FirstPage(dir, DirectoryPager::SortBy::NAME, page);
+    size_t plain_size = DirectoryPager::SerializePage(page, false)->GetCurrentSize();
+    size_t prefix_size = DirectoryPager::SerializePage(page, true)->GetCurrentSize();
+
+    printf("%zu entries, pages of %u\n", count, PAGE_SIZE);
+    printf("  std::filesystem walk    : %9.1f ms (%zu)\n", fs_time, fs_count);
+    printf("  getdents + statx walk   : %9.1f ms (%zu)\n", reader_time, reader_count);
+    printf("  first page, unsorted    : %9.1f ms\n", unsorted_time);
+    printf("  first page, by name     : %9.1f ms\n", sorted_time);
+    printf("  serialized first page   : %zu B, %zu B prefix compressed\n", plain_size, prefix_size);
+
+    std::error_code error;
+    std::filesystem::remove_all(dir, error);
+  }
+  return 0;
+}
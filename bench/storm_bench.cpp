@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2026 Adam Kaniewski
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+// Replays a reconnect storm : every agent loses the server at once and comes back.
+// Runs the agents' ReconnectBackoff and the server's RateLimiter and registration
+// batching against a simulated clock-driven queue, once with all of it disabled
+// (every agent retries each second, every host announced on its own) and once as
+// shipped, and reports convergence time, connect attempts and announcement CPU.
+//
+// usage : storm_bench [agents] [browsers]
+
+#include "JsonMsg.h"
+#include "RateLimiter.h"
+#include "ReconnectBackoff.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// same values as TerminalClient and TerminalServer
+const std::chrono::milliseconds RECONNECT_MIN_DELAY(1000);
+const std::chrono::milliseconds RECONNECT_MAX_DELAY(30000);
+const std::chrono::milliseconds BASELINE_RETRY(1000);
+const double ACCEPT_RATE = 1000;
+const size_t REGISTRATION_BATCH_SIZE = 256;
+const std::chrono::milliseconds REGISTRATION_BATCH_INTERVAL(20);
+const std::chrono::milliseconds RATE_WINDOW(1000);
+const std::chrono::microseconds LOOP_STEP(200);
+const size_t DEFAULT_AGENTS = 10000;
+const size_t DEFAULT_BROWSERS = 5;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Attempt {
+  Clock::time_point _time;
+  size_t _agent;
+  bool operator>(const Attempt& other) const {
+    return _time > other._time;
+  }
+};
+
+struct StormResult {
+  double _seconds = 0;
+  size_t _attempts = 0;
+  size_t _refused = 0;
+  double _peak_rate = 0;
+  double _peak_cpu = 0;
+  size_t _announced_bytes = 0;
+};
+
+StormResult RunStorm(size_t agents, size_t browsers, bool protect) {
+  StormResult result;
+  // one each, copies would share the random state and retry in lockstep
+  std::vector<ReconnectBackoff> backoffs;
+  for(size_t agent = 0; agent < agents; ++agent) {
+    backoffs.emplace_back(RECONNECT_MIN_DELAY, RECONNECT_MAX_DELAY);
+  }
+  RateLimiter limiter(protect ? ACCEPT_RATE : 0, protect ? ACCEPT_RATE : 0);
+  std::priority_queue<Attempt, std::vector<Attempt>, std::greater<Attempt>> attempts;
+
+  auto start = Clock::now();
+  for(size_t agent = 0; agent < agents; ++agent) {
+    auto delay = protect ? backoffs[agent].NextDelay() : std::chrono::milliseconds(0);
+    attempts.push({start + delay, agent});
+  }
+
+  std::map<uint32_t, RemoteHostInfo> pending;
+  size_t admitted = 0;
+  auto next_batch = start;
+  auto window_start = start;
+  size_t window_admitted = 0;
+  double window_cpu = 0;
+
+  while(admitted < agents) {
+    auto now = Clock::now();
+    while(!attempts.empty() && attempts.top()._time <= now) {
+      Attempt attempt = attempts.top();
+      attempts.pop();
+      ++result._attempts;
+      if(limiter.Acquire()) {
+        pending[(uint32_t)attempt._agent + 1] = {"10.0.0.1", "user", "host" + std::to_string(attempt._agent)};
+        continue;
+      }
+      ++result._refused;
+      auto delay = protect ? backoffs[attempt._agent].NextDelay() : BASELINE_RETRY;
+      attempts.push({now + delay, attempt._agent});
+    }
+
+    if(now >= next_batch && !pending.empty()) {
+      auto cpu_start = Clock::now();
+      std::vector<std::map<uint32_t, RemoteHostInfo>> batches;
+      if(protect) {
+        batches.emplace_back();
+        while(!pending.empty() && batches.back().size() < REGISTRATION_BATCH_SIZE) {
+          batches.back().insert(*pending.begin());
+          pending.erase(pending.begin());
+        }
+      } else {
+        for(auto& host : pending) {
+          batches.push_back({host});
+        }
+        pending.clear();
+      }
+      for(auto& batch : batches) {
+        std::string msg = JsonMsg::MakeRemoteHostsConnectedMsg(batch);
+        result._announced_bytes += msg.size() * browsers;
+        admitted += batch.size();
+        window_admitted += batch.size();
+      }
+      window_cpu += std::chrono::duration<double>(Clock::now() - cpu_start).count();
+      next_batch = now + (protect ? REGISTRATION_BATCH_INTERVAL : std::chrono::milliseconds(0));
+    }
+
+    double window = std::chrono::duration<double>(now - window_start).count();
+    if(now - window_start >= RATE_WINDOW || admitted == agents) {
+      window = std::max(window, std::chrono::duration<double>(RATE_WINDOW).count());
+      result._peak_rate = std::max(result._peak_rate, window_admitted / window);
+      result._peak_cpu = std::max(result._peak_cpu, window_cpu / window);
+      window_admitted = 0;
+      window_cpu = 0;
+      window_start = now;
+    }
+    std::this_thread::sleep_for(LOOP_STEP);
+  }
+
+  result._seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return result;
+}
+
+void PrintResult(const char* name, const StormResult& result) {
+  printf("%-18s : converged in %.1f s, %zu connect attempts (%zu refused), "
+         "peak %.0f admissions/s, peak announce CPU %.1f%% of a core, %zu B announced\n",
+         name, result._seconds, result._attempts, result._refused,
+         result._peak_rate, result._peak_cpu * 100, result._announced_bytes);
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  size_t agents = argc > 1 ? strtoul(argv[1], nullptr, 10) : DEFAULT_AGENTS;
+  size_t browsers = argc > 2 ? strtoul(argv[2], nullptr, 10) : DEFAULT_BROWSERS;
+  if(!agents) {
+    return 1;
+  }
+
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  printf("%zu agents, %zu browsers\n", agents, browsers);
+  PrintResult("baseline", RunStorm(agents, browsers, false));
+  PrintResult("backoff + admission", RunStorm(agents, browsers, true));
+  return 0;
+}
@@ -21,10 +21,12 @@ OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+#include <cstdlib>
 #include <string>
 #include <unistd.h>
 
 #include "Connection.h"
+#include "DownloadCache.h"
 #include "Logger.h"
 #include "TerminalServer.h"
 #include "WebAppServer.h"
@@ -33,11 +35,17 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 const int WEB_APP_LISTEN_PORT = 8080;
 const int TERMINAL_SERVER_LISTEN_PORT = 4476;
 const std::string LISTEN_FLAG = "--listen";
+const std::string CACHE_DIR_FLAG = "--cache-dir";
+const std::string CACHE_SIZE_FLAG = "--cache-size";
+const uint64_t DEFAULT_CACHE_SIZE_MB = 1024;
 
 int main(int argc, char** args) {
   auto connection = Connection::CreateBasic();
   auto terminal_server = std::make_shared<TerminalServer>();
   bool web_app_listen_all_connections = false;
+  std::string cache_dir;
+  uint64_t cache_size_mb = DEFAULT_CACHE_SIZE_MB;
+  std::shared_ptr<DownloadCache> download_cache;
 
   auto server_obj = connection->CreateServer(TERMINAL_SERVER_LISTEN_PORT, std::static_pointer_cast<ClientManager>(terminal_server));
   if(!server_obj) {
@@ -49,13 +57,23 @@ int main(int argc, char** args) {
     for(int i = 1; i < argc; ++i) {
       if(!LISTEN_FLAG.compare(args[i])) {
         web_app_listen_all_connections = true;
-        break;
+      } else if(!CACHE_DIR_FLAG.compare(args[i]) && i + 1 < argc) {
+        cache_dir = args[++i];
+      } else if(!CACHE_SIZE_FLAG.compare(args[i]) && i + 1 < argc) {
+        cache_size_mb = std::strtoull(args[++i], nullptr, 10);
       }
     }
   }
 
+  if(!cache_dir.empty()) {
+    download_cache = std::make_shared<DownloadCache>(cache_dir, cache_size_mb * 1024 * 1024);
+    if(!download_cache->Init()) {
+      download_cache.reset();
+    }
+  }
+
   auto ws_server = std::make_shared<WebsocketServer>();
-  auto web_app_server = std::make_shared<WebAppServer>(terminal_server, web_app_listen_all_connections);
+  auto web_app_server = std::make_shared<WebAppServer>(terminal_server, web_app_listen_all_connections, download_cache);
 
   terminal_server->Init(web_app_server, server_obj);
   bool web_app_started = ws_server->Init(connection, web_app_server, web_app_server, WEB_APP_LISTEN_PORT);
@@ -5,11 +5,12 @@ class AppEvent {
 }
 
 class AppEventTerminalAdded extends AppEvent {
-  constructor(hostId, terminalId) {
+  constructor(hostId, terminalId, readOnly) {
     super();
     this.type = "TerminalAdded";
     this.hostId = hostId;
     this.terminalId = terminalId;
+    this.readOnly = readOnly ? true : false;
   }
 }
 
@@ -0,0 +1,242 @@
+class ExecView extends View {
+  constructor(hostList) {
+    super();
+    this.hostList = hostList;
+    this.hostChecks = new Map();
+    this.runs = new Map();
+    this.runsNode = null;
+    this.createNode();
+  }
+
+  createNode() {
+    super.createNode();
+    this.setId("exec_view");
+    let self = this;
+
+    let form = document.createElement("div");
+    form.setAttribute("id", "exec_form");
+
+    this.commandInput = document.createElement("input");
+    this.commandInput.setAttribute("id", "exec_command");
+    this.commandInput.setAttribute("placeholder", "Command");
+    this.commandInput.addEventListener("keydown", function(event) {
+      if(event.key == "Enter") {
+        self.onRunClicked();
+      }
+    });
+    form.appendChild(this.commandInput);
+
+    this.timeoutInput = document.createElement("input");
+    this.timeoutInput.setAttribute("id", "exec_timeout");
+    this.timeoutInput.setAttribute("type", "number");
+    this.timeoutInput.setAttribute("min", "1");
+    this.timeoutInput.setAttribute("title", "Timeout in seconds");
+    this.timeoutInput.value = 30;
+    form.appendChild(this.timeoutInput);
+
+    let runBt = document.createElement("div");
+    runBt.setAttribute("class", "base_bt");
+    runBt.innerText = "Run";
+    runBt.addEventListener("click", function() {self.onRunClicked()});
+    form.appendChild(runBt);
+    this.addObj(form);
+
+    this.hostsNode = document.createElement("div");
+    this.hostsNode.setAttribute("id", "exec_hosts");
+    this.addObj(this.hostsNode);
+
+    this.runsNode = document.createElement("div");
+    this.runsNode.setAttribute("id", "exec_runs");
+    this.addObj(this.runsNode);
+    this.hide();
+  }
+
+  clear() {
+    this.runs = new Map();
+    this.runsNode.innerHTML = "";
+  }
+
+  show() {
+    super.show();
+    this.refreshHosts();
+  }
+
+  refreshHosts() {
+    let checked = new Map();
+    this.hostChecks.forEach((check, hostId) => {
+      checked.set(hostId, check.checked);
+    });
+    this.hostChecks = new Map();
+    this.hostsNode.innerHTML = "";
+
+    this.hostList.hosts.forEach((host, hostId) => {
+      let label = document.createElement("label");
+      let check = document.createElement("input");
+      check.setAttribute("type", "checkbox");
+      check.checked = checked.has(hostId) ? checked.get(hostId) : true;
+      label.appendChild(check);
+      label.appendChild(document.createTextNode(host.name));
+      this.hostChecks.set(hostId, check);
+      this.hostsNode.appendChild(label);
+    });
+  }
+
+  hostName(hostId) {
+    let host = this.hostList.getHostById(hostId);
+    return host != null ? host.name : "host " + hostId;
+  }
+
+  onRunClicked() {
+    let command = this.commandInput.value.trim();
+    if(command.length == 0) {
+      return;
+    }
+    let hostIds = [];
+    this.hostChecks.forEach((check, hostId) => {
+      if(check.checked) {
+        hostIds.push(hostId);
+      }
+    });
+    if(hostIds.length == 0) {
+      return;
+    }
+    let timeout = Math.max(1, parseInt(this.timeoutInput.value) || 30) * 1000;
+    document.webApp.messenger.send(MessageBuilder.makeExecReq(command, hostIds, timeout));
+  }
+
+  onExecStarted(execId, command, hostIds) {
+    let run = {
+      command: command,
+      total: hostIds.length,
+      pending: new Map(),
+      groups: new Map(),
+      node: document.createElement("div"),
+      render_pending: false
+    };
+    hostIds.forEach(hostId => {
+      run.pending.set(hostId, {stdout: "", stderr: ""});
+    });
+    run.node.setAttribute("class", "exec_run");
+    this.runs.set(execId, run);
+    this.runsNode.insertBefore(run.node, this.runsNode.firstChild);
+
+    // older runs are dropped, each one may hold output of every host
+    while(this.runs.size > ExecView.MAX_RUNS) {
+      let oldest = this.runs.keys().next().value;
+      this.runsNode.removeChild(this.runs.get(oldest).node);
+      this.runs.delete(oldest);
+    }
+    this.scheduleRender(run);
+  }
+
+  onExecOutput(execId, hostId, stream, output) {
+    let run = this.runs.get(execId);
+    if(run == undefined || !run.pending.has(hostId)) {
+      return;
+    }
+    let result = run.pending.get(hostId);
+    if(stream == ExecView.STDERR) {
+      result.stderr += output;
+    } else {
+      result.stdout += output;
+    }
+    this.scheduleRender(run);
+  }
+
+  onExecEnd(execId, hostId, exitCode, flags) {
+    let run = this.runs.get(execId);
+    if(run == undefined || !run.pending.has(hostId)) {
+      return;
+    }
+    let result = run.pending.get(hostId);
+    run.pending.delete(hostId);
+
+    // hosts with the same output and exit status end up in one group
+    let key = exitCode + "\0" + flags + "\0" + result.stdout + "\0" + result.stderr;
+    if(!run.groups.has(key)) {
+      run.groups.set(key, {exitCode: exitCode, flags: flags, stdout: result.stdout, stderr: result.stderr, hosts: []});
+    }
+    run.groups.get(key).hosts.push(hostId);
+    this.scheduleRender(run);
+  }
+
+  scheduleRender(run) {
+    if(run.render_pending) {
+      return;
+    }
+    run.render_pending = true;
+    let self = this;
+    window.requestAnimationFrame(function() {
+      run.render_pending = false;
+      self.renderRun(run);
+    });
+  }
+
+  statusText(exitCode, flags) {
+    let text = "exit " + exitCode;
+    if(flags & ExecView.TIMED_OUT) {
+      text = "timed out";
+    } else if(flags & ExecView.HOST_LOST) {
+      text = "host lost";
+    }
+    if(flags & ExecView.TRUNCATED) {
+      text += ", output truncated";
+    }
+    return text;
+  }
+
+  renderRun(run) {
+    run.node.innerHTML = "";
+    let done = run.total - run.pending.size;
+
+    let header = document.createElement("div");
+    header.setAttribute("class", "exec_run_header");
+    header.innerText = run.command + "  (" + done + " / " + run.total + ")";
+    run.node.appendChild(header);
+
+    let groups = Array.from(run.groups.values());
+    groups.sort((first, second) => second.hosts.length - first.hosts.length);
+    groups.forEach(group => {
+      let names = group.hosts.map(hostId => this.hostName(hostId));
+      run.node.appendChild(this.makeResultNode(group.hosts.length + " hosts, " + this.statusText(group.exitCode, group.flags) + " : " + names.join(", "),
+                                               group.stdout, group.stderr, group.exitCode != 0 || group.flags != 0));
+    });
+
+    run.pending.forEach((result, hostId) => {
+      if(result.stdout.length == 0 && result.stderr.length == 0) {
+        return;
+      }
+      run.node.appendChild(this.makeResultNode(this.hostName(hostId) + " : running", result.stdout, result.stderr, false));
+    });
+  }
+
+  makeResultNode(title, stdout, stderr, failed) {
+    let node = document.createElement("div");
+    node.setAttribute("class", failed ? "exec_result failed" : "exec_result");
+
+    let titleNode = document.createElement("div");
+    titleNode.setAttribute("class", "exec_result_title");
+    titleNode.innerText = title;
+    node.appendChild(titleNode);
+
+    if(stdout.length) {
+      let out = document.createElement("pre");
+      out.innerText = stdout;
+      node.appendChild(out);
+    }
+    if(stderr.length) {
+      let err = document.createElement("pre");
+      err.setAttribute("class", "exec_stderr");
+      err.innerText = stderr;
+      node.appendChild(err);
+    }
+    return node;
+  }
+}
+
+ExecView.MAX_RUNS = 10;
+ExecView.STDOUT = 1;
+ExecView.STDERR = 2;
+ExecView.TIMED_OUT = 1;
+ExecView.TRUNCATED = 2;
+ExecView.HOST_LOST = 4;
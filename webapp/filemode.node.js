@@ -6,8 +6,52 @@ class FileModeNode extends View {
       this.contnet = null;
       this.current_elem = null;
       this.current_path = null;
+      this.entries = [];
+      this.render_pending = false;
+      this.cursor = 0;
+      this.page_pending = false;
+      this.sort = "";
+      this.descending = false;
+      this.filter = "";
       this.createNode();
-      document.webApp.messenger.send(MessageBuilder.makeFileReq(this.id, "/", true));
+      this.requestDirectory("/");
+    }
+
+    requestDirectory(path) {
+      this.cursor = 0;
+      this.page_pending = true;
+      document.webApp.messenger.send(MessageBuilder.makeFileReq(this.id, path, 0, this.sort, this.descending, this.filter));
+    }
+
+    requestNextPage() {
+      if(this.page_pending || this.cursor == 0) {
+        return;
+      }
+      this.page_pending = true;
+      document.webApp.messenger.send(MessageBuilder.makeFileReq(this.id, this.current_path, this.cursor, this.sort, this.descending, this.filter));
+    }
+
+    onScroll() {
+      this.scheduleRender();
+      let remaining = this.contnet.scrollHeight - this.contnet.scrollTop - this.contnet.clientHeight;
+      if(remaining < this.contnet.clientHeight) {
+        this.requestNextPage();
+      }
+    }
+
+    onSortClicked(sort) {
+      if(this.sort == sort) {
+        this.descending = !this.descending;
+      } else {
+        this.sort = sort;
+        this.descending = false;
+      }
+      this.requestDirectory(this.current_path);
+    }
+
+    onFilterChanged(value) {
+      this.filter = value;
+      this.requestDirectory(this.current_path);
     }
 
     createNode() {
@@ -19,9 +63,29 @@ class FileModeNode extends View {
       this.header.innerHTML = "Index of ";
       this.addObj(this.header);
 
+      let self = this;
+      this.filter_input = document.createElement("input");
+      this.filter_input.setAttribute("id", "file_node_filter");
+      this.filter_input.setAttribute("placeholder", "Filter");
+      this.filter_input.addEventListener("change",  function(){self.onFilterChanged(self.filter_input.value)});
+      this.addObj(this.filter_input);
+
+      this.labels = document.createElement("div");
+      this.labels.setAttribute("class", "file_row file_list_labels");
+      this.makeListLabels();
+      this.addObj(this.labels);
+
+      // only rows in view exist in the DOM, the spacer keeps the scrollbar right
       this.contnet = document.createElement("div");
       this.contnet.setAttribute("id", "file_node_content");
-      this.makeListLabels();
+      this.contnet.addEventListener("scroll",  function(){self.onScroll()});
+      this.spacer = document.createElement("div");
+      this.spacer.setAttribute("class", "file_rows_spacer");
+      this.contnet.appendChild(this.spacer);
+      this.rows_view = document.createElement("div");
+      this.rows_view.setAttribute("class", "file_rows_view");
+      this.rows_view.addEventListener("click",  function(event){self.onRowsClicked(event)});
+      this.contnet.appendChild(this.rows_view);
       this.addObj(this.contnet);
     }
 
@@ -41,29 +105,7 @@ class FileModeNode extends View {
       return result;
     }
 
-    makeListLabels() {
-      this.contnet.appendChild(document.createElement("div"));
-      let fileSize = document.createElement("div");
-      fileSize.innerHTML = "File Size";
-      this.contnet.appendChild(fileSize);
-      let modDate = document.createElement("div");
-      modDate.innerHTML = "Last Modified";
-      this.contnet.appendChild(modDate);
-    }
-
-    createDirElement(elem) {
-      let self = this;
-      let name = document.createElement("div");
-      name.setAttribute("class", "file_entry_name");
-      if(elem.is_dir) {
-        name.classList.add('file_entry_dir_name');
-      }
-      name.addEventListener("click",  function(){self.onClicked(elem)});
-      name.innerHTML = elem.display_name;
-      this.contnet.appendChild(name);
-
-      let size = document.createElement("div");
-      size.setAttribute("class", "file_entry_size");
+    sizeToString(elem) {
       let size_val = elem.size;
       let size_ext = "";
       if(elem.size > Math.pow(1024,1) && elem.size <= Math.pow(1024,2)) {
@@ -76,32 +118,152 @@ class FileModeNode extends View {
         size_val = (elem.size / Math.pow(1024,3)).toFixed(2);
         size_ext = " GB";
       }
+      return size_val + size_ext;
+    }
 
-      if(!elem.is_dir) {
-        size.innerHTML = size_val + size_ext;
+    makeListLabel(text, sort) {
+      let self = this;
+      let label = document.createElement("div");
+      label.setAttribute("class", "file_list_label");
+      label.innerHTML = text;
+      if(this.sort == sort) {
+        label.innerHTML += this.descending ? " &#9660;" : " &#9650;";
       }
-      this.contnet.appendChild(size);
+      label.addEventListener("click",  function(){self.onSortClicked(sort)});
+      this.labels.appendChild(label);
+    }
+
+    makeListLabels() {
+      this.labels.innerHTML = "";
+      this.makeListLabel("Name", "name");
+      this.makeListLabel("File Size", "size");
+      this.makeListLabel("Last Modified", "modified");
+    }
+
+    createRowNode() {
+      let row = document.createElement("div");
+      row.setAttribute("class", "file_row");
+
+      let name = document.createElement("div");
+      name.setAttribute("class", "file_entry_name");
+      row.appendChild(name);
+
+      let size = document.createElement("div");
+      size.setAttribute("class", "file_entry_size");
+      row.appendChild(size);
 
       let date = document.createElement("div");
       date.setAttribute("class", "file_entry_date");
-      date.innerHTML = this.timestampToString(elem.last_mod);
-      this.contnet.appendChild(date);
+      row.appendChild(date);
+      return row;
     }
 
-    setDirectoryContent(req_path, files) {
-      this.current_path = req_path;
-      this.header.innerHTML = "Index of " + req_path;
-      this.contnet.innerHTML = "";
-      this.makeListLabels();
+    fillRowNode(row, index) {
+      let elem = this.entries[index];
+      let name = row.children[0];
+      let size = row.children[1];
+      let date = row.children[2];
+
+      row.dataset.index = index;
+      name.textContent = elem.display_name;
+      name.classList.toggle("file_entry_dir_name", elem.is_dir);
 
-      if(this.current_elem != null && this.current_path != "/") {
-        this.current_elem.display_name = "..";
-        this.createDirElement(this.current_elem);
+      size.textContent = "";
+      if(!elem.is_dir) {
+        size.textContent = this.sizeToString(elem);
+      } else if(elem.display_name != "..") {
+        let archive = document.createElement("span");
+        archive.setAttribute("class", "file_entry_archive");
+        archive.textContent = "Download .tar";
+        size.appendChild(archive);
+      }
+      date.textContent = this.timestampToString(elem.last_mod);
+    }
+
+    renderRows() {
+      this.render_pending = false;
+      let row_height = FileModeNode.ROW_HEIGHT;
+      let first = Math.floor(this.contnet.scrollTop / row_height);
+      let count = Math.ceil(this.contnet.clientHeight / row_height) + 1;
+      first = Math.max(0, Math.min(first, this.entries.length - count));
+      let last = Math.min(this.entries.length, first + count);
+
+      while(this.rows_view.children.length < last - first) {
+        this.rows_view.appendChild(this.createRowNode());
+      }
+      while(this.rows_view.children.length > last - first) {
+        this.rows_view.removeChild(this.rows_view.lastChild);
+      }
+      for(let i = first; i < last; i++) {
+        this.fillRowNode(this.rows_view.children[i - first], i);
+      }
+      this.rows_view.style.transform = "translateY(" + (first * row_height) + "px)";
+    }
+
+    scheduleRender() {
+      if(this.render_pending) {
+        return;
+      }
+      this.render_pending = true;
+      let self = this;
+      window.requestAnimationFrame(function(){self.renderRows()});
+    }
+
+    onRowsClicked(event) {
+      let row = event.target.closest(".file_row");
+      if(row == null) {
+        return;
+      }
+      let elem = this.entries[row.dataset.index];
+      if(event.target.classList.contains("file_entry_archive")) {
+        this.onArchiveClicked(elem);
+      } else if(event.target.classList.contains("file_entry_name")) {
+        this.onClicked(elem);
+      }
+    }
+
+    setDirectoryContent(req_path, files, cursor, append) {
+      this.page_pending = false;
+      this.cursor = cursor ? cursor : 0;
+      if(!append) {
+        this.current_path = req_path;
+        this.header.innerHTML = "Index of " + req_path;
+        this.makeListLabels();
+        this.entries = [];
+        this.contnet.scrollTop = 0;
+
+        if(this.current_elem != null && this.current_path != "/") {
+          this.current_elem.display_name = "..";
+          this.entries.push(this.current_elem);
+        }
       }
       files.forEach(element => {
         element.display_name = element.name;
-        this.createDirElement(element);
+        this.entries.push(element);
       });
+      this.spacer.style.height = (this.entries.length * FileModeNode.ROW_HEIGHT) + "px";
+      this.scheduleRender();
+      this.onScroll();
+    }
+
+    makeTargetPath(elem) {
+      return (this.current_path == "/") ? ("/" + elem.name) : (this.current_path + "/" + elem.name);
+    }
+
+    startDownload(url, file_name) {
+      let element = document.createElement('a');
+      element.setAttribute("href", url);
+      element.setAttribute("download", file_name);
+
+      element.style.display = 'none';
+      document.body.appendChild(element);
+      element.click();
+      document.body.removeChild(element);
+    }
+
+    onArchiveClicked(elem) {
+      let target = this.makeTargetPath(elem);
+      this.startDownload('archive?'+this.id+"&"+target, elem.name + ".tar");
     }
 
     onClicked(elem) {
@@ -114,19 +276,14 @@ class FileModeNode extends View {
           target = "/";
         }
       } else {
-        target = (this.current_path == "/") ? ("/" + elem.name) : (this.current_path + "/" + elem.name);
+        target = this.makeTargetPath(elem);
       }
       if(elem.is_dir) {
-        document.webApp.messenger.send(MessageBuilder.makeFileReq(this.id, target, true));
+        this.requestDirectory(target);
       } else {
-        let element = document.createElement('a');
-        element.setAttribute("href", 'download?'+this.id+"&"+target);
-        element.setAttribute("download", target.replace(/^.*[\\/]/, ''));
-
-        element.style.display = 'none';
-        document.body.appendChild(element);
-        element.click();
-        document.body.removeChild(element);
+        this.startDownload('download?'+this.id+"&"+target, target.replace(/^.*[\\/]/, ''));
       }
     }
-  }
\ No newline at end of file
+  }
+
+FileModeNode.ROW_HEIGHT = 36;
@@ -0,0 +1,52 @@
+class ListingDecoder {
+  static decode(buffer) {
+    // [type1][terminal_id4][cursor4][append1][path_len2][path][page]
+    let view = new DataView(buffer);
+    let textDecoder = new TextDecoder();
+    let pathLength = view.getUint16(10, true);
+    let listing = {
+      terminal_id: view.getUint32(1, true),
+      cursor: view.getUint32(5, true),
+      append: view.getUint8(9) != 0,
+      req_path: textDecoder.decode(new Uint8Array(buffer, 12, pathLength)),
+      files: []
+    };
+    ListingDecoder.decodePage(view, 12 + pathLength, listing.files);
+    return listing;
+  }
+
+  static decodePage(view, offset, files) {
+    // [version1][flags1][count4][size8 * count][mtime4 * count][is_dir bitmap][names]
+    let textDecoder = new TextDecoder();
+    let prefixCompressed = (view.getUint8(offset + 1) & 1) != 0;
+    let count = view.getUint32(offset + 2, true);
+    let sizeOffset = offset + 6;
+    let mtimeOffset = sizeOffset + count * 8;
+    let dirOffset = mtimeOffset + count * 4;
+    let nameOffset = dirOffset + Math.ceil(count / 8);
+    let bytes = new Uint8Array(view.buffer);
+    let previous = new Uint8Array(0);
+
+    for(let i = 0; i < count; i++) {
+      let prefixLength = 0;
+      if(prefixCompressed) {
+        prefixLength = view.getUint8(nameOffset);
+        nameOffset += 1;
+      }
+      let suffixLength = view.getUint16(nameOffset, true);
+      nameOffset += 2;
+      let name = new Uint8Array(prefixLength + suffixLength);
+      name.set(previous.subarray(0, prefixLength));
+      name.set(bytes.subarray(nameOffset, nameOffset + suffixLength), prefixLength);
+      nameOffset += suffixLength;
+      previous = name;
+
+      files.push({
+        name: textDecoder.decode(name),
+        size: Number(view.getBigUint64(sizeOffset + i * 8, true)),
+        last_mod: view.getUint32(mtimeOffset + i * 4, true),
+        is_dir: (view.getUint8(dirOffset + (i >> 3)) & (1 << (i & 7))) != 0
+      });
+    }
+  }
+};
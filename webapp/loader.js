@@ -8,6 +8,7 @@ class Loader {
       "view.js",
       "filemode.node.js",
       "message.builder.js",
+      "listing.decoder.js",
       "messenger.js",
       "remote.host.js",
       "remote.host.term.bt.js",
@@ -15,6 +16,7 @@ class Loader {
       "remote.host.options.js",
       "terminal.node.js",
       "terminal.view.js",
+      "exec.view.js",
       "terminal.manager.js",
       "reconnect.info.js",
       "web.app.js"
@@ -4,6 +4,16 @@ class MessageBuilder {
     return JSON.stringify(req);
   }
 
+  static makeOwnerKeyMsg(ownerKey) {
+    var req = {type: "owner_key", key: ownerKey};
+    return JSON.stringify(req);
+  }
+
+  static makeTerminalReattachReq(hostId, terminalId) {
+    var req = {type: "terminal_reattach", remote_host_id: hostId, terminal_id: terminalId};
+    return JSON.stringify(req);
+  }
+
   static makeResizeReq(terminalId, width_val, height_val) {
     console.log("Send resize for terminal : " + terminalId);
     var req = {type: "terminal_resize", terminal_id: terminalId, width: width_val, height: height_val};
@@ -20,11 +30,52 @@ class MessageBuilder {
     return JSON.stringify(req);
   }
 
-  static makeFileReq(terminalId, pathReq) {
+  static makeFileReq(terminalId, pathReq, cursor, sort, descending, filter) {
     if(pathReq == null || pathReq == undefined) {
       pathReq = "";
     }
-    var req = {type: "file_req", terminal_id: terminalId, path: pathReq};
+    var req = {type: "file_req",
+               terminal_id: terminalId,
+               path: pathReq,
+               cursor: cursor ? cursor : 0,
+               sort: sort ? sort : "",
+               descending: descending ? 1 : 0,
+               filter: filter ? filter : ""};
+    return JSON.stringify(req);
+  }
+
+  static makeTerminalViewReq(terminalId) {
+    var req = {type: "terminal_view_req", terminal_id: terminalId};
+    return JSON.stringify(req);
+  }
+
+  static makeTerminalViewDelReq(terminalId) {
+    var req = {type: "terminal_view_del", terminal_id: terminalId};
+    return JSON.stringify(req);
+  }
+
+  static makeTerminalViewAck(terminalId, bytesCount) {
+    var req = {type: "terminal_view_ack", terminal_id: terminalId, bytes: bytesCount};
+    return JSON.stringify(req);
+  }
+
+  static makeTerminalGroupReq(groupId, terminalIds) {
+    var req = {type: "terminal_group_set", group_id: groupId, terminal_ids: terminalIds};
+    return JSON.stringify(req);
+  }
+
+  static makeTerminalGroupDelReq(groupId) {
+    var req = {type: "terminal_group_del", group_id: groupId};
+    return JSON.stringify(req);
+  }
+
+  static makeTerminalGroupKeyEvent(groupId, keyEvent) {
+    var req = {type: "terminal_group_key", group_id: groupId, key: keyEvent};
+    return JSON.stringify(req);
+  }
+
+  static makeExecReq(commandReq, hostIds, timeoutMs) {
+    var req = {type: "exec_req", command: commandReq, host_ids: hostIds, timeout: timeoutMs};
     return JSON.stringify(req);
   }
 };
\ No newline at end of file
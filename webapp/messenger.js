@@ -6,6 +6,7 @@ class Messenger {
   createWs() {
     var currentUrl = new URL(window.location.href);
     this.websocket = new WebSocket("ws://" + currentUrl.host);
+    this.websocket.binaryType = "arraybuffer";
     this.websocket.onopen = this.onWsCreated;
     this.websocket.onmessage = this.onWsMessage;
     this.websocket.onclose = this.onWsClose;
@@ -17,20 +18,49 @@ class Messenger {
   }
 
   onWsMessage(msg) {
+    if(msg.data instanceof ArrayBuffer) {
+      Messenger.onWsBinaryMessage(msg.data);
+      return;
+    }
     var json = JSON.parse(msg.data);
-    if(json.type == "host_connected") {
-      document.webApp.onHostConnected(json.host_id, json.host_ip, json.host_user_name, json.host_name);
+    if(json.type == "hosts_connected") {
+      json.hosts.forEach(host => {
+        document.webApp.onHostConnected(host.host_id, host.host_ip, host.host_user_name, host.host_name);
+      });
     } else if(json.type == "host_disconnected") {
       document.webApp.onHostDisconnected(json.host_id);
     } else if(json.type == "terminal_added") {
       document.webApp.onTerminalAdded(json.host_id, json.terminal_id);
+    } else if(json.type == "terminal_orphans") {
+      document.webApp.onTerminalOrphans(json.host_id, json.terminal_ids);
     } else if(json.type == "terminal_output") {
       let bytes2str = String.fromCharCode.apply(null, new Uint16Array(json.output.bytes));
       document.webApp.onTerminalOutput(json.terminal_id, bytes2str);
     } else if(json.type == "terminal_closed") {
       document.webApp.onTerminalClosed(json.host_id, json.terminal_id);
-    } else if(json.type == "directory_listing_received") {
-      document.webApp.onDirectoryListen(json.terminal_id, json.req_path, json.files);
+    } else if(json.type == "terminal_write_state") {
+      document.webApp.onTerminalWriteState(json.terminal_id, json.blocked, json.dropped);
+    } else if(json.type == "terminal_view") {
+      document.webApp.onTerminalView(json.host_id, json.terminal_id);
+    } else if(json.type == "terminal_view_skipped") {
+      document.webApp.onTerminalViewSkipped(json.terminal_id, json.bytes);
+    } else if(json.type == "terminal_group") {
+      document.webApp.onTerminalGroup(json.group_id, json.terminal_ids);
+    } else if(json.type == "exec_started") {
+      document.webApp.onExecStarted(json.exec_id, json.command, json.host_ids);
+    } else if(json.type == "exec_output") {
+      let bytes2str = String.fromCharCode.apply(null, new Uint16Array(json.output.bytes));
+      document.webApp.onExecOutput(json.exec_id, json.host_id, json.stream, bytes2str);
+    } else if(json.type == "exec_end") {
+      document.webApp.onExecEnd(json.exec_id, json.host_id, json.exit_code, json.flags);
+    }
+  }
+
+  static onWsBinaryMessage(buffer) {
+    let type = new DataView(buffer).getUint8(0);
+    if(type == Messenger.DIRECTORY_LISTING) {
+      let listing = ListingDecoder.decode(buffer);
+      document.webApp.onDirectoryListen(listing.terminal_id, listing.req_path, listing.files, listing.cursor, listing.append);
     }
   }
 
@@ -49,3 +79,5 @@ class Messenger {
     this.websocket.send(msg);
   }
 };
+
+Messenger.DIRECTORY_LISTING = 1;
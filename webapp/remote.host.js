@@ -10,6 +10,8 @@ class RemoteHost extends View {
     this.hostList = hostList;
     this.activeTerminal = null;
     this.buttonsPanel = null;
+    this.orphansPanel = null;
+    this.orphanButtons = new Map();
     this.buttons = new Array();
     this.selectedBt = null;
     this.connectingBt = null;
@@ -40,11 +42,40 @@ class RemoteHost extends View {
 
     this.addObj(infoPanel);
 
+    this.orphansPanel = document.createElement("div");
+    this.orphansPanel.setAttribute("class", "remote_host_orphans");
+    this.addObj(this.orphansPanel);
+
     this.buttonsPanel = document.createElement("div");
     this.buttonsPanel.setAttribute("class", "remote_host_buttons");
     this.addObj(this.buttonsPanel);
   }
 
+  showOrphans(terminalIds) {
+    // shells left running by this browser before the server restarted, nothing is attached until asked
+    terminalIds.forEach(terminalId => {
+      if(this.orphanButtons.has(terminalId)) {
+        return;
+      }
+      let self = this;
+      let reattachBt = document.createElement("div");
+      reattachBt.setAttribute("class", "base_bt");
+      reattachBt.innerText = "Reattach shell " + terminalId;
+      reattachBt.onclick = function(event) {
+        event.stopPropagation();
+        self.onReattachClicked(terminalId);
+      };
+      this.orphanButtons.set(terminalId, reattachBt);
+      this.orphansPanel.appendChild(reattachBt);
+    });
+  }
+
+  onReattachClicked(terminalId) {
+    this.orphansPanel.removeChild(this.orphanButtons.get(terminalId));
+    this.orphanButtons.delete(terminalId);
+    document.webApp.terminalManager.sendReattachRequest(this.id, terminalId);
+  }
+
   addTermBt(terminal) {
     let termButton = new RemoteHostTermButton(this, terminal);
     this.buttons.push(termButton);
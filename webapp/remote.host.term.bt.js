@@ -166,6 +166,11 @@ class RemoteHostTermButton extends View {
 
   onTerminalState() {
     this.activated = true;
+    if(this.terminal != null && !this.terminal.readOnly) {
+      let viewUrl = new URL(window.location.href);
+      viewUrl.searchParams.set("view", this.terminal.id);
+      this.node.title = "Read-only link : " + viewUrl.href;
+    }
     this.addButtonView.hide();
     this.filesButtonView.hide();
     this.promtButtonView.show();
@@ -6,6 +6,14 @@ class TerminalManager extends View {
     this.terminalView = null;
     this.hostOptions = null;
     this.noTerminalsInfo = null;
+    this.execView = null;
+    this.execButton = null;
+    this.broadcastButton = null;
+    this.broadcastEnabled = false;
+    this.broadcastGroupId = 0;
+    this.broadcastTerminalIds = [];
+    this.broadcastQueue = "";
+    this.broadcastTimeout = null;
     this.createNode();
     document.webApp.addEventListener(this);
   }
@@ -19,6 +27,24 @@ class TerminalManager extends View {
     this.terminalView = new TerminalView();
     this.addObj(this.terminalView.node);
 
+    this.execView = new ExecView(this.hostList);
+    this.addObj(this.execView.node);
+
+    let self = this;
+    this.execButton = document.createElement("div");
+    this.execButton.setAttribute("class", "base_bt");
+    this.execButton.setAttribute("id", "exec_toggle_bt");
+    this.execButton.innerText = "Run on hosts";
+    this.execButton.addEventListener("click", function() {self.toggleExecView()});
+    this.addObj(this.execButton);
+
+    this.broadcastButton = document.createElement("div");
+    this.broadcastButton.setAttribute("class", "base_bt");
+    this.broadcastButton.setAttribute("id", "broadcast_toggle_bt");
+    this.broadcastButton.innerText = "Broadcast: off";
+    this.broadcastButton.addEventListener("click", function() {self.toggleBroadcast()});
+    this.addObj(this.broadcastButton);
+
     this.noTerminalsInfo = new View();
     this.noTerminalsInfo.createNode();
     this.noTerminalsInfo.setId("terminal_manager_info_text");
@@ -29,6 +55,98 @@ class TerminalManager extends View {
   clear() {
     this.hostList.clear();
     this.terminalView.clear();
+    this.execView.clear();
+  }
+
+  toggleExecView() {
+    if(this.execView.node.style.display == "none") {
+      this.terminalView.hide();
+      this.execView.show();
+      this.execButton.innerText = "Terminals";
+    } else {
+      this.execView.hide();
+      this.terminalView.show();
+      this.execButton.innerText = "Run on hosts";
+    }
+  }
+
+  toggleBroadcast() {
+    this.broadcastEnabled = !this.broadcastEnabled;
+    this.broadcastButton.innerText = this.broadcastEnabled ? "Broadcast: on" : "Broadcast: off";
+    if(this.broadcastEnabled) {
+      this.sendBroadcastGroup();
+    } else if(this.broadcastGroupId) {
+      document.webApp.messenger.send(MessageBuilder.makeTerminalGroupDelReq(this.broadcastGroupId));
+      this.broadcastGroupId = 0;
+      this.broadcastTerminalIds = [];
+      this.broadcastQueue = "";
+    }
+  }
+
+  sendBroadcastGroup() {
+    let terminalIds = Array.from(this.terminalView.terminals.keys());
+    document.webApp.messenger.send(MessageBuilder.makeTerminalGroupReq(this.broadcastGroupId, terminalIds));
+  }
+
+  onTerminalGroup(groupId, terminalIds) {
+    if(!this.broadcastEnabled) {
+      document.webApp.messenger.send(MessageBuilder.makeTerminalGroupDelReq(groupId));
+      return;
+    }
+    this.broadcastGroupId = groupId;
+    this.broadcastTerminalIds = terminalIds;
+  }
+
+  sendBroadcastKey(terminalId, key) {
+    if(!this.broadcastEnabled || !this.broadcastGroupId) {
+      return false;
+    }
+    this.broadcastQueue += key;
+    this.sendBroadcastQueue();
+    return true;
+  }
+
+  // the group is as slow as its slowest shell, input waits while any member's write queue is full
+  isBroadcastBlocked() {
+    return this.broadcastTerminalIds.some(terminalId => {
+      let terminal = this.terminalView.getTerminalById(terminalId);
+      return terminal != null && terminal.inputBlocked;
+    });
+  }
+
+  sendBroadcastQueue() {
+    if(this.broadcastTimeout != null || this.broadcastQueue.length == 0 || this.isBroadcastBlocked()) {
+      return;
+    }
+    let messenger = document.webApp.messenger;
+    if(messenger.websocket != null && messenger.websocket.bufferedAmount > TerminalNode.INPUT_CHUNK_SIZE) {
+      this.broadcastTimeout = setTimeout(function() {
+        this.broadcastTimeout = null;
+        this.sendBroadcastQueue();
+      }.bind(this), 10);
+      return;
+    }
+    let chunk = this.broadcastQueue.substring(0, TerminalNode.inputChunkSize(this.broadcastQueue));
+    this.broadcastQueue = this.broadcastQueue.substring(chunk.length);
+    messenger.send(MessageBuilder.makeTerminalGroupKeyEvent(this.broadcastGroupId, chunk));
+    if(this.broadcastQueue.length > 0) {
+      this.broadcastTimeout = setTimeout(function() {
+        this.broadcastTimeout = null;
+        this.sendBroadcastQueue();
+      }.bind(this), 0);
+    }
+  }
+
+  onTerminalWriteState(terminalId, blocked, droppedBytes) {
+    let terminal = this.terminalView.getTerminalById(terminalId);
+    if(terminal == null) {
+      return;
+    }
+    terminal.setInputBlocked(blocked);
+    if(droppedBytes > 0) {
+      this.onTerminalOutput(terminalId, "\r\n[" + droppedBytes + " bytes of input dropped]\r\n");
+    }
+    this.sendBroadcastQueue();
   }
 
   onEvent(appEvent) {
@@ -37,7 +155,7 @@ class TerminalManager extends View {
         this.onHostSelected(appEvent.host);
         break;
       case "TerminalAdded" :
-        this.onTerminalAdded(appEvent.hostId, appEvent.terminalId);
+        this.onTerminalAdded(appEvent.hostId, appEvent.terminalId, appEvent.readOnly);
         break;
       case "TerminalSelected" :
         this.onTerminalSelected(appEvent.terminalNode);
@@ -54,12 +172,18 @@ class TerminalManager extends View {
     this.noTerminalsInfo.show();
     this.terminalView.hide();
     this.hostList.hide();
+    this.execView.hide();
+    this.execButton.style.display = "none";
+    this.broadcastButton.style.display = "none";
   }
 
   hideNoTerminalsInfo() {
     this.noTerminalsInfo.hide();
     this.terminalView.show();
     this.hostList.show();
+    this.execButton.style.display = "flex";
+    this.execButton.innerText = "Run on hosts";
+    this.broadcastButton.style.display = "flex";
   }
 
   onHostConnected(hostId, hostIp, hostUserName, hostName) {
@@ -77,7 +201,22 @@ class TerminalManager extends View {
     document.webApp.messenger.send(termReqMsg);
   }
 
+  onTerminalOrphans(hostId, terminalIds) {
+    let host = this.hostList.getHostById(hostId);
+    if(host == null) {
+      return;
+    }
+    host.showOrphans(terminalIds);
+  }
+
+  sendReattachRequest(hostId, terminalId) {
+    document.webApp.messenger.send(MessageBuilder.makeTerminalReattachReq(hostId, terminalId));
+  }
+
   terminalCloseRequested(terminalId){
+    if(this.closeViewedTerminal(terminalId)) {
+      return;
+    }
     let termReqMsg = MessageBuilder.makeCloseTerminalReq(terminalId);
     document.webApp.messenger.send(termReqMsg);
   }
@@ -111,20 +250,42 @@ class TerminalManager extends View {
 
   onTerminalClosed(hostId, terminalId) {
     this.terminalView.removeTerminal(terminalId);
+    if(this.broadcastEnabled) {
+      this.sendBroadcastGroup();
+    }
   }
 
-  onTerminalAdded(hostId, terminalId) {
+  onTerminalAdded(hostId, terminalId, readOnly) {
     let terminalNode = this.terminalView.createTerminalNode(terminalId);
     if(terminalNode == null) {
       return;
     }
+    if(readOnly) {
+      terminalNode.setReadOnly();
+    }
     this.hostList.addTerminalForHost(hostId, terminalNode);
     if(this.hostList.currentHost.id == hostId) {
       this.terminalView.setTerminal(this.hostList.currentHost.activeTerminal);
     }
+    if(this.broadcastEnabled) {
+      this.sendBroadcastGroup();
+    }
+  }
+
+  closeViewedTerminal(terminalId) {
+    let terminal = this.terminalView.getTerminalById(terminalId);
+    if(terminal == null || !terminal.readOnly) {
+      return false;
+    }
+    document.webApp.messenger.send(MessageBuilder.makeTerminalViewDelReq(terminalId));
+    this.terminalView.removeTerminal(terminalId);
+    return true;
   }
 
   deleteTerminal(id) {
+    if(this.closeViewedTerminal(id)) {
+      return;
+    }
     this.terminalView.removeTerminal(id);
     document.webApp.onUITerminalClosed(id);
   }
@@ -133,7 +294,7 @@ class TerminalManager extends View {
     this.terminalView.onTerminalOutput(id, output);
   }
 
-  onDirectoryListen(id, req_path, files) {
-    this.terminalView.onDirectoryListen(id, req_path, files);
+  onDirectoryListen(id, req_path, files, cursor, append) {
+    this.terminalView.onDirectoryListen(id, req_path, files, cursor, append);
   }
 }
@@ -20,6 +20,12 @@ class TerminalNode extends View {
       this.terminalContainer = null;
       this.fileModeNode = null;
       this.fileModeActivated = false;
+      this.readOnly = false;
+      this.pendingAck = 0;
+      this.ackTimeout = null;
+      this.inputQueue = "";
+      this.inputBlocked = false;
+      this.inputTimeout = null;
       this.createNode();
       this.createTerm(terminalId);
     }
@@ -83,15 +89,90 @@ class TerminalNode extends View {
       this.terminal.focus();
     }
 
+    setReadOnly() {
+      this.readOnly = true;
+      this.terminal.options.disableStdin = true;
+    }
+
     write(msg) {
-      this.terminal.write(msg);
+      if(!this.readOnly) {
+        this.terminal.write(msg);
+        return;
+      }
+      // viewers ack what xterm has parsed, server stops sending when they fall behind
+      this.terminal.write(msg, () => {this.onOutputWritten(msg.length);});
+    }
+
+    onOutputWritten(length) {
+      this.pendingAck += length;
+      if(this.ackTimeout != null) {
+        return;
+      }
+      this.ackTimeout = setTimeout(function() {
+        this.ackTimeout = null;
+        document.webApp.messenger.send(MessageBuilder.makeTerminalViewAck(this.id, this.pendingAck));
+        this.pendingAck = 0;
+      }.bind(this), 50);
     }
 
     onTermData(e) {
-      document.webApp.messenger.send(MessageBuilder.makeKeyEvent(this.id, e));
+      if(this.readOnly) {
+        return;
+      }
+      if(document.webApp.terminalManager.sendBroadcastKey(this.id, e)) {
+        return;
+      }
+      if(this.inputQueue.length == 0 && !this.inputBlocked && e.length <= TerminalNode.INPUT_CHUNK_SIZE) {
+        document.webApp.messenger.send(MessageBuilder.makeKeyEvent(this.id, e));
+        return;
+      }
+      this.inputQueue += e;
+      this.sendQueuedInput();
+    }
+
+    // large pastes go out in chunks, paused while the client's write queue is full
+    sendQueuedInput() {
+      if(this.inputTimeout != null || this.inputBlocked || this.inputQueue.length == 0) {
+        return;
+      }
+      let messenger = document.webApp.messenger;
+      if(messenger.websocket != null && messenger.websocket.bufferedAmount > TerminalNode.INPUT_CHUNK_SIZE) {
+        this.inputTimeout = setTimeout(function() {
+          this.inputTimeout = null;
+          this.sendQueuedInput();
+        }.bind(this), 10);
+        return;
+      }
+      let chunk = this.inputQueue.substring(0, TerminalNode.inputChunkSize(this.inputQueue));
+      this.inputQueue = this.inputQueue.substring(chunk.length);
+      messenger.send(MessageBuilder.makeKeyEvent(this.id, chunk));
+      this.inputTimeout = setTimeout(function() {
+        this.inputTimeout = null;
+        this.sendQueuedInput();
+      }.bind(this), 0);
+    }
+
+    setInputBlocked(blocked) {
+      this.inputBlocked = blocked;
+      this.sendQueuedInput();
     }
 
     onTermResize(e) {
+      if(this.readOnly) {
+        return;
+      }
       document.webApp.messenger.send(MessageBuilder.makeResizeReq(this.id, e.cols, e.rows));
     };
-  }
\ No newline at end of file
+  }
+
+TerminalNode.INPUT_CHUNK_SIZE = 16 * 1024;
+
+// don't split a surrogate pair, each half alone reaches the shell as garbage
+TerminalNode.inputChunkSize = function(queue) {
+  let chunkSize = TerminalNode.INPUT_CHUNK_SIZE;
+  let lastCode = queue.charCodeAt(chunkSize - 1);
+  if(queue.length > chunkSize && lastCode >= 0xD800 && lastCode <= 0xDBFF) {
+    chunkSize--;
+  }
+  return chunkSize;
+}
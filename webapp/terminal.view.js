@@ -58,10 +58,10 @@ class TerminalView extends View {
     }
   }
 
-  onDirectoryListen(id, req_path, files) {
+  onDirectoryListen(id, req_path, files, cursor, append) {
     let terminal = this.getTerminalById(id);
     if(terminal != null) {
-      terminal.fileModeNode.setDirectoryContent(req_path, files);
+      terminal.fileModeNode.setDirectoryContent(req_path, files, cursor, append);
     }
   }
 
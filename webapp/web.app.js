@@ -3,6 +3,7 @@ class WebApp {
     this.messenger = null;
     this.terminalManager = null;
     this.reconnectInfo = null;
+    this.ownerKey = null;
     this.listeners = new Array();
   }
 
@@ -38,9 +39,37 @@ class WebApp {
     this.terminalManager.clear();
   }
 
+  getOwnerKey() {
+    // kept across reloads, shells of this browser are offered back to it after a server restart
+    if(this.ownerKey != null) {
+      return this.ownerKey;
+    }
+    try {
+      this.ownerKey = window.localStorage.getItem(WebApp.OWNER_KEY_ITEM);
+    } catch(e) {
+      console.log("localStorage unavailable, owner key lasts until reload");
+    }
+    if(this.ownerKey == null || this.ownerKey.length != WebApp.OWNER_KEY_SIZE) {
+      let bytes = new Uint8Array(WebApp.OWNER_KEY_SIZE / 2);
+      window.crypto.getRandomValues(bytes);
+      this.ownerKey = Array.from(bytes, byte => byte.toString(16).padStart(2, "0")).join("");
+      try {
+        window.localStorage.setItem(WebApp.OWNER_KEY_ITEM, this.ownerKey);
+      } catch(e) {
+      }
+    }
+    return this.ownerKey;
+  }
+
   onConnected() {
+    // sent first, terminals requested after it are tied to this browser
+    this.messenger.send(MessageBuilder.makeOwnerKeyMsg(this.getOwnerKey()));
     this.reconnectInfo.disable();
     this.terminalManager.show();
+    let viewTerminalId = parseInt(new URL(window.location.href).searchParams.get("view"));
+    if(viewTerminalId > 0) {
+      this.messenger.send(MessageBuilder.makeTerminalViewReq(viewTerminalId));
+    }
   }
 
   onDisconnected() {
@@ -61,6 +90,22 @@ class WebApp {
     this.pushEvent(this, new AppEventTerminalAdded(hostId, terminalId));
   }
 
+  onTerminalOrphans(hostId, terminalIds) {
+    this.terminalManager.onTerminalOrphans(hostId, terminalIds);
+  }
+
+  onTerminalWriteState(terminalId, blocked, droppedBytes) {
+    this.terminalManager.onTerminalWriteState(terminalId, blocked, droppedBytes);
+  }
+
+  onTerminalView(hostId, terminalId) {
+    this.pushEvent(this, new AppEventTerminalAdded(hostId, terminalId, true));
+  }
+
+  onTerminalViewSkipped(terminalId, bytesCount) {
+    this.terminalManager.onTerminalOutput(terminalId, "\r\n[" + bytesCount + " bytes of output skipped]\r\n");
+  }
+
   onTerminalOutput(terminalId, msg) {
     this.terminalManager.onTerminalOutput(terminalId, msg);
   }
@@ -69,8 +114,24 @@ class WebApp {
     this.pushEvent(this, new AppEventTerminalClosed(hostId, terminalId));
   }
 
-  onDirectoryListen(terminalId, req_path, files) {
-    this.terminalManager.onDirectoryListen(terminalId, req_path, files);
+  onDirectoryListen(terminalId, req_path, files, cursor, append) {
+    this.terminalManager.onDirectoryListen(terminalId, req_path, files, cursor, append);
+  }
+
+  onTerminalGroup(groupId, terminalIds) {
+    this.terminalManager.onTerminalGroup(groupId, terminalIds);
+  }
+
+  onExecStarted(execId, command, hostIds) {
+    this.terminalManager.execView.onExecStarted(execId, command, hostIds);
+  }
+
+  onExecOutput(execId, hostId, stream, output) {
+    this.terminalManager.execView.onExecOutput(execId, hostId, stream, output);
+  }
+
+  onExecEnd(execId, hostId, exitCode, flags) {
+    this.terminalManager.execView.onExecEnd(execId, hostId, exitCode, flags);
   }
 
   reconnect() {
@@ -81,3 +142,6 @@ class WebApp {
     this.messenger.send(MessageBuilder.makeCloseTerminalReq(terminalId));
   }
 };
+
+WebApp.OWNER_KEY_ITEM = "owner_key";
+WebApp.OWNER_KEY_SIZE = 32;